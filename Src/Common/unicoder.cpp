@@ -20,6 +20,12 @@ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLI
 #include <tchar.h>
 #include <cassert>
 #include <memory>
+#include <cstring>
+#include <cstdint>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define UNICODER_SSE2
+#include <emmintrin.h>
+#endif
 #include <Poco/UnicodeConverter.h>
 #include "UnicodeString.h"
 #include "ExConverter.h"
@@ -1125,6 +1131,87 @@ std::string toThreadCP(const std::wstring& str)
 	return to;
 }
 
+/**
+ * @brief Bit masks of byte classes of a 64-byte block of UTF-8 text.
+ * Bit i of a mask is set if byte i of the block is of the class.
+ */
+struct Utf8BlockMasks
+{
+	uint64_t high;      /**< 0x80-0xFF */
+	uint64_t cont;      /**< Continuation bytes 0x80-0xBF */
+	uint64_t lead2;     /**< Leads of 2-byte sequences 0xC0-0xDF */
+	uint64_t lead3;     /**< Leads of 3-byte sequences 0xE0-0xEF */
+	uint64_t lead4;     /**< Leads of 4-byte sequences 0xF0-0xF7 */
+	uint64_t forbidden; /**< 0xC0, 0xC1 and 0xF5-0xFF */
+};
+
+#ifdef UNICODER_SSE2
+/** @brief Byte class masks of a block using signed byte compares. */
+static inline void GetUtf8BlockMasks(const unsigned char *p, Utf8BlockMasks &m)
+{
+	m = {};
+	for (int k = 0; k < 4; ++k)
+	{
+		// As signed bytes 0x80 is -128, 0xC0 is -64, 0xE0 is -32 and so on
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16 * k));
+		const __m128i geC0 = _mm_cmpgt_epi8(v, _mm_set1_epi8(-65));
+		const __m128i geC2 = _mm_cmpgt_epi8(v, _mm_set1_epi8(-63));
+		const __m128i geE0 = _mm_cmpgt_epi8(v, _mm_set1_epi8(-33));
+		const __m128i geF0 = _mm_cmpgt_epi8(v, _mm_set1_epi8(-17));
+		const __m128i geF5 = _mm_cmpgt_epi8(v, _mm_set1_epi8(-12));
+		const __m128i geF8 = _mm_cmpgt_epi8(v, _mm_set1_epi8(-9));
+		const __m128i high = _mm_cmplt_epi8(v, _mm_setzero_si128());
+		const int shift = 16 * k;
+		m.high |= static_cast<uint64_t>(_mm_movemask_epi8(high)) << shift;
+		m.cont |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_andnot_si128(geC0, high))) << shift;
+		m.lead2 |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_andnot_si128(geE0, geC0))) << shift;
+		m.lead3 |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_andnot_si128(geF0, geE0))) << shift;
+		m.lead4 |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_andnot_si128(geF8, geF0))) << shift;
+		m.forbidden |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_or_si128(_mm_andnot_si128(geC2, geC0),
+			_mm_and_si128(geF5, high)))) << shift;
+	}
+}
+
+/** @brief Check whether all bytes of a 64-byte block are ASCII. */
+static inline bool IsAsciiBlock(const unsigned char *p)
+{
+	const __m128i v = _mm_or_si128(
+		_mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 16))),
+		_mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 32)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 48))));
+	return _mm_movemask_epi8(v) == 0;
+}
+#else
+static inline void GetUtf8BlockMasks(const unsigned char *p, Utf8BlockMasks &m)
+{
+	m = {};
+	for (int i = 0; i < 64; ++i)
+	{
+		const unsigned c = p[i];
+		const uint64_t bit = static_cast<uint64_t>(1) << i;
+		if (c < 0x80)
+			continue;
+		m.high |= bit;
+		if (c < 0xC0)
+			m.cont |= bit;
+		else if (c < 0xE0)
+			m.lead2 |= bit;
+		else if (c < 0xF0)
+			m.lead3 |= bit;
+		else if (c < 0xF8)
+			m.lead4 |= bit;
+		if (c == 0xC0 || c == 0xC1 || c >= 0xF5)
+			m.forbidden |= bit;
+	}
+}
+
+static inline bool IsAsciiBlock(const unsigned char *p)
+{
+	uint64_t w[8];
+	memcpy(w, p, sizeof(w));
+	return ((w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) & 0x8080808080808080ULL) == 0;
+}
+#endif
+
 // Algorithm originally from:
 // TortoiseMerge - a Diff/Patch program
 // Copyright (C) 2007 - TortoiseSVN
@@ -1132,74 +1219,51 @@ std::string toThreadCP(const std::wstring& str)
  * @brief Check for invalid UTF-8 bytes in buffer.
  * This function checks if there are invalid UTF-8 bytes in the given buffer.
  * If such bytes are found, caller knows this buffer is not valid UTF-8 file.
+ * The buffer is also considered invalid if it has no multibyte sequences
+ * at all (pure ASCII).
+ *
+ * The buffer is checked in one pass, 64 bytes at a time. Blocks of ASCII
+ * are skipped. For other blocks the bytes which must be continuation bytes
+ * are computed from the lead bytes, and they must be exactly the
+ * continuation bytes of the block. Only the structure of the sequences is
+ * checked, not overlong encodings or surrogates.
  * @param [in] pBuffer Pointer to begin of the buffer.
  * @param [in] size Size of the buffer in bytes.
  * @return true if invalid bytes found, false otherwise.
  */
 bool CheckForInvalidUtf8(const char *pBuffer, size_t size)
 {
-	unsigned char * pVal2 = (unsigned char *)pBuffer;
-	for (size_t j = 0; j < size; ++j)
-	{
-		if ((*pVal2 == 0xC0) || (*pVal2 == 0xC1) || (*pVal2 >= 0xF5))
-			return true;
-		pVal2++;
-	}
-	pVal2 = (unsigned char *)pBuffer;
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(pBuffer);
+	uint64_t carry = 0; // continuation bytes required at the start of the next block
 	bool bUTF8 = false;
-	for (size_t i = 0; i < size; ++i)
+	for (size_t i = 0; i < size; i += 64)
 	{
-		if ((*pVal2 & 0x80) == 0x00)
-			;
-		else if ((*pVal2 & 0xE0) == 0xC0)
-		{
-			if (i >= size - 1)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			bUTF8 = true;
-		}
-		else if ((*pVal2 & 0xF0) == 0xE0)
-		{
-			if (i >= size - 2)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			bUTF8 = true;
-		}
-		else if ((*pVal2 & 0xF8) == 0xF0)
+		unsigned char tail[64];
+		const unsigned char *block = p + i;
+		if (size - i < 64)
 		{
-			if (i >= size - 3)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			pVal2++;
-			i++;
-			if ((*pVal2 & 0xC0) != 0x80)
-				return true;
-			bUTF8 = true;
+			// Padding with ASCII leaves truncated sequences without their
+			// continuation bytes
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, block, size - i);
+			block = tail;
 		}
-		else
+		else if (carry == 0 && IsAsciiBlock(block))
+			continue;
+		Utf8BlockMasks m;
+		GetUtf8BlockMasks(block, m);
+		const uint64_t leads = m.lead2 | m.lead3 | m.lead4;
+		const uint64_t leads34 = m.lead3 | m.lead4;
+		const uint64_t required = (leads << 1) | (leads34 << 2) | (m.lead4 << 3) | carry;
+		if (m.forbidden != 0 || required != m.cont)
 			return true;
-		pVal2++;
+		carry = (leads >> 63) | (leads34 >> 62) | (m.lead4 >> 61);
+		if (m.high != 0)
+			bUTF8 = true;
 	}
-	if (bUTF8)
-		return false;
-	return true;
+	if (carry != 0)
+		return true;
+	return !bUTF8;
 }
 
 /**
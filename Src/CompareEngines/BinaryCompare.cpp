@@ -6,15 +6,22 @@
 
 #include "pch.h"
 #include "BinaryCompare.h"
+#include <windows.h>
+#include <memory>
+#include <algorithm>
 #include "DiffItem.h"
 #include "PathContext.h"
 #include "TFile.h"
-#include <io.h>
-#include <fcntl.h>
+#include "MemCompare.h"
+#include "FileIdentity.h"
 
 namespace CompareEngines
 {
 
+static const size_t BufferSize = 1024 * 256;
+/** Size of the mapped views, small enough for the 32-bit address space */
+static const int64_t MapViewSize = 64 * 1024 * 1024;
+
 BinaryCompare::BinaryCompare()
 {
 }
@@ -23,67 +30,175 @@ BinaryCompare::~BinaryCompare()
 {
 }
 
-static int compare_files(const String& file1, const String& file2)
+/**
+ * @brief Find the first difference of two mapped views.
+ * A read error of a mapped file is raised as an exception when the
+ * page is accessed, so it is caught here.
+ * @return false if the files could not be read.
+ */
+static bool FindFirstDifferenceInViews(const void *p1, const void *p2, size_t size, size_t &pos)
+{
+#ifdef _MSC_VER
+	__try
+	{
+		pos = FindFirstDifference(p1, p2, size);
+		return true;
+	}
+	__except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+	{
+		return false;
+	}
+#else
+	pos = FindFirstDifference(p1, p2, size);
+	return true;
+#endif
+}
+
+/**
+ * @brief Compare two files of the same size by mapping them to memory.
+ * @param [out] firstDiff Offset of the first difference.
+ * @return DIFFCODE, or -1 if the files can't be mapped.
+ */
+static int compare_mapped_files(HANDLE hFile1, HANDLE hFile2, int64_t size, int64_t &firstDiff)
 {
-	const size_t bufsize = 1024 * 256;
-	int code;
-	int fd1 = -1, fd2 = -1;
-	
-	_tsopen_s(&fd1, TFile(file1).wpath().c_str(), O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
-	_tsopen_s(&fd2, TFile(file2).wpath().c_str(), O_BINARY | O_RDONLY, _SH_DENYNO, _S_IREAD);
-	if (fd1 != -1 && fd2 != -1)
+	HANDLE hMap1 = CreateFileMapping(hFile1, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	HANDLE hMap2 = CreateFileMapping(hFile2, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	int code = -1;
+	if (hMap1 != nullptr && hMap2 != nullptr)
 	{
-		for (;;)
+		code = DIFFCODE::SAME;
+		for (int64_t offset = 0; offset < size; offset += MapViewSize)
 		{
-			char buf1[bufsize];
-			char buf2[bufsize];
-			int size1 = _read(fd1, buf1, sizeof(buf1));
-			int size2 = _read(fd2, buf2, sizeof(buf2));
-			if (size1 <= 0 || size2 <= 0)
-			{
-				if (size1 < 0 || size2 < 0)
-					code = DIFFCODE::CMPERR;
-				else
-					code = DIFFCODE::SAME;
-				break;
-			}
-			if (size1 != size2 || memcmp(buf1, buf2, size1) != 0)
+			const size_t viewSize = static_cast<size_t>((std::min)(MapViewSize, size - offset));
+			const DWORD offsetHigh = static_cast<DWORD>(offset >> 32);
+			const DWORD offsetLow = static_cast<DWORD>(offset);
+			const void *pView1 = MapViewOfFile(hMap1, FILE_MAP_READ, offsetHigh, offsetLow, viewSize);
+			const void *pView2 = MapViewOfFile(hMap2, FILE_MAP_READ, offsetHigh, offsetLow, viewSize);
+			size_t pos = 0;
+			if (pView1 == nullptr || pView2 == nullptr ||
+				!FindFirstDifferenceInViews(pView1, pView2, viewSize, pos))
+				code = DIFFCODE::CMPERR;
+			else if (pos < viewSize)
 			{
+				firstDiff = offset + pos;
 				code = DIFFCODE::DIFF;
-				break;
 			}
+			if (pView1 != nullptr)
+				UnmapViewOfFile(pView1);
+			if (pView2 != nullptr)
+				UnmapViewOfFile(pView2);
+			if (code != DIFFCODE::SAME)
+				break;
 		}
 	}
-	else
+	if (hMap1 != nullptr)
+		CloseHandle(hMap1);
+	if (hMap2 != nullptr)
+		CloseHandle(hMap2);
+	return code;
+}
+
+/**
+ * @brief Compare two files of the same size by reading them.
+ * Used when the files can't be mapped.
+ * @param [out] firstDiff Offset of the first difference.
+ * @return DIFFCODE
+ */
+static int compare_read_files(HANDLE hFile1, HANDLE hFile2, int64_t &firstDiff)
+{
+	std::unique_ptr<char[]> buf1(new char[BufferSize]);
+	std::unique_ptr<char[]> buf2(new char[BufferSize]);
+	int64_t offset = 0;
+	for (;;)
 	{
-		code = DIFFCODE::CMPERR;
+		DWORD size1 = 0, size2 = 0;
+		if (!ReadFile(hFile1, buf1.get(), static_cast<DWORD>(BufferSize), &size1, nullptr) ||
+			!ReadFile(hFile2, buf2.get(), static_cast<DWORD>(BufferSize), &size2, nullptr))
+			return DIFFCODE::CMPERR;
+		const size_t pos = FindFirstDifference(buf1.get(), buf2.get(), (std::min)(size1, size2));
+		if (pos < (std::min)(size1, size2) || size1 != size2)
+		{
+			firstDiff = offset + pos;
+			return DIFFCODE::DIFF;
+		}
+		if (size1 == 0)
+			return DIFFCODE::SAME;
+		offset += size1;
 	}
-	if (fd1 != -1)
-		_close(fd1);
-	if (fd2 != -1)
-		_close(fd2);
+}
 
+/**
+ * @brief Compare two files byte-by-byte.
+ * Two paths of the same file are identical without reading them.
+ * @param [out] firstDiff Offset of the first difference, -1 if the files
+ * are identical or could not be read.
+ * @return DIFFCODE
+ */
+static int compare_files(const String& file1, const String& file2, int64_t &firstDiff)
+{
+	int code = DIFFCODE::CMPERR;
+	firstDiff = -1;
+	HANDLE hFile1 = CreateFileW(TFile(file1).wpath().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	HANDLE hFile2 = CreateFileW(TFile(file2).wpath().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	LARGE_INTEGER size1, size2;
+	if (hFile1 != INVALID_HANDLE_VALUE && hFile2 != INVALID_HANDLE_VALUE &&
+		GetFileSizeEx(hFile1, &size1) && GetFileSizeEx(hFile2, &size2))
+	{
+		if (size1.QuadPart != size2.QuadPart)
+		{
+			// Changed since the folder was scanned
+			code = compare_read_files(hFile1, hFile2, firstDiff);
+		}
+		else if (size1.QuadPart == 0 || FileIdentity::CompareHandles(hFile1, hFile2) != FileIdentity::UNKNOWN)
+			code = DIFFCODE::SAME;
+		else
+		{
+			code = compare_mapped_files(hFile1, hFile2, size1.QuadPart, firstDiff);
+			if (code == -1)
+				code = compare_read_files(hFile1, hFile2, firstDiff);
+		}
+	}
+	if (hFile1 != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile1);
+	if (hFile2 != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile2);
+	if (code != DIFFCODE::DIFF)
+		firstDiff = -1;
 	return code;
 }
 
 /**
  * @brief Compare two specified files, byte-by-byte
- * @param [in] di Diffitem info.
+ * The offset of the first difference is stored to di.firstDiffOffset.
+ * In 3-way compare it is the first offset where the files are not all
+ * equal. It is not known if the sizes of the files differ.
+ * @param [in,out] di Diffitem info.
  * @return DIFFCODE
  */
-int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) const
+int BinaryCompare::CompareFiles(const PathContext& files, DIFFITEM &di) const
 {
+	di.firstDiffOffset = -1;
 	switch (files.GetSize())
 	{
 	case 2:
 		return di.diffFileInfo[0].size != di.diffFileInfo[1].size ? 
-			DIFFCODE::DIFF : compare_files(files[0], files[1]);
+			DIFFCODE::DIFF : compare_files(files[0], files[1], di.firstDiffOffset);
 	case 3:
+		int64_t offset10 = -1, offset12 = -1, offset02 = -1;
 		unsigned code10 = (di.diffFileInfo[1].size != di.diffFileInfo[0].size) ?
-			DIFFCODE::DIFF : compare_files(files[1], files[0]);
+			DIFFCODE::DIFF : compare_files(files[1], files[0], offset10);
 		unsigned code12 = (di.diffFileInfo[1].size != di.diffFileInfo[2].size) ?
-			DIFFCODE::DIFF : compare_files(files[1], files[2]);
+			DIFFCODE::DIFF : compare_files(files[1], files[2], offset12);
 		unsigned code02 = DIFFCODE::SAME;
+		if (di.diffFileInfo[0].size == di.diffFileInfo[1].size && di.diffFileInfo[1].size == di.diffFileInfo[2].size)
+		{
+			if (offset10 >= 0 && offset12 >= 0)
+				di.firstDiffOffset = (std::min)(offset10, offset12);
+			else
+				di.firstDiffOffset = (std::max)(offset10, offset12);
+		}
 		if (code10 == DIFFCODE::SAME && code12 == DIFFCODE::SAME)
 			return DIFFCODE::SAME;
 		else if (code10 == DIFFCODE::SAME && code12 == DIFFCODE::DIFF)
@@ -93,12 +208,15 @@ int BinaryCompare::CompareFiles(const PathContext& files, const DIFFITEM &di) co
 		else if (code10 == DIFFCODE::DIFF && code12 == DIFFCODE::DIFF)
 		{
 			code02 = di.diffFileInfo[0].size != di.diffFileInfo[2].size ?
-				DIFFCODE::DIFF : compare_files(files[0], files[2]);
+				DIFFCODE::DIFF : compare_files(files[0], files[2], offset02);
 			if (code02 == DIFFCODE::SAME)
 				return DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY;
 		}
 		if (code10 == DIFFCODE::CMPERR || code12 == DIFFCODE::CMPERR || code02 == DIFFCODE::CMPERR)
+		{
+			di.firstDiffOffset = -1;
 			return DIFFCODE::CMPERR;
+		}
 		return DIFFCODE::DIFF;
 	}
 	return DIFFCODE::CMPERR;
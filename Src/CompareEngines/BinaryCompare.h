@@ -14,13 +14,15 @@ namespace CompareEngines
 /**
  * @brief A binary compare class.
  * This compare method compares files by their binary contents.
+ * The files are mapped to memory and compared with SIMD instructions,
+ * which also gives the offset of the first difference.
  */
 class BinaryCompare
 {
 public:
 	BinaryCompare();
 	~BinaryCompare();
-	int CompareFiles(const PathContext& files, const DIFFITEM &di) const;
+	int CompareFiles(const PathContext& files, DIFFITEM &di) const;
 };
 
 } // namespace CompareEngines
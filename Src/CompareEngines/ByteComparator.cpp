@@ -7,9 +7,11 @@
 #include "pch.h"
 #include "ByteComparator.h"
 #include <cassert>
+#include <algorithm>
 #include "UnicodeString.h"
 #include "FileTextStats.h"
 #include "CompareOptions.h"
+#include "MemCompare.h"
 
 /**
  * @brief Returns if given char is EOL byte.
@@ -47,55 +49,15 @@ static void TextScan(FileTextStats & stats, const char *ptr, const char *end, bo
 		bool crflag, int64_t offset)
 {
 	// Handle any crs left from last buffer
-	if (crflag)
+	if (crflag && ptr == end)
 	{
-		if (ptr < end && *ptr == '\n')
-		{
-			++stats.ncrlfs;
-			++ptr;
-		}
-		else
-		{
-			++stats.ncrs;
-		}
-	}
-	for (; ptr < end; ++ptr)
-	{
-		char ch = *ptr;
-		if (ch == 0)
-		{
-			++stats.nzeros;
-		}
-		else if (ch == '\r')
-		{
-			if (ptr + 1 < end)
-			{
-				if (ptr[1] == '\n')
-				{
-					++stats.ncrlfs;
-					++ptr;
-				}
-				else
-				{
-					++stats.ncrs;
-				}
-			}
-			else if (eof)
-			{
-				++stats.ncrs;
-			}
-			else
-			{
-				// else last byte of buffer
-				// leave alone, the CompareBuffers loop will set the appropriate m_cr flag
-				// and we'll handle it next time we're called
-			}
-		}
-		else if (ch == '\n')
-		{
-			++stats.nlfs;
-		}
+		++stats.ncrs;
+		return;
 	}
+	// A CR ending the buffer is left alone, the CompareBuffers loop will
+	// set the appropriate m_cr flag and we'll handle it next time we're called
+	if (stats.Scan(ptr, end - ptr, crflag) && eof)
+		++stats.ncrs;
 }
 
 namespace CompareEngines
@@ -128,6 +90,12 @@ ByteComparator::ByteComparator(const QuickCompareOptions * options)
 		m_ignore_all_space = true;
 	else
 		m_ignore_all_space = false;
+
+	m_stopchars = 0;
+	if (m_ignore_space_change || m_ignore_all_space)
+		m_stopchars |= STOP_AT_SPACE;
+	if (m_ignore_eol_diff || m_ignore_blank_lines)
+		m_stopchars |= STOP_AT_EOL;
 }
 
 /**
@@ -168,6 +136,22 @@ ByteComparator::COMP_RESULT ByteComparator::CompareBuffers(
 	// cycle through buffer data performing actual comparison
 	while (true)
 	{
+		// Fast path: skip identical bytes the ignore options don't care
+		// about. The state machine below only sees whitespace and EOL bytes
+		// the options handle, differing bytes and the ends of the buffers.
+		if (!m_wsflag && !(m_ignore_eol_diff && (m_cr0 || m_cr1)))
+		{
+			size_t size = static_cast<size_t>((std::min)(end0 - ptr0, end1 - ptr1));
+			size_t skip = SkipIdenticalBytes(ptr0, ptr1, size, m_stopchars);
+			if (skip > 0)
+			{
+				ptr0 += skip;
+				ptr1 += skip;
+				m_bol0 = m_bol1 = iseolch(ptr0[-1]);
+				m_eol0 = m_eol1 = false;
+			}
+		}
+
 		if (m_ignore_all_space)
 		{
 			// Skip over any whitespace on either side
@@ -53,6 +53,7 @@ private:
 	bool m_ignore_all_space; /**< Ignore all whitespace changes */
 	bool m_ignore_eol_diff; /**< Ignore differences in EOL bytes */
 	bool m_ignore_blank_lines; /**< Ignore blank lines */
+	unsigned m_stopchars; /**< Identical bytes the fast path leaves to the state machine */
 	// state
 	bool m_wsflag; /**< ignore_space_change & in a whitespace area */
 	bool m_eol0; /**< 0-side has an eol */
@@ -7,7 +7,10 @@
 #include "pch.h"
 #include "ByteCompare.h"
 #include <cassert>
+#include <algorithm>
+#include <cstring>
 #include <io.h>
+#include <Poco/SHA1Engine.h>
 #include "FileLocation.h"
 #include "UnicodeString.h"
 #include "IAbortable.h"
@@ -33,6 +36,7 @@ ByteCompare::ByteCompare()
 		: m_pOptions(nullptr)
 		, m_piAbortable(nullptr)
 		, m_inf(nullptr)
+		, m_bDigestsComplete(false)
 {
 }
 
@@ -83,9 +87,64 @@ void ByteCompare::SetFileData(int items, file_data *data)
 	m_inf = data;
 	m_textStats[0].clear();
 	m_textStats[1].clear();
+	m_bDigestsComplete = false;
+	for (auto& pSHA1 : m_pSHA1)
+	{
+		if (pSHA1 != nullptr)
+			pSHA1->reset();
+	}
+}
+
+/**
+ * @brief Set whether SHA-1 digests of the files are computed while they
+ * are read for comparing.
+ * @param [in] bComputeDigests Do we compute digests.
+ */
+void ByteCompare::SetComputeDigests(bool bComputeDigests)
+{
+	for (auto& pSHA1 : m_pSHA1)
+	{
+		if (!bComputeDigests)
+			pSHA1.reset();
+		else if (pSHA1 == nullptr)
+			pSHA1.reset(new Poco::SHA1Engine());
+	}
+}
+
+/**
+ * @brief Get SHA-1 digest of a compared file.
+ * @param [in] side For which file to return the digest.
+ * @param [out] digest Digest of the file.
+ * @return true if the digest was computed from the whole file.
+ */
+bool ByteCompare::GetDigest(int side, std::vector<unsigned char>& digest)
+{
+	if (!m_bDigestsComplete || m_pSHA1[side] == nullptr)
+		return false;
+	digest = m_pSHA1[side]->digest();
+	return true;
 }
 
 
+/**
+ * @brief Read data of a file, from the diffutils buffer if the whole file
+ * was already read there.
+ * @param [in] inf File data.
+ * @param [in,out] pos Read position in the buffer.
+ * @param [out] buf Buffer for the data.
+ * @param [in] size Size of @p buf.
+ * @return Number of bytes read, -1 on error.
+ */
+static int ReadFileData(const file_data &inf, int64_t &pos, char *buf, unsigned size)
+{
+	if (!inf.preloaded)
+		return _read(inf.desc, buf, size);
+	const int64_t n = (std::min)(static_cast<int64_t>(size), static_cast<int64_t>(inf.buffered_chars) - pos);
+	memcpy(buf, inf.buffer + pos, static_cast<size_t>(n));
+	pos += n;
+	return static_cast<int>(n);
+}
+
 /**
  * @brief Compare two specified files, byte-by-byte
  * @param [in] bStopAfterFirstDiff Stop compare after we find first difference?
@@ -108,6 +167,7 @@ int ByteCompare::CompareFiles(FileLocation *location)
 	// buff[0] has bytes to process from buff[0][bfstart[0]] to buff[0][bfend[0]-1]
 
 	bool eof[2]; // if we've finished file
+	int64_t readpos[2] = {}; // read position in preloaded files
 
 	// initialize our buffer pointers and end of file flags
 	for (i = 0; i < 2; ++i)
@@ -139,9 +199,11 @@ int ByteCompare::CompareFiles(FileLocation *location)
 			{
 				// Assume our blocks are in range of int
 				int space = sizeof(buff[i])/sizeof(buff[i][0]) - (int) bfend[i];
-				int rtn = _read(m_inf[i].desc, &buff[i][bfend[i]], (unsigned)space);
+				int rtn = ReadFileData(m_inf[i], readpos[i], &buff[i][bfend[i]], (unsigned)space);
 				if (rtn == -1)
 					return DIFFCODE::CMPERR;
+				if (m_pSHA1[i] != nullptr)
+					m_pSHA1[i]->update(&buff[i][bfend[i]], rtn);
 				if (rtn < space)
 					eof[i] = true;
 				bfend[i] += rtn;
@@ -255,6 +317,8 @@ int ByteCompare::CompareFiles(FileLocation *location)
 		// then the result is reliable.
 		if (eof[0] && eof[1])
 		{
+			m_bDigestsComplete = m_inf[0].desc != m_inf[1].desc;
+
 			bool bBin0 = (m_textStats[0].nzeros > 0);
 			bool bBin1 = (m_textStats[1].nzeros > 0);
 
@@ -6,8 +6,11 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include "FileTextStats.h"
 
+namespace Poco { class SHA1Engine; }
+
 class CompareOptions;
 class QuickCompareOptions;
 class IAbortable;
@@ -34,12 +37,16 @@ public:
 	void SetFileData(int items, file_data *data);
 	int CompareFiles(FileLocation *location);
 	void GetTextStats(int side, FileTextStats *stats) const;
+	void SetComputeDigests(bool bComputeDigests);
+	bool GetDigest(int side, std::vector<unsigned char>& digest);
 
 private:
 	std::unique_ptr<QuickCompareOptions> m_pOptions; /**< Compare options for diffutils. */
 	IAbortable * m_piAbortable;
 	file_data * m_inf; /**< Compared files data (for diffutils). */
 	FileTextStats m_textStats[2];
+	std::unique_ptr<Poco::SHA1Engine> m_pSHA1[2]; /**< Digests of the read data, if computed */
+	bool m_bDigestsComplete; /**< Were both files read to the end? */
 
 };
 
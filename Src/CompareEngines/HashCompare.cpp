@@ -0,0 +1,278 @@
+/**
+ * @file  HashCompare.cpp
+ *
+ * @brief Implementation file for HashCompare
+ */
+
+#include "pch.h"
+#include "HashCompare.h"
+#include <cstring>
+#include <algorithm>
+#include "DiffItem.h"
+#include "PathContext.h"
+#include "TFile.h"
+#include "FileIdentity.h"
+#include <io.h>
+#include <fcntl.h>
+
+namespace CompareEngines
+{
+
+static const size_t BufferSize = 1024 * 256;
+
+/**
+ * @brief Incremental MurmurHash3 x64/128.
+ * Data can be added in pieces of any size, the result is the same as
+ * hashing all data at once.
+ */
+class Murmur3Hasher
+{
+public:
+	Murmur3Hasher() : m_h1(0), m_h2(0), m_length(0), m_nTail(0) {}
+	void Update(const unsigned char *data, size_t size);
+	void Final(uint64_t hash[2]);
+
+private:
+	static uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+	static uint64_t Fmix(uint64_t k);
+	void Block(const unsigned char *block);
+
+	static const uint64_t C1 = 0x87c37b91114253d5ULL;
+	static const uint64_t C2 = 0x4cf5ad432745937fULL;
+	uint64_t m_h1;
+	uint64_t m_h2;
+	uint64_t m_length;
+	unsigned char m_tail[16]; /**< Bytes not yet hashed as a full block */
+	size_t m_nTail;
+};
+
+uint64_t Murmur3Hasher::Fmix(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb9fe1a85ec53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+void Murmur3Hasher::Block(const unsigned char *block)
+{
+	uint64_t k1, k2;
+	memcpy(&k1, block, sizeof(k1));
+	memcpy(&k2, block + 8, sizeof(k2));
+
+	k1 *= C1; k1 = Rotl(k1, 31); k1 *= C2; m_h1 ^= k1;
+	m_h1 = Rotl(m_h1, 27); m_h1 += m_h2; m_h1 = m_h1 * 5 + 0x52dce729;
+	k2 *= C2; k2 = Rotl(k2, 33); k2 *= C1; m_h2 ^= k2;
+	m_h2 = Rotl(m_h2, 31); m_h2 += m_h1; m_h2 = m_h2 * 5 + 0x38495ab5;
+}
+
+void Murmur3Hasher::Update(const unsigned char *data, size_t size)
+{
+	m_length += size;
+	if (m_nTail > 0)
+	{
+		size_t n = (std::min)(size, sizeof(m_tail) - m_nTail);
+		memcpy(m_tail + m_nTail, data, n);
+		m_nTail += n;
+		data += n;
+		size -= n;
+		if (m_nTail < sizeof(m_tail))
+			return;
+		Block(m_tail);
+		m_nTail = 0;
+	}
+	for (; size >= 16; data += 16, size -= 16)
+		Block(data);
+	memcpy(m_tail, data, size);
+	m_nTail = size;
+}
+
+void Murmur3Hasher::Final(uint64_t hash[2])
+{
+	uint64_t k1 = 0, k2 = 0;
+	const unsigned char *tail = m_tail;
+	switch (m_nTail)
+	{
+	case 15:
+		k2 ^= uint64_t(tail[14]) << 48;
+		[[fallthrough]];
+	case 14:
+		k2 ^= uint64_t(tail[13]) << 40;
+		[[fallthrough]];
+	case 13:
+		k2 ^= uint64_t(tail[12]) << 32;
+		[[fallthrough]];
+	case 12:
+		k2 ^= uint64_t(tail[11]) << 24;
+		[[fallthrough]];
+	case 11:
+		k2 ^= uint64_t(tail[10]) << 16;
+		[[fallthrough]];
+	case 10:
+		k2 ^= uint64_t(tail[9]) << 8;
+		[[fallthrough]];
+	case 9:
+		k2 ^= uint64_t(tail[8]);
+		k2 *= C2; k2 = Rotl(k2, 33); k2 *= C1; m_h2 ^= k2;
+		[[fallthrough]];
+	case 8:
+		k1 ^= uint64_t(tail[7]) << 56;
+		[[fallthrough]];
+	case 7:
+		k1 ^= uint64_t(tail[6]) << 48;
+		[[fallthrough]];
+	case 6:
+		k1 ^= uint64_t(tail[5]) << 40;
+		[[fallthrough]];
+	case 5:
+		k1 ^= uint64_t(tail[4]) << 32;
+		[[fallthrough]];
+	case 4:
+		k1 ^= uint64_t(tail[3]) << 24;
+		[[fallthrough]];
+	case 3:
+		k1 ^= uint64_t(tail[2]) << 16;
+		[[fallthrough]];
+	case 2:
+		k1 ^= uint64_t(tail[1]) << 8;
+		[[fallthrough]];
+	case 1:
+		k1 ^= uint64_t(tail[0]);
+		k1 *= C1; k1 = Rotl(k1, 31); k1 *= C2; m_h1 ^= k1;
+	}
+
+	m_h1 ^= m_length;
+	m_h2 ^= m_length;
+	m_h1 += m_h2;
+	m_h2 += m_h1;
+	m_h1 = Fmix(m_h1);
+	m_h2 = Fmix(m_h2);
+	m_h1 += m_h2;
+	m_h2 += m_h1;
+	hash[0] = m_h1;
+	hash[1] = m_h2;
+}
+
+HashCompare::HashCompare()
+: m_buffer(new char[BufferSize])
+{
+}
+
+HashCompare::~HashCompare()
+{
+}
+
+/**
+ * @brief Read a file once and compute the hash of its contents.
+ * @param [in] file Path of the file.
+ * @param [out] hash 128-bit hash of the contents.
+ * @return false if the file could not be read.
+ */
+bool HashCompare::HashFile(const String& file, uint64_t hash[2])
+{
+	int fd = -1;
+	_tsopen_s(&fd, TFile(file).wpath().c_str(), O_BINARY | O_RDONLY | O_SEQUENTIAL, _SH_DENYNO, _S_IREAD);
+	if (fd == -1)
+		return false;
+	const bool bRead = HashFile(fd, hash);
+	_close(fd);
+	return bRead;
+}
+
+/**
+ * @brief Read an opened file and compute the hash of its contents.
+ * @param [in] fd Descriptor of the file, read to its end.
+ * @param [out] hash 128-bit hash of the contents.
+ * @return false if the file could not be read.
+ */
+bool HashCompare::HashFile(int fd, uint64_t hash[2])
+{
+	Murmur3Hasher hasher;
+	int size;
+	while ((size = _read(fd, m_buffer.get(), BufferSize)) > 0)
+		hasher.Update(reinterpret_cast<const unsigned char *>(m_buffer.get()), size);
+	if (size < 0)
+		return false;
+	hasher.Final(hash);
+	// Zero means "not computed"
+	if (hash[0] == 0 && hash[1] == 0)
+		hash[0] = 1;
+	return true;
+}
+
+/**
+ * @brief Compare files by hashes of their contents.
+ * The hash of every existing file is stored to @p di. All files are opened
+ * first, and a file whose data another opened file has too (a hard link,
+ * or a reflink on Linux) is not read again.
+ * @param [in] files Paths of the files.
+ * @param [in,out] di Diffitem info.
+ * @return DIFFCODE
+ */
+int HashCompare::CompareFiles(const PathContext& files, DIFFITEM &di)
+{
+	const int nFiles = files.GetSize();
+	bool bExistAll = true;
+	bool bRead = true;
+	int fds[3] = { -1, -1, -1 };
+	for (int i = 0; i < nFiles && bRead; ++i)
+	{
+		if (!di.diffcode.exists(i))
+		{
+			bExistAll = false;
+			continue;
+		}
+		_tsopen_s(&fds[i], TFile(files[i]).wpath().c_str(), O_BINARY | O_RDONLY | O_SEQUENTIAL, _SH_DENYNO, _S_IREAD);
+		bRead = fds[i] != -1;
+	}
+	for (int i = 0; i < nFiles && bRead; ++i)
+	{
+		if (fds[i] == -1)
+			continue;
+		uint64_t *hash = di.diffFileInfo[i].GetDetailsRef().m_contentHash;
+		int j;
+		for (j = 0; j < i; ++j)
+		{
+			if (fds[j] != -1 && FileIdentity::Compare(fds[j], fds[i]) != FileIdentity::UNKNOWN)
+				break;
+		}
+		if (j < i)
+			std::copy_n(di.diffFileInfo[j].GetDetails().m_contentHash, 2, hash);
+		else
+			bRead = HashFile(fds[i], hash);
+	}
+	for (int i = 0; i < nFiles; ++i)
+	{
+		if (fds[i] != -1)
+			_close(fds[i]);
+	}
+	if (!bRead)
+		return DIFFCODE::CMPERR;
+	if (!bExistAll)
+		return DIFFCODE::DIFF;
+
+	auto equal = [&di](int i, int j) {
+		const uint64_t *hash1 = di.diffFileInfo[i].GetDetails().m_contentHash;
+		const uint64_t *hash2 = di.diffFileInfo[j].GetDetails().m_contentHash;
+		return di.diffFileInfo[i].size == di.diffFileInfo[j].size &&
+			hash1[0] == hash2[0] && hash1[1] == hash2[1];
+	};
+	if (nFiles == 2)
+		return equal(0, 1) ? DIFFCODE::SAME : DIFFCODE::DIFF;
+
+	const bool bSame10 = equal(1, 0);
+	const bool bSame12 = equal(1, 2);
+	if (bSame10 && bSame12)
+		return DIFFCODE::SAME;
+	if (bSame10)
+		return DIFFCODE::DIFF | DIFFCODE::DIFF3RDONLY;
+	if (bSame12)
+		return DIFFCODE::DIFF | DIFFCODE::DIFF1STONLY;
+	if (equal(0, 2))
+		return DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY;
+	return DIFFCODE::DIFF;
+}
+
+} // namespace CompareEngines
@@ -0,0 +1,39 @@
+/**
+ * @file  HashCompare.h
+ *
+ * @brief Declaration file for HashCompare compare engine.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "UnicodeString.h"
+
+class DIFFITEM;
+class PathContext;
+
+namespace CompareEngines
+{
+
+/**
+ * @brief A compare class comparing hashes of file contents.
+ * Every file is read once and its 128-bit hash (MurmurHash3 x64/128) is
+ * stored to the DIFFITEM. Files are considered identical if their hashes
+ * are equal. In 3-way compare each file is read once instead of once per
+ * compared pair.
+ */
+class HashCompare
+{
+public:
+	HashCompare();
+	~HashCompare();
+	int CompareFiles(const PathContext& files, DIFFITEM &di);
+	bool HashFile(const String& file, uint64_t hash[2]);
+
+private:
+	bool HashFile(int fd, uint64_t hash[2]);
+
+	std::unique_ptr<char[]> m_buffer; /**< Read buffer, reused for all files */
+};
+
+} // namespace CompareEngines
@@ -0,0 +1,158 @@
+/**
+ * @file  MemCompare.cpp
+ *
+ * @brief Implementation of vectorized memory compare helpers.
+ */
+
+#include "pch.h"
+#include "MemCompare.h"
+#include <cstring>
+#include <cstdint>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define MEMCOMPARE_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace CompareEngines
+{
+
+#ifdef MEMCOMPARE_SSE2
+/** @brief Index of the lowest set bit, @p mask must not be zero. */
+static inline unsigned LowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/**
+ * @brief Find the offset of the first differing byte of two buffers.
+ * Compares 64 bytes per iteration with SSE2 and locates the differing byte
+ * within the block from the compare mask.
+ * @return Offset of the first difference, @p size if the buffers are equal.
+ */
+size_t FindFirstDifference(const void *p1, const void *p2, size_t size)
+{
+	const unsigned char *b1 = static_cast<const unsigned char *>(p1);
+	const unsigned char *b2 = static_cast<const unsigned char *>(p2);
+	size_t i = 0;
+#ifdef MEMCOMPARE_SSE2
+	for (; i + 64 <= size; i += 64)
+	{
+		__m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b1 + i)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(b2 + i)));
+		__m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b1 + i + 16)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(b2 + i + 16)));
+		__m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b1 + i + 32)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(b2 + i + 32)));
+		__m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b1 + i + 48)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(b2 + i + 48)));
+		__m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+		if (_mm_movemask_epi8(all) != 0xffff)
+		{
+			unsigned mask;
+			if ((mask = _mm_movemask_epi8(e0) ^ 0xffff) != 0)
+				return i + LowestBit(mask);
+			if ((mask = _mm_movemask_epi8(e1) ^ 0xffff) != 0)
+				return i + 16 + LowestBit(mask);
+			if ((mask = _mm_movemask_epi8(e2) ^ 0xffff) != 0)
+				return i + 32 + LowestBit(mask);
+			mask = _mm_movemask_epi8(e3) ^ 0xffff;
+			return i + 48 + LowestBit(mask);
+		}
+	}
+	for (; i + 16 <= size; i += 16)
+	{
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(b1 + i)),
+			_mm_loadu_si128(reinterpret_cast<const __m128i *>(b2 + i)))) ^ 0xffff;
+		if (mask != 0)
+			return i + LowestBit(mask);
+	}
+#else
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t w1, w2;
+		memcpy(&w1, b1 + i, sizeof(w1));
+		memcpy(&w2, b2 + i, sizeof(w2));
+		if (w1 != w2)
+			break;
+	}
+#endif
+	for (; i < size; ++i)
+	{
+		if (b1[i] != b2[i])
+			return i;
+	}
+	return size;
+}
+
+/**
+ * @brief Return true if SkipIdenticalBytes() must stop at the byte.
+ */
+static inline bool IsStopChar(unsigned char ch, unsigned stopChars)
+{
+	if ((stopChars & STOP_AT_SPACE) && (ch == ' ' || ch == '\t'))
+		return true;
+	if ((stopChars & STOP_AT_EOL) && (ch == '\r' || ch == '\n'))
+		return true;
+	return false;
+}
+
+/**
+ * @brief Count identical bytes at the beginning of two buffers.
+ * Compares 32 bytes per iteration with SSE2. The count ends at the first
+ * differing byte or at the first byte of the classes given in
+ * @p stopChars, whichever comes first.
+ * @param [in] stopChars Combination of STOP_AT_SPACE and STOP_AT_EOL.
+ * @return Number of identical bytes which are not stop chars.
+ */
+size_t SkipIdenticalBytes(const void *p1, const void *p2, size_t size, unsigned stopChars)
+{
+	const unsigned char *b1 = static_cast<const unsigned char *>(p1);
+	const unsigned char *b2 = static_cast<const unsigned char *>(p2);
+	size_t i = 0;
+#ifdef MEMCOMPARE_SSE2
+	const bool bSpace = (stopChars & STOP_AT_SPACE) != 0;
+	const bool bEol = (stopChars & STOP_AT_EOL) != 0;
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	for (; i + 32 <= size; i += 32)
+	{
+		__m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b1 + i));
+		__m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b1 + i + 16));
+		__m128i ok0 = _mm_cmpeq_epi8(a0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(b2 + i)));
+		__m128i ok1 = _mm_cmpeq_epi8(a1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(b2 + i + 16)));
+		// The bytes are equal where it matters, so only the first buffer
+		// needs to be checked for stop chars
+		if (bSpace)
+		{
+			ok0 = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(a0, space), _mm_cmpeq_epi8(a0, tab)), ok0);
+			ok1 = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(a1, space), _mm_cmpeq_epi8(a1, tab)), ok1);
+		}
+		if (bEol)
+		{
+			ok0 = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(a0, cr), _mm_cmpeq_epi8(a0, lf)), ok0);
+			ok1 = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi8(a1, cr), _mm_cmpeq_epi8(a1, lf)), ok1);
+		}
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(ok0)) |
+			(static_cast<unsigned>(_mm_movemask_epi8(ok1)) << 16);
+		if (mask != 0xffffffffu)
+			return i + LowestBit(~mask);
+	}
+#endif
+	for (; i < size; ++i)
+	{
+		if (b1[i] != b2[i] || IsStopChar(b1[i], stopChars))
+			return i;
+	}
+	return size;
+}
+
+} // namespace CompareEngines
@@ -0,0 +1,23 @@
+/**
+ * @file  MemCompare.h
+ *
+ * @brief Declaration of vectorized memory compare helpers.
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace CompareEngines
+{
+
+/** @brief Bytes SkipIdenticalBytes() stops at even if identical. */
+enum
+{
+	STOP_AT_SPACE = 1, /**< Space and tab */
+	STOP_AT_EOL = 2, /**< CR and LF */
+};
+
+size_t FindFirstDifference(const void *p1, const void *p2, size_t size);
+size_t SkipIdenticalBytes(const void *p1, const void *p2, size_t size, unsigned stopChars);
+
+} // namespace CompareEngines
@@ -0,0 +1,129 @@
+/**
+ * @file  NWayCompare.cpp
+ *
+ * @brief Implementation file for NWayCompare
+ */
+
+#include "pch.h"
+#include "NWayCompare.h"
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include "TFile.h"
+#include <io.h>
+#include <fcntl.h>
+
+namespace CompareEngines
+{
+
+NWayCompare::NWayCompare()
+: m_nFiles(0)
+, m_class{}
+{
+}
+
+NWayCompare::~NWayCompare()
+{
+}
+
+/**
+ * @brief Read the whole file, retrying short reads.
+ * @param [in] fd Descriptor of the file.
+ * @param [in] length Size of the file.
+ * @param [out] data Contents of the file, shorter if the file shrank.
+ * @return false on error.
+ */
+static bool ReadWholeFile(int fd, __int64 length, std::vector<char> &data)
+{
+	if (static_cast<uint64_t>(length) > SIZE_MAX / 2)
+		return false;
+	data.resize(static_cast<size_t>(length));
+	size_t total = 0;
+	while (total < data.size())
+	{
+		const unsigned chunk = static_cast<unsigned>((std::min)(data.size() - total, static_cast<size_t>(INT_MAX)));
+		int size = _read(fd, data.data() + total, chunk);
+		if (size < 0)
+			return false;
+		if (size == 0)
+			break;
+		total += size;
+	}
+	data.resize(total);
+	return true;
+}
+
+/**
+ * @brief Read the files once and find out which of them are identical.
+ * The files are read one after the other, and their contents are kept
+ * until ClearData() or the next compare.
+ * @param [in] files Paths of the files.
+ * @param [in] nFiles Number of files, at most MAX_FILES.
+ * @return false if a file could not be read.
+ */
+bool NWayCompare::CompareFiles(const String files[], int nFiles)
+{
+	ClearData();
+	m_nFiles = nFiles;
+	bool bResult = true;
+	for (int i = 0; i < nFiles && bResult; ++i)
+	{
+		m_class[i] = i;
+		m_textStats[i].clear();
+		int fd = -1;
+		_tsopen_s(&fd, TFile(files[i]).wpath().c_str(), O_BINARY | O_RDONLY | O_SEQUENTIAL, _SH_DENYNO, _S_IREAD);
+		if (fd == -1)
+		{
+			bResult = false;
+			break;
+		}
+		const __int64 length = _filelengthi64(fd);
+		bResult = length >= 0 && ReadWholeFile(fd, length, m_data[i]);
+		_close(fd);
+	}
+	if (!bResult)
+	{
+		ClearData();
+		return false;
+	}
+
+	for (int i = 0; i < nFiles; ++i)
+	{
+		if (m_textStats[i].Scan(m_data[i].data(), m_data[i].size(), false))
+			++m_textStats[i].ncrs;
+		for (int j = 0; j < i; ++j)
+		{
+			if (m_data[j] == m_data[i])
+			{
+				m_class[i] = m_class[j];
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Return true if all files are identical.
+ */
+bool NWayCompare::IsAllIdentical() const
+{
+	for (int i = 1; i < m_nFiles; ++i)
+	{
+		if (m_class[i] != m_class[0])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Free the contents of the files read by CompareFiles().
+ * The classes and the text stats are kept.
+ */
+void NWayCompare::ClearData()
+{
+	for (int i = 0; i < MAX_FILES; ++i)
+		std::vector<char>().swap(m_data[i]);
+}
+
+} // namespace CompareEngines
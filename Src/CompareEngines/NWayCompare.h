@@ -0,0 +1,45 @@
+/**
+ * @file  NWayCompare.h
+ *
+ * @brief Declaration file for NWayCompare compare engine.
+ */
+#pragma once
+
+#include <vector>
+#include "UnicodeString.h"
+#include "FileTextStats.h"
+
+namespace CompareEngines
+{
+
+/**
+ * @brief Reads the files of a 3-way compare once and finds identical files.
+ * Each file is read whole to memory once and the files are split into
+ * classes of byte-identical files. The pairwise compares of a 3-way compare
+ * then only need to be run for pairs of files in different classes, the
+ * results of the other pairs follow from them, and the pairs are compared
+ * from the data kept here instead of reading the files again.
+ */
+class NWayCompare
+{
+public:
+	enum { MAX_FILES = 3 };
+
+	NWayCompare();
+	~NWayCompare();
+	bool CompareFiles(const String files[], int nFiles);
+	bool IsIdentical(int i, int j) const { return m_class[i] == m_class[j]; }
+	bool IsAllIdentical() const;
+	const FileTextStats& GetTextStats(int i) const { return m_textStats[i]; }
+	const char *GetData(int i) const { return m_data[i].data(); }
+	size_t GetDataSize(int i) const { return m_data[i].size(); }
+	void ClearData();
+
+private:
+	int m_nFiles;
+	int m_class[MAX_FILES]; /**< Index of the first file identical to the file */
+	FileTextStats m_textStats[MAX_FILES];
+	std::vector<char> m_data[MAX_FILES]; /**< Whole contents of the files */
+};
+
+} // namespace CompareEngines
@@ -21,6 +21,8 @@
 #include "DiffWrapper.h"
 #include "FilterCommentsManager.h"
 #include "unicoder.h"
+#include "xdiff_gnudiff_compat.h"
+#include "DiffAlgorithmSelector.h"
 
 namespace CompareEngines
 {
@@ -37,6 +39,7 @@ DiffUtils::DiffUtils()
 		, m_ndiffs(0)
 		, m_ntrivialdiffs(0)
 		, m_codepage(0)
+		, m_diffAlgorithm(-1)
 {
 }
 
@@ -279,8 +282,8 @@ bool DiffUtils::RegExpFilter(int StartPos, int EndPos, const file_data *pinf) co
 
 	while (line <= EndPos && linesMatch)
 	{
-		size_t len = pinf->linbuf[line + 1] - pinf->linbuf[line];
-		const char *string = pinf->linbuf[line];
+		const char *string = LINE_START(pinf, line);
+		size_t len = LINE_START(pinf, line + 1) - string;
 		size_t stringlen = linelen(string, len);
 		if (!m_pFilterList->Match(std::string(string, stringlen), m_codepage))
 		{
@@ -296,7 +299,9 @@ bool DiffUtils::RegExpFilter(int StartPos, int EndPos, const file_data *pinf) co
  *
  * Compare two files (in DiffFileData param) using diffutils. Run diffutils
  * inside SEH so we can trap possible error and exceptions. If error or
- * execption is trapped, return compare failure.
+ * execption is trapped, return compare failure. When the diff algorithm is
+ * DIFF_ALGORITHM_AUTO, the algorithm is chosen for the files and they may
+ * be compared with xdiff instead.
  * @param [out] diffs Pointer to list of change structs where diffdata is stored.
  * @param [in] depth Depth in folder compare (we use 0).
  * @param [out] bin_status used to return binary status from compare.
@@ -308,13 +313,29 @@ bool DiffUtils::RegExpFilter(int StartPos, int EndPos, const file_data *pinf) co
  * @return `true` when compare succeeds, `false` if error happened during compare.
  */
 bool DiffUtils::Diff2Files(struct change ** diffs, int depth,
-		int * bin_status, bool bMovedBlocks, int * bin_file) const
+		int * bin_status, bool bMovedBlocks, int * bin_file)
 {
 	bool bRet = true;
 	SE_Handler seh;
 	try
 	{
-		*diffs = diff_2_files(m_inf, depth, bin_status, bMovedBlocks, bin_file);
+		// Other algorithms are compared by diffutils in folder compare
+		DiffAlgorithm algorithm = DIFF_ALGORITHM_DEFAULT;
+		m_diffAlgorithm = -1;
+		if (m_pOptions->m_diffAlgorithm == DIFF_ALGORITHM_AUTO)
+		{
+			algorithm = DiffAlgorithmSelector::Select(m_inf);
+			m_diffAlgorithm = algorithm;
+		}
+		if (algorithm != DIFF_ALGORITHM_DEFAULT)
+		{
+			*diffs = diff_2_files_xdiff(m_inf, bin_status, bMovedBlocks, bin_file,
+				make_xdl_flags(*m_pOptions, algorithm));
+			files[0] = m_inf[0];
+			files[1] = m_inf[1];
+		}
+		else
+			*diffs = diff_2_files(m_inf, depth, bin_status, bMovedBlocks, bin_file);
 	}
 	catch (SE_Exception&)
 	{
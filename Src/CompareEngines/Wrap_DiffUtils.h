@@ -41,7 +41,8 @@ public:
 	void GetDiffCounts(int & diffs, int & trivialDiffs) const;
 	void GetTextStats(int side, FileTextStats *stats) const;
 	bool Diff2Files(struct change ** diffs, int depth,
-			int * bin_status, bool bMovedBlocks, int * bin_file) const;
+			int * bin_status, bool bMovedBlocks, int * bin_file);
+	int GetDiffAlgorithm() const { return m_diffAlgorithm; }
 	void SetCodepage(int codepage) { m_codepage = codepage; }
 
 private:
@@ -51,6 +52,7 @@ private:
 	int m_ndiffs; /**< Real diffs found. */
 	int m_ntrivialdiffs; /**< Ignored diffs found. */
 	int m_codepage; /**< Codepage used in line filter */
+	int m_diffAlgorithm; /**< DiffAlgorithm chosen for the last compare, -1 if not chosen automatically */
 	std::unique_ptr<CDiffWrapper> m_pDiffWrapper;
 };
 
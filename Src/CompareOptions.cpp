@@ -88,6 +88,9 @@ void CompareOptions::SetFromDiffOptions(const DIFFOPTIONS &options)
 	case 3:
 		m_diffAlgorithm = DIFF_ALGORITHM_HISTOGRAM;
 		break;
+	case 4:
+		m_diffAlgorithm = DIFF_ALGORITHM_AUTO;
+		break;
 	default:
 		throw "Unknown diff algorithm value!";
 		break;
@@ -205,6 +208,7 @@ void DiffutilsOptions::SetToDiffUtils()
 	always_text_flag = 0; // diffutils needs to detect binary files
 	horizon_lines = 0;
 	heuristic = 1;
+	no_discards = 0; // DIFF_ALGORITHM_AUTO may change these three for each compare
 	recursive = 0;
 }
 
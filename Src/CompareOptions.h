@@ -32,6 +32,7 @@ enum DiffAlgorithm
 	DIFF_ALGORITHM_MINIMAL = 1,
 	DIFF_ALGORITHM_PATIENCE = 2,
 	DIFF_ALGORITHM_HISTOGRAM = 3,
+	DIFF_ALGORITHM_AUTO = 4,
 };
 
 /**
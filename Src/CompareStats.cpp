@@ -17,6 +17,9 @@
 CompareStats::CompareStats(int nDirs)
 : m_nTotalItems(0)
 , m_nComparedItems(0)
+, m_nSameFileHits(0)
+, m_nSharedExtentsHits(0)
+, m_nSizeDiffHits(0)
 , m_state(STATE_IDLE)
 , m_bCompareDone(false)
 , m_nDirs(nDirs)
@@ -82,6 +85,9 @@ void CompareStats::Reset()
 	SetCompareState(STATE_IDLE);
 	m_nTotalItems = 0;
 	m_nComparedItems = 0;
+	m_nSameFileHits = 0;
+	m_nSharedExtentsHits = 0;
+	m_nSizeDiffHits = 0;
 	m_bCompareDone = false;
 }
 
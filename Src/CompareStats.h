@@ -92,11 +92,20 @@ public:
 	CompareStats::RESULT GetResultFromCode(unsigned diffcode) const;
 	void Swap(int idx1, int idx2);
 	int GetCompareDirs() const { return m_nDirs; }
+	void AddSameFileHit() { ++m_nSameFileHits; }
+	void AddSharedExtentsHit() { ++m_nSharedExtentsHits; }
+	void AddSizeDiffHit() { ++m_nSizeDiffHits; }
+	int GetSameFileHits() const { return m_nSameFileHits; }
+	int GetSharedExtentsHits() const { return m_nSharedExtentsHits; }
+	int GetSizeDiffHits() const { return m_nSizeDiffHits; }
 
 private:
 	std::array<std::atomic_int, RESULT_COUNT> m_counts; /**< Table storing result counts */
 	std::atomic_int m_nTotalItems; /**< Total items found to compare */
 	std::atomic_int m_nComparedItems; /**< Compared items so far */
+	std::atomic_int m_nSameFileHits; /**< Files found identical because they are the same file */
+	std::atomic_int m_nSharedExtentsHits; /**< Files found identical because they share their data blocks */
+	std::atomic_int m_nSizeDiffHits; /**< Files found different because their sizes differ */
 	CMP_STATE m_state; /**< State for compare (idle, collect, compare,..) */
 	bool m_bCompareDone; /**< Have we finished last compare? */
 	int m_nDirs; /**< number of directories to compare */
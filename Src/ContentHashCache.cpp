@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  ContentHashCache.cpp
+ *
+ * @brief Implementation of ContentHashCache class.
+ */
+
+#include "pch.h"
+#include "ContentHashCache.h"
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/SharedMemory.h>
+#include <Poco/NamedMutex.h>
+#include <Poco/MD5Engine.h>
+#include <Poco/SHA1Engine.h>
+#include "TFile.h"
+#include "paths.h"
+#include "unicoder.h"
+#include "DebugNew.h"
+
+using Poco::SharedMemory;
+using Poco::DigestEngine;
+
+static const char CacheMagic[8] = { 'W', 'M', 'H', 'A', 'S', 'H', 'C', 0 };
+static const uint32_t CacheVersion = 1;
+static const char CacheMutexName[] = "WinMerge.ContentHashCache";
+
+/**
+ * @brief Header at the start of the cache file.
+ */
+struct ContentHashCache::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t nBuckets;
+	std::atomic<uint32_t> clock; /**< Incremented by every Open() */
+	uint32_t reserved;
+};
+
+/**
+ * @brief Contents of one entry of the cache file.
+ */
+struct SlotData
+{
+	uint64_t pathKey[2]; /**< MD5 of the normalized path, 0 for empty entry */
+	uint64_t size;
+	int64_t mtime;
+	uint64_t optionsHash;
+	unsigned char digest[ContentHashEntry::DIGEST_SIZE];
+	int32_t codepage;
+	uint8_t unicoding;
+	uint8_t bom;
+	uint8_t padding[6];
+	int64_t ncrs;
+	int64_t nlfs;
+	int64_t ncrlfs;
+	int64_t nzeros;
+};
+
+/**
+ * @brief One entry of the cache file.
+ * The contents are copied word by word with atomic accesses, so readers
+ * racing with a writer see a changed sequence counter instead of a data race.
+ */
+struct ContentHashCache::Slot
+{
+	enum { WORDS = sizeof(SlotData) / sizeof(uint64_t) };
+	std::atomic<uint32_t> seq; /**< Odd while the entry is being written */
+	std::atomic<uint32_t> lastUsed; /**< Clock value when entry was last used */
+	std::atomic<uint64_t> words[WORDS]; /**< SlotData of the entry */
+
+	bool HasKey(const uint64_t key[2]) const
+	{
+		return words[0].load(std::memory_order_relaxed) == key[0] &&
+			words[1].load(std::memory_order_relaxed) == key[1];
+	}
+
+	void Load(SlotData& data) const
+	{
+		uint64_t buf[WORDS];
+		for (int i = 0; i < WORDS; ++i)
+			buf[i] = words[i].load(std::memory_order_relaxed);
+		memcpy(&data, buf, sizeof(data));
+	}
+
+	void Store(const SlotData& data)
+	{
+		uint64_t buf[WORDS];
+		memcpy(buf, &data, sizeof(data));
+		for (int i = 0; i < WORDS; ++i)
+			words[i].store(buf[i], std::memory_order_relaxed);
+	}
+};
+static_assert(sizeof(SlotData) % sizeof(uint64_t) == 0, "SlotData must consist of whole words");
+
+ContentHashCache::ContentHashCache()
+: m_pHeader(nullptr)
+, m_pBuckets(nullptr)
+, m_nBuckets(0)
+, m_nClock(0)
+{
+}
+
+ContentHashCache::~ContentHashCache()
+{
+	Close();
+}
+
+/**
+ * @brief Map the cache file, creating or resetting it if needed.
+ * @param [in] sCacheFile Path of the cache file.
+ * @param [in] nBuckets Number of buckets in the cache file.
+ * @return true if the cache file could be mapped.
+ */
+bool ContentHashCache::Open(const String& sCacheFile, unsigned nBuckets)
+{
+	Close();
+
+	const size_t nFileSize = sizeof(Header) + sizeof(Slot) * BUCKET_SIZE * nBuckets;
+	Header *pHeader = nullptr;
+	try
+	{
+		// Another instance may be creating or resetting the file just now
+		Poco::NamedMutex mutex(CacheMutexName);
+		Poco::NamedMutex::ScopedLock lock(mutex);
+
+		paths::CreateIfNeeded(paths::GetParentPath(sCacheFile));
+		TFile file(sCacheFile);
+		bool bInit = file.createFile();
+		if (file.getSize() != nFileSize)
+		{
+			file.setSize(nFileSize);
+			bInit = true;
+		}
+		m_pSharedMemory.reset(new SharedMemory(file, SharedMemory::AM_WRITE));
+
+		pHeader = reinterpret_cast<Header *>(m_pSharedMemory->begin());
+		if (bInit || memcmp(pHeader->magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+			pHeader->version != CacheVersion || pHeader->nBuckets != nBuckets)
+		{
+			memset(m_pSharedMemory->begin(), 0, nFileSize);
+			memcpy(pHeader->magic, CacheMagic, sizeof(CacheMagic));
+			pHeader->version = CacheVersion;
+			pHeader->nBuckets = nBuckets;
+		}
+	}
+	catch (...)
+	{
+		m_pSharedMemory.reset();
+		return false;
+	}
+
+	m_pHeader = pHeader;
+	m_pBuckets = reinterpret_cast<Slot *>(m_pSharedMemory->begin() + sizeof(Header));
+	m_nBuckets = nBuckets;
+	m_nClock = ++m_pHeader->clock;
+	return true;
+}
+
+/**
+ * @brief Unmap the cache file.
+ */
+void ContentHashCache::Close()
+{
+	m_pHeader = nullptr;
+	m_pBuckets = nullptr;
+	m_nBuckets = 0;
+	m_pSharedMemory.reset();
+}
+
+/**
+ * @brief Get cached information of a file.
+ * @param [in] sPath Normalized path of the file.
+ * @param [in] size Size of the file.
+ * @param [in] mtime Modification time of the file.
+ * @param [in] optionsHash Hash of the options the information depends on.
+ * @param [out] entry Cached information.
+ * @return true if an up-to-date entry was found.
+ */
+bool ContentHashCache::Lookup(const String& sPath, uint64_t size, int64_t mtime, uint64_t optionsHash, ContentHashEntry& entry)
+{
+	if (!IsOpen())
+		return false;
+	uint64_t key[2];
+	GetPathKey(sPath, key);
+	Slot *pBucket = GetBucket(key);
+	for (int i = 0; i < BUCKET_SIZE; ++i)
+	{
+		Slot &slot = pBucket[i];
+		uint32_t seq = slot.seq.load(std::memory_order_acquire);
+		if ((seq & 1) != 0 || !slot.HasKey(key))
+			continue;
+		SlotData data;
+		slot.Load(data);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) != seq)
+			return false; // Written meanwhile, the copy may be torn
+		if (data.pathKey[0] != key[0] || data.pathKey[1] != key[1] ||
+			data.size != size || data.mtime != mtime || data.optionsHash != optionsHash)
+			return false;
+		memcpy(entry.digest, data.digest, sizeof(entry.digest));
+		entry.encoding.m_codepage = data.codepage;
+		entry.encoding.m_unicoding = static_cast<ucr::UNICODESET>(data.unicoding);
+		entry.encoding.m_bom = data.bom != 0;
+		entry.textStats.ncrs = data.ncrs;
+		entry.textStats.nlfs = data.nlfs;
+		entry.textStats.ncrlfs = data.ncrlfs;
+		entry.textStats.nzeros = data.nzeros;
+		slot.lastUsed.store(m_nClock, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Store information of a file to the cache.
+ * An existing entry of the file is replaced. Otherwise an empty entry or
+ * the least recently used entry of the bucket is used. If another thread
+ * is writing the same entry, the information is not stored.
+ */
+void ContentHashCache::Store(const String& sPath, uint64_t size, int64_t mtime, uint64_t optionsHash, const ContentHashEntry& entry)
+{
+	if (!IsOpen())
+		return;
+	uint64_t key[2];
+	GetPathKey(sPath, key);
+	Slot *pBucket = GetBucket(key);
+	Slot *pVictim = &pBucket[0];
+	for (int i = 0; i < BUCKET_SIZE; ++i)
+	{
+		Slot &slot = pBucket[i];
+		if (slot.HasKey(key))
+		{
+			pVictim = &slot;
+			break;
+		}
+		if (slot.lastUsed.load(std::memory_order_relaxed) < pVictim->lastUsed.load(std::memory_order_relaxed))
+			pVictim = &slot;
+	}
+
+	Slot &slot = *pVictim;
+	uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+	if ((seq & 1) != 0 || !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire))
+		return;
+	SlotData data = {};
+	data.pathKey[0] = key[0];
+	data.pathKey[1] = key[1];
+	data.size = size;
+	data.mtime = mtime;
+	data.optionsHash = optionsHash;
+	memcpy(data.digest, entry.digest, sizeof(data.digest));
+	data.codepage = entry.encoding.m_codepage;
+	data.unicoding = static_cast<uint8_t>(entry.encoding.m_unicoding);
+	data.bom = entry.encoding.m_bom ? 1 : 0;
+	data.ncrs = entry.textStats.ncrs;
+	data.nlfs = entry.textStats.nlfs;
+	data.ncrlfs = entry.textStats.ncrlfs;
+	data.nzeros = entry.textStats.nzeros;
+	slot.Store(data);
+	slot.lastUsed.store(m_nClock, std::memory_order_relaxed);
+	slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+/**
+ * @brief Compute the content hash of file data the compare has read.
+ * Only the digest of @p entry is set.
+ */
+void ContentHashCache::ComputeDigest(const char *data, size_t size, ContentHashEntry& entry)
+{
+	Poco::SHA1Engine sha1;
+	sha1.update(data, static_cast<unsigned>(size));
+	const DigestEngine::Digest& digest = sha1.digest();
+	std::copy(digest.begin(), digest.end(), entry.digest);
+}
+
+/**
+ * @brief Compute the key of a path.
+ * Paths are compared case-insensitively as on Windows file systems.
+ */
+void ContentHashCache::GetPathKey(const String& sPath, uint64_t key[2])
+{
+	Poco::MD5Engine md5;
+	md5.update(ucr::toUTF8(strutils::makelower(sPath)));
+	const DigestEngine::Digest& digest = md5.digest();
+	memcpy(key, digest.data(), sizeof(uint64_t) * 2);
+	if (key[0] == 0 && key[1] == 0)
+		key[0] = 1; // 0 marks an empty entry
+}
+
+ContentHashCache::Slot *ContentHashCache::GetBucket(const uint64_t key[2]) const
+{
+	return &m_pBuckets[(key[0] % m_nBuckets) * BUCKET_SIZE];
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  ContentHashCache.h
+ *
+ * @brief Declaration of ContentHashCache class.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "UnicodeString.h"
+#include "FileTextStats.h"
+#include "FileTextEncoding.h"
+
+namespace Poco { class SharedMemory; }
+
+/**
+ * @brief Cached information about the contents of one file.
+ */
+struct ContentHashEntry
+{
+	enum { DIGEST_SIZE = 20 };
+	unsigned char digest[DIGEST_SIZE]; /**< SHA-1 of the file contents */
+	FileTextStats textStats; /**< EOL and zero-byte counts of the file */
+	FileTextEncoding encoding; /**< Guessed encoding of the file */
+};
+
+/**
+ * @brief Persistent cache of file content hashes for folder compare.
+ *
+ * The cache is a fixed-size file mapped into memory. It is organized as a
+ * hash table of buckets holding BUCKET_SIZE entries each. An entry is found
+ * by the hash of the normalized file path and is valid only if the size,
+ * modification time and options hash stored with it still match. When a
+ * bucket is full the least recently used entry is replaced.
+ *
+ * Entries are protected with a sequence counter: writers make the counter
+ * odd while they update an entry, and readers take the entry as a miss if
+ * the counter changed while they copied it. Entries are read and written
+ * as atomic words, so any number of compare threads, and other WinMerge
+ * instances mapping the same file, can read and update the cache without
+ * a lock. Only creating or resetting the file is serialized between
+ * instances with a named mutex.
+ *
+ * The cache doesn't read files itself: digests are computed by the compare
+ * from the data it reads anyway.
+ */
+class ContentHashCache
+{
+public:
+	enum { BUCKET_SIZE = 8, DEFAULT_BUCKETS = 16384 };
+
+	ContentHashCache();
+	~ContentHashCache();
+	bool Open(const String& sCacheFile, unsigned nBuckets = DEFAULT_BUCKETS);
+	void Close();
+	bool IsOpen() const { return m_pBuckets != nullptr; }
+	bool Lookup(const String& sPath, uint64_t size, int64_t mtime, uint64_t optionsHash, ContentHashEntry& entry);
+	void Store(const String& sPath, uint64_t size, int64_t mtime, uint64_t optionsHash, const ContentHashEntry& entry);
+
+	static void ComputeDigest(const char *data, size_t size, ContentHashEntry& entry);
+
+private:
+	struct Header;
+	struct Slot;
+	static void GetPathKey(const String& sPath, uint64_t key[2]);
+	Slot *GetBucket(const uint64_t key[2]) const;
+
+	std::unique_ptr<Poco::SharedMemory> m_pSharedMemory;
+	Header *m_pHeader;
+	Slot *m_pBuckets;
+	unsigned m_nBuckets;
+	uint32_t m_nClock; /**< Use count stored to entries found or stored in this session */
+};
@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  DeviceIoLimiter.cpp
+ *
+ * @brief Implementation of DeviceIoLimiter class.
+ */
+
+#include "pch.h"
+#include "DeviceIoLimiter.h"
+#include <cassert>
+#ifdef _WIN32
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <cstdio>
+#include <climits>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+#endif
+#include "DiffItem.h"
+#include "PathContext.h"
+#include "unicoder.h"
+#include "DebugNew.h"
+
+/**
+ * @brief Group the compared folders by disk and create the read slots.
+ * @param [in] paths Compared folders.
+ * @param [in] nReadersPerDevice Readers allowed per disk, 0 for one reader
+ * on rotational disks and no limit on other devices.
+ */
+DeviceIoLimiter::DeviceIoLimiter(const PathContext& paths, int nReadersPerDevice)
+: m_nSides(paths.GetSize())
+, m_sideDevice{}
+{
+	assert(m_nSides <= 3);
+	for (int nSide = 0; nSide < m_nSides; ++nSide)
+	{
+		const DeviceInfo info = GetDeviceInfo(paths[nSide]);
+		int nDevice = 0;
+		// Disks that are not known are not shared with other sides
+		while (nDevice < GetDeviceCount() && (info.id.empty() || m_devices[nDevice].id != info.id))
+			++nDevice;
+		if (nDevice == GetDeviceCount())
+		{
+			m_devices.emplace_back();
+			m_devices.back().id = info.id;
+			if (nReadersPerDevice > 0)
+				m_devices.back().pSemaphore.reset(new Poco::Semaphore(nReadersPerDevice));
+			else if (nReadersPerDevice == 0 && info.bRotational)
+				m_devices.back().pSemaphore.reset(new Poco::Semaphore(1));
+		}
+		m_sideDevice[nSide] = nDevice;
+	}
+}
+
+DeviceIoLimiter::~DeviceIoLimiter()
+{
+}
+
+/**
+ * @brief Take a read slot on every limited disk the item is read from.
+ * Blocks until the slots are available.
+ * @param [in] di Item to compare.
+ * @return Devices to pass to Release().
+ */
+unsigned DeviceIoLimiter::Acquire(const DIFFITEM &di)
+{
+	unsigned devices = 0;
+	if (di.diffcode.isDirectory())
+		return devices;
+	for (int nSide = 0; nSide < m_nSides; ++nSide)
+	{
+		if (di.diffcode.exists(nSide) && m_devices[m_sideDevice[nSide]].pSemaphore != nullptr)
+			devices |= 1u << m_sideDevice[nSide];
+	}
+	// Slots are taken in device order so workers can't wait for each other
+	for (int nDevice = 0; nDevice < GetDeviceCount(); ++nDevice)
+	{
+		if (devices & (1u << nDevice))
+			m_devices[nDevice].pSemaphore->wait();
+	}
+	return devices;
+}
+
+/**
+ * @brief Give back the read slots taken by Acquire().
+ * @param [in] devices Return value of Acquire().
+ */
+void DeviceIoLimiter::Release(unsigned devices)
+{
+	for (int nDevice = 0; nDevice < GetDeviceCount(); ++nDevice)
+	{
+		if (devices & (1u << nDevice))
+			m_devices[nDevice].pSemaphore->set();
+	}
+}
+
+/**
+ * @brief Take the read slots of the item, unless they are held already.
+ * Blocks until the slots are available.
+ */
+void DeviceIoSlots::Acquire()
+{
+	if (m_bHeld)
+		return;
+	m_devices = m_pIoLimiter != nullptr ? m_pIoLimiter->Acquire(m_di) : 0;
+	m_bHeld = true;
+}
+
+/**
+ * @brief Give back the read slots of the item, if they are held.
+ */
+void DeviceIoSlots::Release()
+{
+	if (!m_bHeld)
+		return;
+	if (m_devices != 0)
+		m_pIoLimiter->Release(m_devices);
+	m_devices = 0;
+	m_bHeld = false;
+}
+
+#ifdef _WIN32
+
+/** @brief DEVICE_SEEK_PENALTY_DESCRIPTOR, not declared for the Windows versions WinMerge targets */
+struct SeekPenaltyDescriptor
+{
+	DWORD Version;
+	DWORD Size;
+	BOOLEAN IncursSeekPenalty;
+};
+
+/** @brief StorageDeviceSeekPenaltyProperty value of STORAGE_PROPERTY_ID */
+static const int SeekPenaltyProperty = 7;
+
+/**
+ * @brief Find the physical disk a path is on.
+ * Volumes are identified by the disk they are on, so partitions of one
+ * disk are one device. Volumes spanning several disks and volumes whose
+ * disk is not known are devices of their own. Windows versions before
+ * Windows 7 don't report the seek penalty, disks are then not rotational.
+ * @param [in] path Path of a folder.
+ */
+DeviceIoLimiter::DeviceInfo DeviceIoLimiter::GetDeviceInfo(const String& path)
+{
+	DeviceInfo info = { String(), false };
+	TCHAR volumePath[MAX_PATH];
+	TCHAR volumeName[MAX_PATH];
+	if (!GetVolumePathName(path.c_str(), volumePath, MAX_PATH) ||
+		!GetVolumeNameForVolumeMountPoint(volumePath, volumeName, MAX_PATH))
+		return info;
+
+	// "\\?\Volume{GUID}" without the trailing backslash opens the volume
+	String volume = volumeName;
+	if (!volume.empty() && volume.back() == '\\')
+		volume.pop_back();
+	info.id = volume;
+	HANDLE hVolume = CreateFile(volume.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+	if (hVolume == INVALID_HANDLE_VALUE)
+		return info;
+	VOLUME_DISK_EXTENTS extents;
+	DWORD dwBytes = 0;
+	if (DeviceIoControl(hVolume, IOCTL_VOLUME_GET_VOLUME_DISK_EXTENTS, nullptr, 0, &extents, sizeof(extents), &dwBytes, nullptr) &&
+		extents.NumberOfDiskExtents == 1)
+	{
+		info.id = strutils::format(_T("\\\\.\\PhysicalDrive%u"), static_cast<unsigned>(extents.Extents[0].DiskNumber));
+	}
+	STORAGE_PROPERTY_QUERY query = {};
+	query.PropertyId = static_cast<STORAGE_PROPERTY_ID>(SeekPenaltyProperty);
+	query.QueryType = PropertyStandardQuery;
+	SeekPenaltyDescriptor seekPenalty = {};
+	if (DeviceIoControl(hVolume, IOCTL_STORAGE_QUERY_PROPERTY, &query, sizeof(query), &seekPenalty, sizeof(seekPenalty), &dwBytes, nullptr) &&
+		dwBytes >= sizeof(seekPenalty))
+	{
+		info.bRotational = seekPenalty.IncursSeekPenalty != FALSE;
+	}
+	CloseHandle(hVolume);
+	return info;
+}
+
+#else
+
+/**
+ * @brief Find the physical disk a path is on.
+ * On Linux the disk is found in sysfs, so partitions of one disk are one
+ * device, and the rotational flag of its queue tells if it has a seek
+ * penalty. Elsewhere devices are identified by the device number and are
+ * not rotational.
+ * @param [in] path Path of a folder.
+ */
+DeviceIoLimiter::DeviceInfo DeviceIoLimiter::GetDeviceInfo(const String& path)
+{
+	DeviceInfo info = { String(), false };
+	struct stat st;
+	if (stat(ucr::toUTF8(path).c_str(), &st) != 0)
+		return info;
+	info.id = strutils::format(_T("%u:%u"), static_cast<unsigned>(major(st.st_dev)), static_cast<unsigned>(minor(st.st_dev)));
+#ifdef __linux__
+	char sysPath[64];
+	snprintf(sysPath, sizeof(sysPath), "/sys/dev/block/%u:%u", static_cast<unsigned>(major(st.st_dev)), static_cast<unsigned>(minor(st.st_dev)));
+	char realPath[PATH_MAX];
+	if (realpath(sysPath, realPath) == nullptr)
+		return info;
+	std::string disk = realPath;
+	// Partitions are subdirectories of their disk
+	if (access((disk + "/partition").c_str(), F_OK) == 0)
+		disk.erase(disk.rfind('/'));
+	info.id = ucr::toTString(disk);
+	if (FILE *fp = fopen((disk + "/queue/rotational").c_str(), "r"))
+	{
+		info.bRotational = fgetc(fp) == '1';
+		fclose(fp);
+	}
+#endif
+	return info;
+}
+
+#endif
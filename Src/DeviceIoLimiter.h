@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  DeviceIoLimiter.h
+ *
+ * @brief Declaration of DeviceIoLimiter class.
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Semaphore.h>
+#include "UnicodeString.h"
+
+class PathContext;
+class DIFFITEM;
+
+/**
+ * @brief Limits the number of compare workers reading from one disk.
+ *
+ * The number of compare workers is chosen for the CPU. When all of them
+ * read from a rotational disk at the same time, the disk spends its time
+ * seeking between the files. The compared folders are grouped by the
+ * physical disk they are on, so folders on the same disk share one limit.
+ * While opening and reading the files of an item a worker holds a read
+ * slot on every limited disk the item is read from, taken always in the
+ * same order. The slots are given back before the data read is compared
+ * (see DeviceIoSlots).
+ *
+ * With zero readers per device, rotational disks get one reader and other
+ * devices are not limited.
+ */
+class DeviceIoLimiter
+{
+public:
+	/** @brief Physical disk a path is on. */
+	struct DeviceInfo
+	{
+		String id; /**< Identifies the disk, empty if not known */
+		bool bRotational; /**< Disk has a seek penalty */
+	};
+
+	DeviceIoLimiter(const PathContext& paths, int nReadersPerDevice);
+	~DeviceIoLimiter();
+	DeviceIoLimiter(const DeviceIoLimiter&) = delete;
+	DeviceIoLimiter& operator=(const DeviceIoLimiter&) = delete;
+
+	unsigned Acquire(const DIFFITEM &di);
+	void Release(unsigned devices);
+	int GetDeviceCount() const { return static_cast<int>(m_devices.size()); }
+	int GetDeviceIndex(int nSide) const { return m_sideDevice[nSide]; }
+	bool IsLimited(int nSide) const { return m_devices[m_sideDevice[nSide]].pSemaphore != nullptr; }
+
+	static DeviceInfo GetDeviceInfo(const String& path);
+
+private:
+	struct Device
+	{
+		String id;
+		std::unique_ptr<Poco::Semaphore> pSemaphore; /**< Read slots, nullptr if not limited */
+	};
+
+	std::vector<Device> m_devices;
+	int m_nSides; /**< Number of compared folders */
+	int m_sideDevice[3]; /**< Index of the device of each side in m_devices */
+};
+
+/**
+ * @brief Read slots of the files of one item.
+ * The slots are taken by Acquire() before the files are opened or read and
+ * given back by Release() before the data read is compared, at the latest
+ * when going out of scope. Acquire() does nothing while the slots are held.
+ */
+class DeviceIoSlots
+{
+public:
+	DeviceIoSlots(DeviceIoLimiter *pIoLimiter, const DIFFITEM &di)
+	: m_pIoLimiter(pIoLimiter), m_di(di), m_devices(0), m_bHeld(false) {}
+	~DeviceIoSlots() { Release(); }
+	DeviceIoSlots(const DeviceIoSlots&) = delete;
+	DeviceIoSlots& operator=(const DeviceIoSlots&) = delete;
+
+	void Acquire();
+	void Release();
+	bool IsHeld() const { return m_bHeld; }
+
+private:
+	DeviceIoLimiter *m_pIoLimiter; /**< Limiter of the compare, nullptr if not limited */
+	const DIFFITEM &m_di;
+	unsigned m_devices; /**< Return value of DeviceIoLimiter::Acquire() */
+	bool m_bHeld;
+};
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  DiffAlgorithmSelector.cpp
+ *
+ * @brief Implementation of the automatic choice of the diff algorithm.
+ *
+ * The start of both files is sampled from the buffers the compare reads
+ * them to: the line counts are estimated from the file sizes, and the lines
+ * of the sample are hashed to see how many of them are repeated. Small files are compared
+ * exactly by diffutils. Large files with many repeated lines, like logs and
+ * generated code, are compared with the histogram algorithm of xdiff, which
+ * only matches lines occurring rarely, where Myers would search long.
+ */
+
+#include "pch.h"
+#include "diff.h"
+#include "DiffAlgorithmSelector.h"
+#include <algorithm>
+#include <vector>
+#include <sys/stat.h>
+#include "LineHash.h"
+#include "DebugNew.h"
+
+namespace DiffAlgorithmSelector
+{
+
+namespace
+{
+
+/** @brief Bytes sampled from the start of each buffer. */
+const size_t SampleSize = 1024 * 1024;
+
+/** @brief Files with up to this many lines together are compared exactly. */
+const int64_t SmallLines = 4000;
+
+/** @brief Files with less lines together are always compared by diffutils. */
+const int64_t LargeLines = 20000;
+
+/** @brief Percentage of unique lines below which a file has many repeated lines. */
+const size_t MinUniquePercent = 50;
+
+/**
+ * @brief Hash the lines of the sample of a file.
+ * @param [in] data Start of the file.
+ * @param [in] len Length of the sample.
+ * @param [in] bWholeFile Whether the sample is the whole file. Otherwise
+ * the last line of the sample may be incomplete, and isn't hashed.
+ * @param [in,out] hashes The hashes of the lines are added here.
+ * @return Length of the sample up to the end of its last hashed line.
+ */
+size_t HashLines(const char *data, size_t len, bool bWholeFile, std::vector<unsigned>& hashes)
+{
+	const unsigned char *start = reinterpret_cast<const unsigned char *>(data);
+	const unsigned char *end = start + len;
+	const LineHashFunc hash = GetLineHashFunc(0);
+	const unsigned char *p = start;
+	while (p < end)
+	{
+		const unsigned char *eol = FindLineEnd(p, end);
+		if (eol == end && !bWholeFile)
+			break;
+		hashes.push_back(hash(p, eol, nullptr));
+		p = eol + 1;
+	}
+	return (std::min)(p, end) - start;
+}
+
+}
+
+/**
+ * @brief Sample the shape of two opened files.
+ * The files are not read here, only the data already read into their
+ * buffers is sampled (see DiffFileData::ReadFiles()). A file without a
+ * buffer counts as an empty one.
+ * @param [in] filevec Opened files.
+ * @return Sizes, line counts and repeated lines of the files.
+ */
+InputShape Sample(file_data filevec[])
+{
+	InputShape shape = {};
+	std::vector<unsigned> hashes;
+	for (int i = 0; i < 2; ++i)
+	{
+		const file_data &inf = filevec[i];
+		// A file compared with itself
+		if (i == 1 && inf.desc == filevec[0].desc)
+		{
+			shape.size[1] = shape.size[0];
+			shape.lines[1] = shape.lines[0];
+			break;
+		}
+		if (inf.desc <= 0 || !S_ISREG(inf.stat.st_mode) || inf.buffer == nullptr)
+			continue;
+		shape.size[i] = inf.stat.st_size;
+		const char *data = inf.buffer;
+		const size_t len = (std::min)(static_cast<size_t>(inf.buffered_chars), SampleSize);
+		const bool bWholeFile = static_cast<int64_t>(len) >= shape.size[i];
+		const size_t first = hashes.size();
+		const size_t used = HashLines(data, len, bWholeFile, hashes);
+		const size_t nLines = hashes.size() - first;
+		if (bWholeFile)
+			shape.lines[i] = nLines;
+		else if (used > 0)
+			shape.lines[i] = static_cast<int64_t>(static_cast<double>(nLines) * shape.size[i] / used);
+		else
+			shape.lines[i] = 1; // One line longer than the sample
+		// Lines repeated within each file, not lines common to both files
+		std::sort(hashes.begin() + first, hashes.end());
+		shape.uniqueLines += std::unique(hashes.begin() + first, hashes.end()) - (hashes.begin() + first);
+		shape.sampledLines += nLines;
+	}
+	return shape;
+}
+
+/**
+ * @brief Choose the engine and the diffutils heuristics for files of a shape.
+ * @param [in] shape Shape of the files, see Sample().
+ * @return Chosen algorithm and heuristics.
+ */
+Choice Choose(const InputShape& shape)
+{
+	Choice choice = { DIFF_ALGORITHM_DEFAULT, false, 0 };
+	const int64_t lines = shape.lines[0] + shape.lines[1];
+	if (lines <= SmallLines)
+	{
+		// Finding the shortest script is cheap, and the identical lines
+		// kept around the differences let them be placed better
+		choice.bMinimal = true;
+		choice.nHorizonLines = static_cast<int>(SmallLines);
+	}
+	else if (lines >= LargeLines && shape.sampledLines > 0 &&
+		shape.uniqueLines * 100 < shape.sampledLines * MinUniquePercent &&
+		shape.size[0] <= INT32_MAX && shape.size[1] <= INT32_MAX)
+	{
+		// xdiff compares files up to 2 GB
+		choice.algorithm = DIFF_ALGORITHM_HISTOGRAM;
+	}
+	return choice;
+}
+
+/**
+ * @brief Set the diffutils heuristics of a choice to diffutils globals.
+ * @param [in] choice Choice made by Choose().
+ */
+void SetToDiffUtils(const Choice& choice)
+{
+	no_discards = choice.bMinimal ? 1 : 0;
+	heuristic = choice.bMinimal ? 0 : 1;
+	horizon_lines = choice.nHorizonLines;
+}
+
+/**
+ * @brief Choose the algorithm for comparing two opened files.
+ * The diffutils heuristics are set for the files too.
+ * @param [in] filevec Opened files, read into their buffers.
+ * @return Algorithm to compare the files with.
+ */
+DiffAlgorithm Select(file_data filevec[])
+{
+	const Choice choice = Choose(Sample(filevec));
+	SetToDiffUtils(choice);
+	return choice.algorithm;
+}
+
+/**
+ * @brief Get the name of an algorithm, as shown in the compare options.
+ * @param [in] algorithm Algorithm.
+ * @return Untranslated name.
+ */
+const char *GetName(DiffAlgorithm algorithm)
+{
+	switch (algorithm)
+	{
+	case DIFF_ALGORITHM_MINIMAL:
+		return "minimal";
+	case DIFF_ALGORITHM_PATIENCE:
+		return "patience";
+	case DIFF_ALGORITHM_HISTOGRAM:
+		return "histogram";
+	case DIFF_ALGORITHM_AUTO:
+		return "auto";
+	default:
+		return "default";
+	}
+}
+
+}
@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  DiffAlgorithmSelector.h
+ *
+ * @brief Declaration of the automatic choice of the diff algorithm.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "CompareOptions.h"
+
+struct file_data;
+
+namespace DiffAlgorithmSelector
+{
+
+/**
+ * @brief Shape of two compared files, see Sample().
+ */
+struct InputShape
+{
+	int64_t size[2];     /**< File sizes in bytes */
+	int64_t lines[2];    /**< Line counts, estimated from the sample for large files */
+	size_t sampledLines; /**< Lines hashed from the starts of both files */
+	size_t uniqueLines;  /**< Different lines among the sampled ones */
+};
+
+/**
+ * @brief Engine and diffutils heuristics chosen for DIFF_ALGORITHM_AUTO.
+ */
+struct Choice
+{
+	DiffAlgorithm algorithm; /**< DIFF_ALGORITHM_DEFAULT for diffutils, otherwise an xdiff algorithm */
+	bool bMinimal;           /**< diffutils: keep the confusing lines and don't stop the search early */
+	int nHorizonLines;       /**< diffutils: lines of the identical prefix and suffix kept */
+};
+
+InputShape Sample(file_data filevec[]);
+Choice Choose(const InputShape& shape);
+void SetToDiffUtils(const Choice& choice);
+DiffAlgorithm Select(file_data filevec[]);
+const char *GetName(DiffAlgorithm algorithm);
+
+}
@@ -41,6 +41,7 @@ CDiffContext::CDiffContext(const PathContext & paths, int compareMethod)
 , m_nCompMethod(compareMethod)
 , m_bIgnoreSmallTimeDiff(false)
 , m_pCompareStats(nullptr)
+, m_pContentHashCache(nullptr)
 , m_piAbortable(nullptr)
 , m_bStopAfterFirstDiff(false)
 , m_pFilterList(nullptr)
@@ -49,6 +50,7 @@ CDiffContext::CDiffContext(const PathContext & paths, int compareMethod)
 , m_pOptions(nullptr)
 , m_bPluginsEnabled(false)
 , m_bRecursive(false)
+, m_bCaseSensitive(false)
 , m_bWalkUniques(true)
 , m_bIgnoreReparsePoints(false)
 , m_bIgnoreCodepage(false)
@@ -101,10 +103,28 @@ bool CDiffContext::UpdateInfoFromDiskHalf(DIFFITEM &di, int nIndex)
 	if (!dfi.Update(filepath))
 		return false;
 	UpdateVersion(di, nIndex);
-	dfi.encoding = GuessCodepageEncoding(filepath, m_iGuessEncodingType);
+	dfi.GetDetailsRef().encoding = GuessCodepageEncoding(filepath, m_iGuessEncodingType);
 	return true;
 }
 
+/**
+ * @brief Update file information for DIFFITEM from a folder listing.
+ * Same as UpdateInfoFromDiskHalf() for a file known to exist, but the
+ * times, size and attributes are taken from an entry read by
+ * LoadAndSortFiles() so the file is not queried again.
+ * @param [in, out] di DIFFITEM to update.
+ * @param [in] nIndex index to update
+ * @param [in] ent Listing entry of the file.
+ */
+void CDiffContext::UpdateInfoFromDirItem(DIFFITEM &di, int nIndex, const DirItem &ent)
+{
+	String filepath = paths::ConcatPath(paths::ConcatPath(m_paths[nIndex], di.diffFileInfo[nIndex].path), di.diffFileInfo[nIndex].filename);
+	DiffFileInfo & dfi = di.diffFileInfo[nIndex];
+	dfi.Update(ent);
+	UpdateVersion(di, nIndex);
+	dfi.GetDetailsRef().encoding = GuessCodepageEncoding(filepath, m_iGuessEncodingType);
+}
+
 /**
  * @brief Determine if file is one to have a version information.
  * This function determines if the given file has a version information
@@ -137,7 +157,7 @@ void CDiffContext::UpdateVersion(DIFFITEM &di, int nIndex) const
 {
 	DiffFileInfo & dfi = di.diffFileInfo[nIndex];
 	// Check only binary files
-	dfi.version.SetFileVersionNone();
+	dfi.GetDetailsRef().version.SetFileVersionNone();
 
 	if (di.diffcode.isDirectory())
 		return;
@@ -156,7 +176,7 @@ void CDiffContext::UpdateVersion(DIFFITEM &di, int nIndex) const
 	unsigned verMS = 0;
 	unsigned verLS = 0;
 	if (ver.GetFixedFileVersion(verMS, verLS))
-		dfi.version.SetFileVersion(verMS, verLS);
+		dfi.GetDetailsRef().version.SetFileVersion(verMS, verLS);
 }
 
 /**
@@ -181,10 +201,10 @@ bool CDiffContext::CreateCompareOptions(int compareMethod, const DIFFOPTIONS & o
 	m_nCompMethod = compareMethod;
 	if (GetCompareOptions(m_nCompMethod) == nullptr)
 	{
-		// For Date and Date+Size compare `nullptr` is ok since they don't have actual
+		// For Date, Date+Size and Hash compare `nullptr` is ok since they don't have actual
 		// compare options.
 		if (m_nCompMethod == CMP_DATE || m_nCompMethod == CMP_DATE_SIZE ||
-			m_nCompMethod == CMP_SIZE)
+			m_nCompMethod == CMP_SIZE || m_nCompMethod == CMP_HASH)
 		{
 			return true;
 		}
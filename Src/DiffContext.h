@@ -10,12 +10,14 @@
 #include <memory>
 #include "PathContext.h"
 #include "DiffItemList.h"
+#include "StringPool.h"
 #include "FilterList.h"
 
 class PackingInfo;
 class PrediffingInfo;
 class IDiffFilter;
 class CompareStats;
+class ContentHashCache;
 class IAbortable;
 class CDiffWrapper;
 class CompareOptions;
@@ -106,6 +108,7 @@ public:
 
 	// change an existing difference
 	bool UpdateInfoFromDiskHalf(DIFFITEM &di, int nIndex);
+	void UpdateInfoFromDirItem(DIFFITEM &di, int nIndex, const DirItem &ent);
 	void UpdateStatusFromDisk(DIFFITEM *diffpos, int nIndex);
 
 	bool CreateCompareOptions(int compareMethod, const DIFFOPTIONS & options);
@@ -158,6 +161,8 @@ public:
 
 	bool m_bIgnoreSmallTimeDiff; /**< Ignore small timedifferences when comparing by date */
 	CompareStats *m_pCompareStats; /**< Pointer to compare statistics */
+	ContentHashCache *m_pContentHashCache; /**< Persistent content hashes, nullptr if not used */
+	mutable StringPool m_stringPool; /**< Names and paths of the items, freed with the context */
 
 	/**
 	 * Optimize compare by stopping after first difference.
@@ -193,6 +198,7 @@ public:
 	double m_dColorDistanceThreshold;
 
 	bool m_bRecursive; /**< Do we include subfolders to compare? */
+	bool m_bCaseSensitive; /**< Are filenames matched case sensitively? */
 	bool m_bPluginsEnabled; /**< Are plugins enabled? */
 	std::unique_ptr<FilterList> m_pFilterList; /**< Filter list for line filters */
 	FilterCommentsManager *m_pFilterCommentsManager;
@@ -10,6 +10,9 @@
 #include "DiffFileData.h"
 #include <io.h>
 #include <memory>
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include "DiffItem.h"
 #include "FileLocation.h"
 #include "diff.h"
@@ -25,6 +28,7 @@
 DiffFileData::DiffFileData()
 : m_inf(new file_data[2]{})
 , m_used(false)
+, m_bSequentialScan(false)
 {
 	Reset();
 }
@@ -47,6 +51,22 @@ bool DiffFileData::OpenFiles(const String& szFilepath1, const String& szFilepath
 	return b;
 }
 
+/**
+ * @brief Use the first opened file for both sides.
+ * Called when both files were found to have the same data, so that the
+ * data is read only once, as when the same path is opened twice.
+ */
+void DiffFileData::ShareFirstFile()
+{
+	if (m_inf[1].desc == m_inf[0].desc)
+		return;
+	if (m_inf[1].desc > 0)
+		_close(m_inf[1].desc);
+	m_inf[1].desc = m_inf[0].desc;
+	m_inf[1].stat = m_inf[0].stat;
+	m_FileLocation[1].setPath(m_FileLocation[0].filepath);
+}
+
 /** @brief stash away true names for display, before opening files */
 void DiffFileData::SetDisplayFilepaths(const String& szTrueFilepath1, const String& szTrueFilepath2)
 {
@@ -76,7 +96,7 @@ bool DiffFileData::DoOpenFiles()
 		if (m_inf[i].desc == 0)
 		{
 			_tsopen_s(&m_inf[i].desc, TFile(m_FileLocation[i].filepath).wpath().c_str(),
-					O_RDONLY | O_BINARY, _SH_DENYNO, _S_IREAD);
+					O_RDONLY | O_BINARY | (m_bSequentialScan ? O_SEQUENTIAL : 0), _SH_DENYNO, _S_IREAD);
 		}
 		if (m_inf[i].desc < 0)
 			return false;
@@ -98,6 +118,76 @@ bool DiffFileData::DoOpenFiles()
 	return true;
 }
 
+/**
+ * @brief Read the whole contents of the opened files to diffutils buffers.
+ * Diffutils and ByteCompare then use the buffers instead of reading the
+ * files again, and the caller can guess the encodings from the same data.
+ * The files are read to heap buffers even if they are large enough to be
+ * mapped by diffutils (see MAP_MIN_SIZE).
+ * @return false if reading a file failed.
+ */
+bool DiffFileData::ReadFiles()
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		file_data &inf = m_inf[i];
+		// The second file shares the buffer of the first one (see read_files())
+		if (i == 1 && inf.desc == m_inf[0].desc)
+			break;
+		if (inf.desc <= 0 || !S_ISREG(inf.stat.st_mode) || inf.buffer != nullptr)
+			continue;
+		if (inf.stat.st_size < 0 || static_cast<uint64_t>(inf.stat.st_size) > SIZE_MAX / 2)
+			return false;
+		const size_t size = static_cast<size_t>(inf.stat.st_size);
+		// Leave room for the newline and the sentinel appended by diffutils
+		inf.bufsize = size + sizeof(unsigned) + 1;
+		inf.buffer = static_cast<char *>(malloc(inf.bufsize));
+		if (inf.buffer == nullptr)
+			return false;
+		inf.buffered_chars = 0;
+		while (inf.buffered_chars < size)
+		{
+			const unsigned chunk = static_cast<unsigned>((std::min)(size - inf.buffered_chars, static_cast<size_t>(INT_MAX)));
+			const int cc = _read(inf.desc, inf.buffer + inf.buffered_chars, chunk);
+			if (cc < 0)
+				return false;
+			if (cc == 0)
+				break;
+			inf.buffered_chars += cc;
+		}
+		inf.preloaded = 1;
+	}
+	return true;
+}
+
+/**
+ * @brief Copy the contents of an opened file read already to its diffutils buffer.
+ * The buffer is then used like one filled by ReadFiles(), without reading
+ * the file again. Files not opened, or read already, are left as they are.
+ * @param [in] i Index of the file, 0 or 1.
+ * @param [in] data Whole contents of the file.
+ * @param [in] size Size of @p data.
+ * @return false if out of memory.
+ */
+bool DiffFileData::SetFileData(int i, const char *data, size_t size)
+{
+	file_data &inf = m_inf[i];
+	// The second file shares the buffer of the first one (see read_files())
+	if (i == 1 && inf.desc == m_inf[0].desc)
+		return true;
+	if (inf.desc <= 0 || !S_ISREG(inf.stat.st_mode) || inf.buffer != nullptr)
+		return true;
+	// Leave room for the newline and the sentinel appended by diffutils
+	inf.bufsize = size + sizeof(unsigned) + 1;
+	inf.buffer = static_cast<char *>(malloc(inf.bufsize));
+	if (inf.buffer == nullptr)
+		return false;
+	memcpy(inf.buffer, data, size);
+	inf.buffered_chars = size;
+	inf.preloaded = 1;
+	return true;
+}
+
 /** @brief Clear inf structure to pristine */
 void DiffFileData::Reset()
 {
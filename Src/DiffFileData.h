@@ -29,9 +29,13 @@ struct DiffFileData
 	~DiffFileData();
 
 	bool OpenFiles(const String& szFilepath1, const String& szFilepath2);
+	bool ReadFiles();
+	bool SetFileData(int i, const char *data, size_t size);
+	void ShareFirstFile();
 	void Reset();
 	void Close() { Reset(); }
 	void SetDisplayFilepaths(const String& szTrueFilepath1, const String& szTrueFilepath2);
+	void SetSequentialScan(bool bSequentialScan) { m_bSequentialScan = bSequentialScan; }
 
 	bool Filepath_Transform(bool bForceUTF8, const FileTextEncoding & encoding, const String & filepath, String & filepathTransformed,
 		const String& filteredFilenames, PrediffingInfo * infoPrediffer);
@@ -46,4 +50,6 @@ struct DiffFileData
 
 private:
 	bool DoOpenFiles();
+
+	bool m_bSequentialScan; /**< Files are opened for reading from start to end */
 };
@@ -9,12 +9,39 @@
 #include "DiffFileInfo.h"
 #include "DebugNew.h"
 
+const DiffFileDetails DiffFileInfo::emptyDetails;
+
+DiffFileInfo::DiffFileInfo(const DiffFileInfo& src)
+	: DirItem(src)
+	, m_pDetails(src.m_pDetails ? new DiffFileDetails(*src.m_pDetails) : nullptr)
+{
+}
+
+DiffFileInfo& DiffFileInfo::operator=(const DiffFileInfo& src)
+{
+	if (this != &src)
+	{
+		DirItem::operator=(src);
+		m_pDetails.reset(src.m_pDetails ? new DiffFileDetails(*src.m_pDetails) : nullptr);
+	}
+	return *this;
+}
+
+/**
+ * @brief Return details for modifying them, allocating them if needed.
+ */
+DiffFileDetails& DiffFileInfo::GetDetailsRef()
+{
+	if (!m_pDetails)
+		m_pDetails.reset(new DiffFileDetails);
+	return *m_pDetails;
+}
+
 /**
  * @brief Clears FileInfo data.
  */
 void DiffFileInfo::ClearPartial()
 {
 	DirItem::ClearPartial();
-	encoding.Clear();
-	m_textStats.clear();
+	m_pDetails.reset();
 }
@@ -6,31 +6,57 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include "DirItem.h"
+#include "FileVersion.h"
 #include "FileTextEncoding.h"
 #include "FileTextStats.h"
 
 /**
- * @brief Information for file.
- * This class expands DirItem class with encoding information and
- * text stats information.
- * @sa DirItem.
+ * @brief Rarely used information for file.
+ * Only set for files whose contents were compared or whose version was
+ * asked for, so it is kept out of DiffFileInfo and allocated on demand.
  */
-struct DiffFileInfo : public DirItem
+struct DiffFileDetails
 {
-// data
+	FileVersion version; /**< string of fixed file version, eg, 1.2.3.4 */
 	FileTextEncoding encoding; /**< unicode or codepage info */
 	FileTextStats m_textStats; /**< EOL, zero-byte etc counts */
+	uint64_t m_contentHash[2]; /**< 128-bit hash of contents computed by CMP_HASH, zero if not computed */
 
-	// We could stash a pointer here to the parent DIFFITEM
-	// but, I ran into trouble with, I think, the DIFFITEM copy constructor
+	DiffFileDetails() : m_contentHash{} { }
+};
 
+/**
+ * @brief Information for file.
+ * This class expands DirItem class with encoding information and
+ * text stats information. Those are stored in a DiffFileDetails
+ * allocated when one of them is first set; until then GetDetails()
+ * returns default values.
+ * @sa DirItem.
+ */
+struct DiffFileInfo : public DirItem
+{
 // methods
 
 	DiffFileInfo() { }
+	DiffFileInfo(const DiffFileInfo& src);
+	DiffFileInfo(DiffFileInfo&& src) = default;
+	DiffFileInfo& operator=(const DiffFileInfo& src);
+	DiffFileInfo& operator=(DiffFileInfo&& src) = default;
 	//void Clear();
 	void ClearPartial();
+	const DiffFileDetails& GetDetails() const { return m_pDetails ? *m_pDetails : emptyDetails; }
+	DiffFileDetails& GetDetailsRef();
+	bool HasDetails() const { return m_pDetails != nullptr; }
 	bool IsEditableEncoding() const;
+	bool HasContentHash() const { return GetDetails().m_contentHash[0] != 0 || GetDetails().m_contentHash[1] != 0; }
+	void ClearContentHash() { if (m_pDetails) m_pDetails->m_contentHash[0] = m_pDetails->m_contentHash[1] = 0; }
+
+private:
+	std::unique_ptr<DiffFileDetails> m_pDetails; /**< `nullptr` until a detail is set */
+	static const DiffFileDetails emptyDetails; /**< Default values returned by GetDetails() */
 };
 
 /**
@@ -38,5 +64,5 @@ struct DiffFileInfo : public DirItem
  */
 inline bool DiffFileInfo::IsEditableEncoding() const
 {
-	return !encoding.m_bom;
+	return !GetDetails().encoding.m_bom;
 }
@@ -11,13 +11,6 @@
 
 DIFFITEM DIFFITEM::emptyitem;
 
-/** @brief DIFFITEM's destructor */
-DIFFITEM::~DIFFITEM()
-{
-	RemoveChildren();
-	assert(children == nullptr);
-}
-
 /** @brief Return path to left/right file, including all but file name */
 String DIFFITEM::getFilepath(int nIndex, const String &sRoot) const
 {
@@ -52,20 +45,6 @@ bool DIFFITEM::IsAncestor(const DIFFITEM *pdi) const
 	return false;
 }
 
-/** @brief Remove and delete all children DIFFITEM entries */
-void DIFFITEM::RemoveChildren()
-{
-	DIFFITEM *pRem = children;
-	while (pRem != nullptr)
-	{
-		assert(pRem->parent == this);
-		DIFFITEM *pNext = pRem->Flink;
-		delete pRem;
-		pRem = pNext;
-	}
-	children = nullptr;
-}
-
 /** @brief Swap two items in `diffFileInfo[]`.  Used when swapping GUI panes. */
 void DIFFITEM::Swap(int idx1, int idx2)
 {
@@ -213,6 +213,9 @@ enum ViewCustomFlags
 //			(i.e. each folder comparison window in the GUI).  The "root" item exists to anchor the 
 //			tree, as well as to guarantee that the `parent` and `children` linkage is correct at the 
 //			top folder comparison level.
+//		F. The items of a tree are allocated and freed by its DiffItemList, see
+//			DiffItemList::AddNewDiff() and DiffItemList::RemoveDiff().  Destroying an item
+//			does not delete its children.
 //
 //
 // Sometimes a picture is worth many words...
@@ -252,6 +255,8 @@ public:
 									// (see `DirColInfo` arrays in `DirViewColItems.cpp`) *>
 	DIFFCODE diffcode;				/**< Compare result */
 	unsigned customFlags;			/**< ViewCustomFlags flags */
+	int64_t firstDiffOffset;		/**< Offset of the first differing byte found by binary compare, -1 if unknown */
+	int diffAlgorithm;				/**< DiffAlgorithm chosen for the files by text compare, -1 if not chosen automatically */
 
 	String getFilepath(int nIndex, const String &sRoot) const;
 	void Swap(int idx1, int idx2);
@@ -270,7 +275,6 @@ private:							// Don't allow direct external manipulation of link values
 public:
 	void DelinkFromSiblings();
 	void AddChildToParent(DIFFITEM *p);
-	void RemoveChildren();
 	int GetDepth() const;
 	bool IsAncestor(const DIFFITEM *pdi) const;
 	inline DIFFITEM *GetFwdSiblingLink() const { return Flink; }
@@ -293,9 +297,9 @@ public:
 //**** CTOR, DTOR
 public:
 	DIFFITEM() : parent(nullptr), children(nullptr), Flink(nullptr), Blink(nullptr), 
-					nidiffs(-1), nsdiffs(-1), customFlags(ViewCustomFlags::INVALID_CODE) 
+					nidiffs(-1), nsdiffs(-1), customFlags(ViewCustomFlags::INVALID_CODE), firstDiffOffset(-1),
+					diffAlgorithm(-1)
 					// `DiffFileInfo` and `DIFFCODE` have their own initializers. 
 					{}
-	~DIFFITEM();
 
 };
@@ -7,12 +7,25 @@
 #include "pch.h"
 #include "DiffItemList.h"
 #include <cassert>
+#include <new>
+
+// Wrap placement new and operator new to avoid the need to temporarily #undef new
+static DIFFITEM *ConstructItem(void *p)
+{
+	return new(p) DIFFITEM;
+}
+
+static DIFFITEM *AllocateSlab(size_t nItems)
+{
+	return static_cast<DIFFITEM *>(::operator new(sizeof(DIFFITEM) * nItems));
+}
+
 #include "DebugNew.h"
 
 /**
  * @brief Constructor
  */
-DiffItemList::DiffItemList() : m_pRoot(nullptr)
+DiffItemList::DiffItemList() : m_pRoot(nullptr), m_nSlabUsed(SlabSize)
 {
 }
 
@@ -31,7 +44,7 @@ DiffItemList::~DiffItemList()
  */
 DIFFITEM *DiffItemList::AddNewDiff(DIFFITEM *par)
 {
-	DIFFITEM *p = new DIFFITEM;
+	DIFFITEM *p = NewItem();
 	if (par == nullptr)
 	{
 		// if there is no `parent`, this item becomes a child of `m_pRoot`
@@ -44,19 +57,89 @@ DIFFITEM *DiffItemList::AddNewDiff(DIFFITEM *par)
 	return p;
 }
 
+/**
+ * @brief Remove item and all its children from structured DIFFITEM tree.
+ * @param [in] diffpos Item to remove, invalid after the call.
+ */
+void DiffItemList::RemoveDiff(DIFFITEM *diffpos)
+{
+	assert(diffpos != nullptr && diffpos != m_pRoot);
+	RemoveChildren(diffpos);
+	diffpos->DelinkFromSiblings();
+	FreeItem(diffpos);
+}
+
+/**
+ * @brief Remove all children of item from structured DIFFITEM tree.
+ * @param [in] diffpos Parent of the items to remove.
+ */
+void DiffItemList::RemoveChildren(DIFFITEM *diffpos)
+{
+	DIFFITEM *p;
+	while ((p = diffpos->GetFirstChild()) != nullptr)
+	{
+		assert(p->GetParentLink() == diffpos);
+		RemoveChildren(p);
+		p->DelinkFromSiblings();
+		FreeItem(p);
+	}
+}
+
 /**
  * @brief Empty structured DIFFITEM tree
+ * The items are destroyed slab by slab, not by walking the tree.
  */
 void DiffItemList::RemoveAll()
 {
-	delete m_pRoot;
+	for (size_t i = 0; i < m_slabs.size(); ++i)
+	{
+		DIFFITEM *slab = m_slabs[i];
+		const size_t nItems = (i + 1 < m_slabs.size()) ? SlabSize : m_nSlabUsed;
+		for (size_t j = 0; j < nItems; ++j)
+			slab[j].~DIFFITEM();
+		::operator delete(slab);
+	}
+	m_slabs.clear();
+	m_nSlabUsed = SlabSize;
+	m_freeItems.clear();
 	m_pRoot = nullptr;
 }
 
 void DiffItemList::InitDiffItemList()
 {
 	assert(m_pRoot == nullptr);
-	m_pRoot = new DIFFITEM;
+	m_pRoot = NewItem();
+}
+
+/**
+ * @brief Get an empty item, reusing a removed item if there is one.
+ */
+DIFFITEM *DiffItemList::NewItem()
+{
+	if (!m_freeItems.empty())
+	{
+		DIFFITEM *p = m_freeItems.back();
+		m_freeItems.pop_back();
+		return p;
+	}
+	if (m_nSlabUsed == SlabSize)
+	{
+		m_slabs.push_back(AllocateSlab(SlabSize));
+		m_nSlabUsed = 0;
+	}
+	return ConstructItem(m_slabs.back() + m_nSlabUsed++);
+}
+
+/**
+ * @brief Return item to be reused by NewItem().
+ * The item is reset to an empty item so that all items in the slabs stay
+ * constructed until RemoveAll().
+ */
+void DiffItemList::FreeItem(DIFFITEM *p)
+{
+	p->~DIFFITEM();
+	ConstructItem(p);
+	m_freeItems.push_back(p);
 }
 
 /**
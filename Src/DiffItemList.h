@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <vector>
 #include "DiffItem.h"
 
 /**
@@ -13,14 +14,23 @@
  * we have a linked list of DIFFITEMs. But there is a structure that follows
  * the actual folder structure. Each DIFFITEM can have a parent folder and
  * another list of child items. Parent DIFFITEM is always a folder item.
+ *
+ * The items are allocated from slabs owned by the list. Items added one
+ * after another, like the siblings in a folder, are next to each other in
+ * memory, and the whole tree is freed slab by slab without walking it.
+ * Removed items are reused by later AddNewDiff() calls.
  */
 class DiffItemList
 {
 public:
 	DiffItemList();
 	~DiffItemList();
+	DiffItemList(const DiffItemList&) = delete;
+	DiffItemList& operator=(const DiffItemList&) = delete;
 	// add & remove differences
 	DIFFITEM *AddNewDiff(DIFFITEM *parent);
+	void RemoveDiff(DIFFITEM *diffpos);
+	void RemoveChildren(DIFFITEM *diffpos);
 	void RemoveAll();
 	void InitDiffItemList();
 
@@ -43,6 +53,14 @@ public:
 
 protected:
 	DIFFITEM* m_pRoot; /**< Root of list of diffitems; initially `nullptr`. */
+
+private:
+	enum { SlabSize = 512 }; /**< Number of items in one slab */
+	DIFFITEM *NewItem();
+	void FreeItem(DIFFITEM *p);
+	std::vector<DIFFITEM *> m_slabs; /**< Item storage, all slabs but the last are full */
+	size_t m_nSlabUsed; /**< Number of items used in the last slab */
+	std::vector<DIFFITEM *> m_freeItems; /**< Removed items to be reused */
 };
 
 /**
@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  DiffScheduler.cpp
+ *
+ * @brief Implementation of DiffScheduler and DiffWorkGroup classes.
+ */
+
+#include "pch.h"
+#include "DiffScheduler.h"
+#include <cassert>
+#include <algorithm>
+#include "DiffItem.h"
+#include "DebugNew.h"
+
+using Poco::FastMutex;
+
+/**
+ * @brief Add items to the group.
+ */
+void DiffWorkGroup::Add(int count)
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	m_nPending += count;
+}
+
+/**
+ * @brief Mark one item of the group as compared.
+ * The count is decremented and the waiter signaled under the same lock,
+ * so Wait() can't return and destroy the group before the signal is sent.
+ */
+void DiffWorkGroup::Done()
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	if (--m_nPending == 0)
+		m_cond.broadcast();
+}
+
+/**
+ * @brief Wait until all items added to the group have been compared.
+ */
+void DiffWorkGroup::Wait()
+{
+	FastMutex::ScopedLock lock(m_mutex);
+	while (m_nPending > 0)
+		m_cond.wait(m_mutex);
+}
+
+/**
+ * @brief Constructor.
+ * @param [in] nWorkers Number of worker threads pulling from the scheduler.
+ * @param [in] policy Order in which workers take the items.
+ */
+DiffScheduler::DiffScheduler(int nWorkers, SchedulePolicy policy)
+: m_policy(policy)
+, m_nQueued(0)
+, m_nNextQueue(0)
+, m_bShutdown(false)
+, m_nIdle(0)
+, m_nWakeUps(0)
+{
+	assert(nWorkers > 0);
+	for (int i = 0; i < nWorkers; ++i)
+		m_queues.emplace_back(new WorkerQueue());
+}
+
+DiffScheduler::~DiffScheduler()
+{
+}
+
+/**
+ * @brief Hand a batch of items over to one worker deque.
+ * @param [in] items Items to hand over.
+ * @param [in] count Number of items.
+ * @param [in] bUrgent If true items are put to the front of the deque.
+ * Ignored with SCHEDULE_LARGEST_FIRST.
+ */
+void DiffScheduler::Submit(const DiffWorkItem *items, size_t count, bool bUrgent)
+{
+	if (count == 0)
+		return;
+	if (m_policy == SCHEDULE_LARGEST_FIRST)
+	{
+		{
+			FastMutex::ScopedLock lock(m_largestMutex);
+			for (size_t i = 0; i < count; ++i)
+			{
+				m_largest.push_back({ GetCompareSize(items[i].di), items[i] });
+				std::push_heap(m_largest.begin(), m_largest.end());
+			}
+		}
+		m_nQueued += static_cast<int>(count);
+		WakeUpIdleWorkers();
+		return;
+	}
+	WorkerQueue &queue = *m_queues[m_nNextQueue++ % m_queues.size()];
+	{
+		FastMutex::ScopedLock lock(queue.mutex);
+		if (bUrgent)
+			queue.items.insert(queue.items.begin(), items, items + count);
+		else
+			queue.items.insert(queue.items.end(), items, items + count);
+	}
+	m_nQueued += static_cast<int>(count);
+	WakeUpIdleWorkers();
+}
+
+/**
+ * @brief Get next item to compare for a worker.
+ * Blocks until an item is available. Returns false when the scheduler
+ * has been shut down and all items have been handed out.
+ * @param [in] iWorker Index of the calling worker.
+ * @param [out] item Item to compare.
+ */
+bool DiffScheduler::Dequeue(int iWorker, DiffWorkItem &item)
+{
+	for (;;)
+	{
+		const unsigned nWakeUps = m_nWakeUps;
+		if (m_policy == SCHEDULE_LARGEST_FIRST ? TryPopLargest(item) :
+			(TryPop(iWorker, item) || TrySteal(iWorker, item)))
+			return true;
+
+		FastMutex::ScopedLock lock(m_idleMutex);
+		// Work arrived after the deques were looked at
+		if (m_nWakeUps != nWakeUps)
+			continue;
+		if (m_bShutdown && m_nQueued == 0)
+			return false;
+		// Items being moved by a stealing worker are handed out after
+		// it has put them to its deque and woken up the idle workers
+		++m_nIdle;
+		m_idleCond.wait(m_idleMutex);
+		--m_nIdle;
+	}
+}
+
+/**
+ * @brief Tell workers that no more items will be submitted.
+ * Workers return from Dequeue() after the deques have been drained.
+ */
+void DiffScheduler::Shutdown()
+{
+	m_bShutdown = true;
+	FastMutex::ScopedLock lock(m_idleMutex);
+	++m_nWakeUps;
+	m_idleCond.broadcast();
+}
+
+bool DiffScheduler::TryPop(int iWorker, DiffWorkItem &item)
+{
+	WorkerQueue &queue = *m_queues[iWorker];
+	FastMutex::ScopedLock lock(queue.mutex);
+	if (queue.items.empty())
+		return false;
+	item = queue.items.front();
+	queue.items.pop_front();
+	--m_nQueued;
+	return true;
+}
+
+/**
+ * @brief Steal items from the back of another worker's deque.
+ * Up to half of the victim's items (at most BATCH_SIZE) are taken; the first
+ * one is returned and the rest are moved to the stealing worker's own deque.
+ */
+bool DiffScheduler::TrySteal(int iWorker, DiffWorkItem &item)
+{
+	const int nQueues = GetWorkerCount();
+	DiffWorkItem stolen[BATCH_SIZE];
+	size_t nStolen = 0;
+	for (int i = 1; i < nQueues && nStolen == 0; ++i)
+	{
+		WorkerQueue &victim = *m_queues[(iWorker + i) % nQueues];
+		FastMutex::ScopedLock lock(victim.mutex);
+		size_t nAvail = victim.items.size();
+		if (nAvail == 0)
+			continue;
+		nStolen = (std::min)((nAvail + 1) / 2, static_cast<size_t>(BATCH_SIZE));
+		std::copy(victim.items.end() - nStolen, victim.items.end(), stolen);
+		victim.items.erase(victim.items.end() - nStolen, victim.items.end());
+	}
+	if (nStolen == 0)
+		return false;
+
+	item = stolen[0];
+	--m_nQueued;
+	if (nStolen > 1)
+	{
+		{
+			WorkerQueue &own = *m_queues[iWorker];
+			FastMutex::ScopedLock lock(own.mutex);
+			own.items.insert(own.items.end(), stolen + 1, stolen + nStolen);
+		}
+		WakeUpIdleWorkers();
+	}
+	return true;
+}
+
+bool DiffScheduler::TryPopLargest(DiffWorkItem &item)
+{
+	FastMutex::ScopedLock lock(m_largestMutex);
+	if (m_largest.empty())
+		return false;
+	std::pop_heap(m_largest.begin(), m_largest.end());
+	item = m_largest.back().item;
+	m_largest.pop_back();
+	--m_nQueued;
+	return true;
+}
+
+/**
+ * @brief Return the amount of data comparing the item reads.
+ * The size of the largest side is used, folders and missing sides count as 0.
+ */
+uint64_t DiffScheduler::GetCompareSize(const DIFFITEM *di)
+{
+	uint64_t size = 0;
+	if (di->diffcode.isDirectory())
+		return size;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (di->diffcode.exists(i) && di->diffFileInfo[i].size != DirItem::FILE_SIZE_NONE)
+			size = (std::max)(size, static_cast<uint64_t>(di->diffFileInfo[i].size));
+	}
+	return size;
+}
+
+void DiffScheduler::WakeUpIdleWorkers()
+{
+	FastMutex::ScopedLock lock(m_idleMutex);
+	++m_nWakeUps;
+	if (m_nIdle > 0)
+		m_idleCond.broadcast();
+}
+
+/**
+ * @brief Add an item to the batch.
+ * The batch is handed over to the scheduler when it gets full.
+ */
+void DiffWorkBatch::Add(DIFFITEM *di, bool bUrgent)
+{
+	std::vector<DiffWorkItem> &items = bUrgent ? m_urgentItems : m_items;
+	m_group.Add();
+	items.push_back({ di, &m_group });
+	if (items.size() >= DiffScheduler::BATCH_SIZE)
+	{
+		m_scheduler.Submit(items.data(), items.size(), bUrgent);
+		items.clear();
+	}
+}
+
+/**
+ * @brief Hand all collected items over to the scheduler.
+ */
+void DiffWorkBatch::Flush()
+{
+	if (!m_urgentItems.empty())
+	{
+		m_scheduler.Submit(m_urgentItems.data(), m_urgentItems.size(), true);
+		m_urgentItems.clear();
+	}
+	if (!m_items.empty())
+	{
+		m_scheduler.Submit(m_items.data(), m_items.size(), false);
+		m_items.clear();
+	}
+}
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  DiffScheduler.h
+ *
+ * @brief Declaration of DiffScheduler and DiffWorkGroup classes.
+ */
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#define POCO_NO_UNWINDOWS 1
+#include <Poco/Mutex.h>
+#include <Poco/Condition.h>
+
+class DIFFITEM;
+class DiffWorkGroup;
+
+/**
+ * @brief One unit of compare work handed to a DiffWorker thread.
+ */
+struct DiffWorkItem
+{
+	DIFFITEM *di; /**< Item to compare. */
+	DiffWorkGroup *group; /**< Group notified when the item has been compared. */
+};
+
+/**
+ * @brief Counts outstanding work items of one folder level.
+ * CompareItems() adds every item it hands to the scheduler to a group
+ * and then waits for the group before it evaluates the results of the level.
+ * Workers call Done() after comparing an item.
+ */
+class DiffWorkGroup
+{
+public:
+	DiffWorkGroup() : m_nPending(0) {}
+	void Add(int count = 1);
+	void Done();
+	void Wait();
+
+private:
+	int m_nPending; /**< Items handed out but not yet compared, guarded by m_mutex */
+	Poco::FastMutex m_mutex;
+	Poco::Condition m_cond;
+};
+
+/**
+ * @brief Work-stealing scheduler for folder compare worker threads.
+ *
+ * Every worker thread owns a deque of work items. The producer
+ * (CompareItems()) hands items over in batches to the worker deques in
+ * round-robin order. A worker takes items from the front of its own deque
+ * and, when that runs empty, steals up to half of the items from the back
+ * of another worker's deque. Each deque has its own lock so there is no
+ * single queue shared by all threads.
+ *
+ * With SCHEDULE_LARGEST_FIRST all items go to one queue ordered by file
+ * size instead, and workers always take the largest item submitted so far
+ * (longest-processing-time first). Big files are then started as soon as
+ * they have been found and small files are compared around them, instead
+ * of a big file found late keeping one worker busy after the others are done.
+ */
+class DiffScheduler
+{
+public:
+	enum { BATCH_SIZE = 64 }; /**< Max items handed over in one batch */
+
+	/** @brief Order in which workers take the submitted items. */
+	enum SchedulePolicy
+	{
+		SCHEDULE_TREE_ORDER, /**< Items are compared in the order submitted */
+		SCHEDULE_LARGEST_FIRST, /**< Largest files are compared first */
+	};
+
+	explicit DiffScheduler(int nWorkers, SchedulePolicy policy = SCHEDULE_TREE_ORDER);
+	~DiffScheduler();
+
+	int GetWorkerCount() const { return static_cast<int>(m_queues.size()); }
+	void Submit(const DiffWorkItem *items, size_t count, bool bUrgent = false);
+	bool Dequeue(int iWorker, DiffWorkItem &item);
+	void Shutdown();
+
+private:
+	struct WorkerQueue
+	{
+		Poco::FastMutex mutex;
+		std::deque<DiffWorkItem> items;
+	};
+
+	/** @brief Item waiting in the largest-first queue. */
+	struct SizedItem
+	{
+		uint64_t size;
+		DiffWorkItem item;
+		bool operator<(const SizedItem &other) const { return size < other.size; }
+	};
+
+	bool TryPop(int iWorker, DiffWorkItem &item);
+	bool TrySteal(int iWorker, DiffWorkItem &item);
+	bool TryPopLargest(DiffWorkItem &item);
+	void WakeUpIdleWorkers();
+	static uint64_t GetCompareSize(const DIFFITEM *di);
+
+	SchedulePolicy m_policy;
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues; /**< Per-worker deques */
+	Poco::FastMutex m_largestMutex;
+	std::vector<SizedItem> m_largest; /**< Heap of items for SCHEDULE_LARGEST_FIRST */
+	std::atomic_int m_nQueued; /**< Items in all deques */
+	std::atomic_uint m_nNextQueue; /**< Round-robin target for next batch */
+	std::atomic_bool m_bShutdown; /**< No more items will be submitted */
+	Poco::FastMutex m_idleMutex;
+	Poco::Condition m_idleCond; /**< Signaled when work arrives or on shutdown */
+	int m_nIdle; /**< Workers sleeping on m_idleCond, guarded by m_idleMutex */
+	std::atomic_uint m_nWakeUps; /**< Incremented under m_idleMutex whenever work arrives */
+};
+
+/**
+ * @brief Collects work items and hands them to the scheduler in batches.
+ * Items added with bUrgent are put to the front of the target deque.
+ */
+class DiffWorkBatch
+{
+public:
+	DiffWorkBatch(DiffScheduler &scheduler, DiffWorkGroup &group)
+		: m_scheduler(scheduler), m_group(group) {}
+	~DiffWorkBatch() { Flush(); }
+	void Add(DIFFITEM *di, bool bUrgent);
+	void Flush();
+
+private:
+	DiffScheduler &m_scheduler;
+	DiffWorkGroup &m_group;
+	std::vector<DiffWorkItem> m_items;
+	std::vector<DiffWorkItem> m_urgentItems;
+};
@@ -33,6 +33,7 @@
 #include "diff.h"
 #include "Diff3.h"
 #include "xdiff_gnudiff_compat.h"
+#include "DiffAlgorithmSelector.h"
 #include "FileTransform.h"
 #include "paths.h"
 #include "CompareOptions.h"
@@ -356,8 +357,8 @@ bool CDiffWrapper::PostFilter(int StartPos, int EndPos, int Direction,
 			OpShouldBeTrivial = true;
 			break;
 		}
-		size_t len = pinf->linbuf[i + 1] - pinf->linbuf[i];
-		const char *LineStr = pinf->linbuf[i];
+		const char *LineStr = LINE_START(pinf, i);
+		size_t len = LINE_START(pinf, i + 1) - LineStr;
 		std::string LineData(LineStr, linelen(LineStr, len));
 
 		const char * StartOfComment		= FindCommentMarker(LineData.c_str(), filtercommentsset.StartMarker.c_str());
@@ -423,8 +424,8 @@ bool CDiffWrapper::PostFilter(int StartPos, int EndPos, int Direction,
 				int TrivLinePos = i+1;
 				for(; TrivLinePos != (StartPos + QtyLinesInBlock);++TrivLinePos)
 				{
-					size_t len1 = pinf->linbuf[TrivLinePos + 1] - pinf->linbuf[TrivLinePos];
-					const char *LineStrTrvCk = pinf->linbuf[TrivLinePos];
+					const char *LineStrTrvCk = LINE_START(pinf, TrivLinePos);
+					size_t len1 = LINE_START(pinf, TrivLinePos + 1) - LineStrTrvCk;
 					std::string LineDataTrvCk(LineStrTrvCk, linelen(LineStrTrvCk, len1));
 					if (LineDataTrvCk.size() &&
 						!IsTrivialBytes(LineDataTrvCk.c_str(), LineDataTrvCk.c_str() + LineDataTrvCk.size(), filtercommentsset))
@@ -508,13 +509,13 @@ void CDiffWrapper::PostFilter(int LineNumberLeft, int QtyLinesLeft, int LineNumb
 		const char *	EndLineRight = LineStrRight;
 		if(i < QtyLinesLeft)
 		{
-			LineStrLeft = file_data_ary[0].linbuf[LineNumberLeft + i];
-			EndLineLeft = file_data_ary[0].linbuf[LineNumberLeft + i + 1];
+			LineStrLeft = LINE_START(&file_data_ary[0], LineNumberLeft + i);
+			EndLineLeft = LINE_START(&file_data_ary[0], LineNumberLeft + i + 1);
 		}
 		if(i < QtyLinesRight)
 		{
-			LineStrRight = file_data_ary[1].linbuf[LineNumberRight + i];
-			EndLineRight = file_data_ary[1].linbuf[LineNumberRight + i + 1];
+			LineStrRight = LINE_START(&file_data_ary[1], LineNumberRight + i);
+			EndLineRight = LINE_START(&file_data_ary[1], LineNumberRight + i + 1);
 		}
 			
 		if (EndLineLeft != nullptr && EndLineRight != nullptr)
@@ -678,6 +679,8 @@ bool CDiffWrapper::RunFileDiff()
 	struct change *script12 = nullptr;
 	DiffFileData diffdata, diffdata10, diffdata12;
 	int bin_flag = 0, bin_flag10 = 0, bin_flag12 = 0;
+	DiffAlgorithm algorithm = DIFF_ALGORITHM_DEFAULT;
+	DiffAlgorithm algorithm10 = DIFF_ALGORITHM_DEFAULT, algorithm12 = DIFF_ALGORITHM_DEFAULT;
 
 	if (aFiles.GetSize() == 2)
 	{
@@ -691,7 +694,7 @@ bool CDiffWrapper::RunFileDiff()
 		// Compare the files, if no error was found.
 		// Last param (bin_file) is `nullptr` since we don't
 		// (yet) need info about binary sides.
-		bRet = Diff2Files(&script, &diffdata, &bin_flag, nullptr);
+		bRet = Diff2Files(&script, &diffdata, &bin_flag, nullptr, &algorithm);
 
 		// We don't anymore create diff-files for every rescan.
 		// User can create patch-file whenever one wants to.
@@ -721,14 +724,14 @@ bool CDiffWrapper::RunFileDiff()
 			return false;
 		}
 
-		bRet = Diff2Files(&script10, &diffdata10, &bin_flag10, nullptr);
+		bRet = Diff2Files(&script10, &diffdata10, &bin_flag10, nullptr, &algorithm10);
 
 		if (!diffdata12.OpenFiles(strFileTemp[1], strFileTemp[2]))
 		{
 			return false;
 		}
 
-		bRet = Diff2Files(&script12, &diffdata12, &bin_flag12, nullptr);
+		bRet = Diff2Files(&script12, &diffdata12, &bin_flag12, nullptr, &algorithm12);
 	}
 
 	// First determine what happened during comparison
@@ -759,6 +762,7 @@ bool CDiffWrapper::RunFileDiff()
 		}
 		m_status.bMissingNL[0] = !!inf[0].missing_newline;
 		m_status.bMissingNL[1] = !!inf[1].missing_newline;
+		m_status.algorithm = algorithm;
 	}
 	else
 	{
@@ -790,6 +794,7 @@ bool CDiffWrapper::RunFileDiff()
 		m_status.bMissingNL[0] = !!inf10[1].missing_newline;
 		m_status.bMissingNL[1] = !!inf12[0].missing_newline;
 		m_status.bMissingNL[2] = !!inf12[1].missing_newline;
+		m_status.algorithm = (algorithm12 != DIFF_ALGORITHM_DEFAULT) ? algorithm12 : algorithm10;
 	}
 
 
@@ -1024,21 +1029,36 @@ void CDiffWrapper::SetAppendFiles(bool bAppendFiles)
     So if first file is binary, first bit is set etc. Can be `nullptr` if binary file
     info is not needed (faster compare since diffutils don't bother checking
     second file if first is binary).
+ * @param [out] algorithm Returns the algorithm the files were compared with,
+    chosen for the files when the option is DIFF_ALGORITHM_AUTO.
  * @return true when compare succeeds, false if error happened during compare.
  * @note This function is used in file compare, not folder compare. Similar
  * folder compare function is in DiffFileData.cpp.
  */
 bool CDiffWrapper::Diff2Files(struct change ** diffs, DiffFileData *diffData,
-	int * bin_status, int * bin_file) const
+	int * bin_status, int * bin_file, DiffAlgorithm * algorithm) const
 {
 	bool bRet = true;
 	SE_Handler seh;
 	try
 	{
-		if (m_options.m_diffAlgorithm != DIFF_ALGORITHM_DEFAULT)
+		*algorithm = m_options.m_diffAlgorithm;
+		if (*algorithm == DIFF_ALGORITHM_AUTO)
 		{
-			unsigned xdl_flags = make_xdl_flags(m_options);
-			*diffs = diff_2_files_xdiff(diffData->m_inf, (m_pMovedLines[0] != nullptr), xdl_flags);
+			// The whole files are compared anyway, read them now so that
+			// they can be sampled without reading them twice
+			if (!diffData->ReadFiles())
+			{
+				*diffs = nullptr;
+				return false;
+			}
+			*algorithm = DiffAlgorithmSelector::Select(diffData->m_inf);
+		}
+		if (*algorithm != DIFF_ALGORITHM_DEFAULT)
+		{
+			unsigned xdl_flags = make_xdl_flags(m_options, *algorithm);
+			*diffs = diff_2_files_xdiff(diffData->m_inf, bin_status,
+				(m_pMovedLines[0] != nullptr), bin_file, xdl_flags);
 			files[0] = diffData->m_inf[0];
 			files[1] = diffData->m_inf[1];
 		}
@@ -1098,8 +1118,8 @@ bool CDiffWrapper::RegExpFilter(int StartPos, int EndPos, const file_data *pinf)
 
 	while (line <= EndPos && linesMatch)
 	{
-		size_t len = pinf->linbuf[line + 1] - pinf->linbuf[line];
-		const char *string = pinf->linbuf[line];
+		const char *string = LINE_START(pinf, line);
+		size_t len = LINE_START(pinf, line + 1) - string;
 		size_t stringlen = linelen(string, len);
 		if (!m_pFilterList->Match(std::string(string, stringlen)))
 
@@ -1242,13 +1262,15 @@ struct Comp02Functor
 		int line2end = dr3.end[2];
 		if (line0end - line0 != line2end - line2)
 			return false;
-		const char **linbuf0 = inf10_[1].linbuf + inf10_[1].linbuf_base;
-		const char **linbuf2 = inf12_[1].linbuf + inf12_[1].linbuf_base;
+		const file_data *file0 = &inf10_[1];
+		const file_data *file2 = &inf12_[1];
 		for (int i = 0; i < line0end - line0 + 1; ++i)
 		{
-			const size_t line0len = linbuf0[line0 + i + 1] - linbuf0[line0 + i];
-			const size_t line2len = linbuf2[line2 + i + 1] - linbuf2[line2 + i];
-			if (line_cmp(linbuf0[line0 + i], line0len, linbuf2[line2 + i], line2len) != 0)
+			const int i0 = file0->linbuf_base + line0 + i;
+			const int i2 = file2->linbuf_base + line2 + i;
+			const size_t line0len = LINE_START(file0, i0 + 1) - LINE_START(file0, i0);
+			const size_t line2len = LINE_START(file2, i2 + 1) - LINE_START(file2, i2);
+			if (line_cmp(LINE_START(file0, i0), line0len, LINE_START(file2, i2), line2len) != 0)
 				return false;
 		}
 		return true;
@@ -1509,8 +1531,8 @@ void CDiffWrapper::WritePatchFile(struct change * script, file_data * inf)
 		path2 = m_files[1];
 	path1 = paths::ToUnixPath(path1);
 	path2 = paths::ToUnixPath(path2);
-	if ((inf_patch[0].linbuf && ucr::CheckForInvalidUtf8(inf_patch[0].linbuf[inf_patch[0].linbuf_base], inf_patch[0].buffered_chars)) ||
-		(inf_patch[1].linbuf && ucr::CheckForInvalidUtf8(inf_patch[1].linbuf[inf_patch[1].linbuf_base], inf_patch[1].buffered_chars)))
+	if ((inf_patch[0].linofs.lo && ucr::CheckForInvalidUtf8(LINE_START(&inf_patch[0], inf_patch[0].linbuf_base), inf_patch[0].buffered_chars)) ||
+		(inf_patch[1].linofs.lo && ucr::CheckForInvalidUtf8(LINE_START(&inf_patch[1], inf_patch[1].linbuf_base), inf_patch[1].buffered_chars)))
 	{
 		inf_patch[0].name = _strdup(ucr::toThreadCP(path1).c_str());
 		inf_patch[1].name = _strdup(ucr::toThreadCP(path2).c_str());
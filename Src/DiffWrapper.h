@@ -83,6 +83,14 @@ class FilterList;
  * size always means files are different. E.g. automatically created logs - when
  * more data is added size increases.
  */
+
+/** @var CMP_HASH
+ * @brief Compare by hashes of file contents.
+ * Every file is read once and a 128-bit hash of its contents is computed.
+ * Files are identical if their hashes are identical. Unlike the other
+ * content compare methods each file is read only once also in 3-way compare,
+ * and the hashes are kept in the compare results.
+ */
 enum COMPARE_TYPE
 {
 	CMP_CONTENT = 0,
@@ -91,6 +99,7 @@ enum COMPARE_TYPE
 	CMP_DATE,
 	CMP_DATE_SIZE,
 	CMP_SIZE,
+	CMP_HASH,
 	CMP_IMAGE_CONTENT,
 };
 
@@ -120,6 +129,7 @@ struct DIFFSTATUS
 	bool bBinaries = false; /**< Files are binaries */
 	IDENTLEVEL Identical = IDENTLEVEL_NONE; /**< diffutils said files are identical */
 	bool bPatchFileFailed = false; /**< Creating patch file failed */
+	DiffAlgorithm algorithm = DIFF_ALGORITHM_DEFAULT; /**< Algorithm the files were compared with */
 
 	DIFFSTATUS() {}
 	void MergeStatus(const DIFFSTATUS& other)
@@ -135,6 +145,8 @@ struct DIFFSTATUS
 			bPatchFileFailed = true;
 		if (other.bBinaries)
 			bBinaries = true;
+		if (other.algorithm != DIFF_ALGORITHM_DEFAULT)
+			algorithm = other.algorithm;
 		std::copy_n(other.bMissingNL, 3, bMissingNL);
 	}
 };
@@ -194,7 +206,7 @@ public:
 protected:
 	String FormatSwitchString() const;
 	bool Diff2Files(struct change ** diffs, DiffFileData *diffData,
-		int * bin_status, int * bin_file) const;
+		int * bin_status, int * bin_file, DiffAlgorithm * algorithm) const;
 	void LoadWinMergeDiffsFromDiffUtilsScript(struct change * script, const file_data * inf);
 	void WritePatchFile(struct change * script, file_data * inf);
 public:
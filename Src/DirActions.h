@@ -556,7 +556,7 @@ bool DoItemRename(InputIterator& it, const CDiffContext& ctxt, const String& szN
 	di.diffcode.setSideNone();
 	for (int index = 0; index < nDirs; index++)
 	{
-		di.diffFileInfo[index].filename = szNewItemName;
+		di.diffFileInfo[index].filename = ctxt.m_stringPool.Intern(szNewItemName);
 		if (bRename[index] || paths::DoesPathExist(GetItemFileName(ctxt, di, index)))
 			di.diffcode.setSideFlag(index);
 	}
@@ -728,7 +728,7 @@ IntToIntMap CountCodepages(const InputIterator& begin, const InputIterator& end,
 		for (int i = 0; i < ctxt.GetCompareDirs(); ++i)
 		{
 			if (di.diffcode.diffcode != 0 && di.diffcode.exists(i))
-				map.Increment(di.diffFileInfo[i].encoding.m_codepage);
+				map.Increment(di.diffFileInfo[i].GetDetails().encoding.m_codepage);
 		}
 	}
 	return map;
@@ -750,7 +750,7 @@ void ApplyCodepage(const InputIterator& begin, const InputIterator& end, CDiffCo
 			// Does it exist on left? (ie, right or both)
 			if (affect[i] && di.diffcode.exists(i) && di.diffFileInfo[i].IsEditableEncoding())
 			{
-				di.diffFileInfo[i].encoding.SetCodepage(nCodepage);
+				di.diffFileInfo[i].GetDetailsRef().encoding.SetCodepage(nCodepage);
 			}
 		}
 	}
@@ -39,6 +39,8 @@
 #include "DiffWrapper.h"
 #include "FolderCmp.h"
 #include "DirViewColItems.h"
+#include "ContentHashCache.h"
+#include "Environment.h"
 #include <Poco/Semaphore.h>
 
 #ifdef _DEBUG
@@ -235,6 +237,21 @@ void CDirDoc::InitDiffContext(CDiffContext *pCtxt)
 
 	pCtxt->m_pCompareStats = m_pCompareStats.get();
 
+	if (GetOptionsMgr()->GetBool(OPT_CMP_CONTENT_HASH_CACHE))
+	{
+		if (m_pContentHashCache == nullptr)
+		{
+			m_pContentHashCache.reset(new ContentHashCache());
+			m_pContentHashCache->Open(paths::ConcatPath(env::GetLocalAppDataPath(), _T("WinMerge\\ContentHashCache.dat")));
+		}
+		pCtxt->m_pContentHashCache = m_pContentHashCache->IsOpen() ? m_pContentHashCache.get() : nullptr;
+	}
+	else
+	{
+		pCtxt->m_pContentHashCache = nullptr;
+		m_pContentHashCache.reset();
+	}
+
 	// Make sure filters are up-to-date
 	theApp.m_pGlobalFileFilter->ReloadUpdatedFilters();
 	pCtxt->m_piFilterGlobal = theApp.m_pGlobalFileFilter.get();
@@ -346,7 +363,7 @@ void CDirDoc::Rescan()
 	else
 	{
 		m_diffThread.SetCollectFunction([](DiffFuncStruct* myStruct) {
-			bool casesensitive = false;
+			bool casesensitive = myStruct->context->m_bCaseSensitive;
 			int depth = myStruct->context->m_bRecursive ? -1 : 0;
 			PathContext paths = myStruct->context->GetNormalizedPaths();
 			String subdir[3] = {_T(""), _T(""), _T("")}; // blank to start at roots specified in diff context
@@ -778,11 +795,12 @@ void CDirDoc::MoveToPrevDiff(IMergeDoc *pMergeDoc)
 
 bool CDirDoc::CompareFilesIfFilesAreLarge(int nFiles, const FileLocation ifileloc[])
 {
+	StringPool pool;
 	DIFFITEM di;
 	bool bLargeFile = false;
 	for (int i = 0; i < nFiles; ++i)
 	{
-		di.diffFileInfo[i].SetFile(paths::FindFileName(ifileloc[i].filepath));
+		di.diffFileInfo[i].SetFile(paths::FindFileName(ifileloc[i].filepath), pool);
 		if (di.diffFileInfo[i].Update(ifileloc[i].filepath))
 			di.diffcode.setSideFlag(i);
 	}
@@ -23,6 +23,7 @@ typedef CTypedPtrList<CPtrList, IMergeDoc *> MergeDocPtrList;
 class DirDocFilterGlobal;
 class DirDocFilterByExtension;
 class CTempPathContext;
+class ContentHashCache;
 struct FileActionItem;
 struct FileLocation;
 
@@ -129,6 +130,7 @@ private:
 	std::unique_ptr<CDiffContext> m_pCtxt; /**< Pointer to diff-data */
 	CDirView *m_pDirView; /**< Pointer to GUI */
 	std::unique_ptr<CompareStats> m_pCompareStats; /**< Compare statistics */
+	std::unique_ptr<ContentHashCache> m_pContentHashCache; /**< Content hashes of compared files */
 	MergeDocPtrList m_MergeDocs; /**< List of file compares opened from this compare */
 	bool m_bRO[3]; /**< Is left/middle/right side read-only */
 	String m_strDesc[3]; /**< Left/middle/right side desription text */
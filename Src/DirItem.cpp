@@ -36,15 +36,16 @@ String FileFlags::ToString() const
 /**
  * @brief Set filename and path for the item.
  * @param [in] fullpath Full path to file to set to item.
+ * @param [in] pool Pool to intern the filename and path to.
  */
-void DirItem::SetFile(const String &fullPath)
+void DirItem::SetFile(const String &fullPath, StringPool &pool)
 {
 	String ext, filename2, path2;
 	paths::SplitFilename(fullPath, &path2, &filename2, &ext);
 	filename2 += _T(".");
 	filename2 += ext;
-	filename = filename2;
-	path = path2;
+	filename = pool.Intern(filename2);
+	path = pool.Intern(path2);
 }
 
 /**
@@ -99,6 +100,23 @@ bool DirItem::Update(const String &sFilePath)
 	return retVal;
 }
 
+/**
+ * @brief Update fileinfo from an entry of a folder listing.
+ * Same as Update(const String&) but uses the information LoadAndSortFiles()
+ * has already read instead of querying the file. Function does not set
+ * filename and path.
+ * @param [in] ent Listing entry of the file/directory.
+ */
+void DirItem::Update(const DirItem &ent)
+{
+	// There can be files without modification date.
+	// Then we must use creation date.
+	mtime = (ent.mtime != 0) ? ent.mtime : ent.ctime;
+	ctime = ent.ctime;
+	size = ent.size;
+	flags.attributes = ent.flags.attributes;
+}
+
 /**
  * @brief Clears FileInfo data.
  */
@@ -117,6 +135,5 @@ void DirItem::ClearPartial()
 	ctime = 0;
 	mtime = 0;
 	size = DirItem::FILE_SIZE_NONE;
-	version.Clear();
 	flags.reset();
 }
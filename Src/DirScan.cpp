@@ -7,9 +7,12 @@
 #include "pch.h"
 #include "DirScan.h"
 #include <cassert>
+#include <algorithm>
 #include <memory>
+#include <atomic>
 #define POCO_NO_UNWINDOWS 1
 #include <Poco/Semaphore.h>
+#include <Poco/Event.h>
 #include <Poco/Notification.h>
 #include <Poco/NotificationQueue.h>
 #include <Poco/Environment.h>
@@ -21,6 +24,8 @@
 #include <Poco/Stopwatch.h>
 #include <Poco/Format.h>
 #include "DiffThread.h"
+#include "DeviceIoLimiter.h"
+#include "DiffScheduler.h"
 #include "UnicodeString.h"
 #include "DiffWrapper.h"
 #include "CompareStats.h"
@@ -52,63 +57,180 @@ static DIFFITEM *AddToList(const String &sLeftDir, const String &sRightDir, cons
 	unsigned code, DiffFuncStruct *myStruct, DIFFITEM *parent);
 static DIFFITEM *AddToList(const String &sDir1, const String &sDir2, const String &sDir3, const DirItem *ent1, const DirItem *ent2, const DirItem *ent3,
 	unsigned code, DiffFuncStruct *myStruct, DIFFITEM *parent, int nItems = 3);
-static void UpdateDiffItem(DIFFITEM &di, bool &bExists, CDiffContext *pCtxt);
-static int CompareItems(NotificationQueue &queue, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
+static int CompareItems(DiffScheduler &scheduler, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
+static int CompareRequestedItems(DiffScheduler &scheduler, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
+static int CompareItemsLargestFirst(DiffScheduler &scheduler, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
+typedef int (*CompareFunc)(DiffScheduler &scheduler, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
+static int CompareWithWorkers(CompareFunc compareFunc, DiffScheduler::SchedulePolicy policy, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos);
 
-class WorkNotification: public Poco::Notification
+class DiffWorker: public Runnable
 {
 public:
-	WorkNotification(DIFFITEM& di, NotificationQueue& queueResult): m_di(di), m_queueResult(queueResult) {}
-	DIFFITEM& data() const { return m_di; }
-	NotificationQueue& queueResult() const { return m_queueResult; }
+	DiffWorker(DiffScheduler& scheduler, DeviceIoLimiter *pIoLimiter, CDiffContext *pCtxt, int id):
+	  m_scheduler(scheduler), m_pIoLimiter(pIoLimiter), m_pCtxt(pCtxt), m_id(id) {}
+
+	void run()
+	{
+		FolderCmp fc(m_pCtxt, m_pIoLimiter);
+		// keep the scripts alive during the Rescan
+		// when we exit the thread, we delete this and release the scripts
+		CAssureScriptsForThread scriptsForRescan;
+
+		DiffWorkItem item;
+		while (m_scheduler.Dequeue(m_id, item))
+		{
+			m_pCtxt->m_pCompareStats->BeginCompare(item.di, m_id);
+			if (!m_pCtxt->ShouldAbort())
+				CompareDiffItem(fc, *item.di);
+			item.group->Done();
+		}
+	}
+
 private:
-	DIFFITEM& m_di;
-	NotificationQueue& m_queueResult;
+	DiffScheduler& m_scheduler;
+	DeviceIoLimiter *m_pIoLimiter; /**< Limits readers per disk, nullptr if not limited */
+	CDiffContext *m_pCtxt;
+	int m_id;
 };
 
-class WorkCompletedNotification: public Poco::Notification
+typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
+
+/**
+ * @brief Sorted listings of one folder on all compared sides.
+ * Sides are loaded by DirLoader threads; Wait() blocks until all are loaded.
+ */
+class DirListing
 {
 public:
-	explicit WorkCompletedNotification(DIFFITEM& di): m_di(di) {}
-	DIFFITEM& data() const { return m_di; }
+	explicit DirListing(int nDirs) : m_nPending(nDirs), m_loaded(Poco::Event::EVENT_MANUALRESET) {}
+	void SetLoaded() { if (--m_nPending == 0) m_loaded.set(); }
+	void Wait() { m_loaded.wait(); }
+
+	DirItemArray dirs[3]; /**< Subfolders on each side */
+	DirItemArray files[3]; /**< Files on each side */
+
 private:
-	DIFFITEM& m_di;
+	std::atomic_int m_nPending;
+	Poco::Event m_loaded;
 };
 
-class DiffWorker: public Runnable
+typedef std::shared_ptr<DirListing> DirListingPtr;
+
+class LoadDirNotification: public Poco::Notification
 {
 public:
-	DiffWorker(NotificationQueue& queue, CDiffContext *pCtxt, int id):
-	  m_queue(queue), m_pCtxt(pCtxt), m_id(id) {}
+	LoadDirNotification(const DirListingPtr& listing, int nIndex, const String& sDir, bool casesensitive, StringPool &pool):
+	  m_listing(listing), m_nIndex(nIndex), m_sDir(sDir), m_casesensitive(casesensitive), m_pool(pool) {}
+	void Load() const
+	{
+		LoadAndSortFiles(m_sDir, &m_listing->dirs[m_nIndex], &m_listing->files[m_nIndex], m_casesensitive, &m_pool);
+		m_listing->SetLoaded();
+	}
+private:
+	DirListingPtr m_listing;
+	int m_nIndex;
+	String m_sDir;
+	bool m_casesensitive;
+	StringPool &m_pool;
+};
+
+class DirLoader: public Runnable
+{
+public:
+	explicit DirLoader(NotificationQueue& queue): m_queue(queue) {}
 
 	void run()
 	{
-		FolderCmp fc(m_pCtxt);
-		// keep the scripts alive during the Rescan
-		// when we exit the thread, we delete this and release the scripts
-		CAssureScriptsForThread scriptsForRescan;
-
+		// Any notification other than LoadDirNotification stops the thread
 		AutoPtr<Notification> pNf(m_queue.waitDequeueNotification());
-		while (pNf.get() != nullptr)
+		LoadDirNotification* pLoadNf;
+		while ((pLoadNf = dynamic_cast<LoadDirNotification*>(pNf.get())) != nullptr)
 		{
-			WorkNotification* pWorkNf = dynamic_cast<WorkNotification*>(pNf.get());
-			if (pWorkNf != nullptr) {
-				m_pCtxt->m_pCompareStats->BeginCompare(&pWorkNf->data(), m_id);
-				if (!m_pCtxt->ShouldAbort())
-					CompareDiffItem(fc, pWorkNf->data());
-				pWorkNf->queueResult().enqueueNotification(new WorkCompletedNotification(pWorkNf->data()));
-			}
+			pLoadNf->Load();
 			pNf = m_queue.waitDequeueNotification();
 		}
 	}
 
 private:
 	NotificationQueue& m_queue;
-	CDiffContext *m_pCtxt;
-	int m_id;
 };
 
-typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
+typedef std::shared_ptr<DirLoader> DirLoaderPtr;
+
+/**
+ * @brief Loads folder listings on a pool of threads.
+ * DirScan_GetItems() still builds the DIFFITEM tree on the collect thread
+ * in the same order as before, but asks the collector for the listings of
+ * upcoming subfolders in advance. All sides of a folder and sibling
+ * subfolders are then enumerated at the same time.
+ */
+class DirCollector
+{
+public:
+	DirCollector(int nThreads, StringPool &pool) : m_threadPool(nThreads, nThreads), m_pool(pool)
+	{
+		for (int i = 0; i < nThreads; ++i)
+		{
+			m_loaders.push_back(DirLoaderPtr(new DirLoader(m_queue)));
+			m_threadPool.start(*m_loaders[i]);
+		}
+	}
+
+	~DirCollector()
+	{
+		m_queue.clear();
+		for (size_t i = 0; i < m_loaders.size(); ++i)
+			m_queue.enqueueNotification(new Notification());
+		m_threadPool.joinAll();
+	}
+
+	DirListingPtr Load(const PathContext &paths, const String subdir[], bool casesensitive)
+	{
+		int nDirs = paths.GetSize();
+		DirListingPtr listing(new DirListing(nDirs));
+		for (int nIndex = 0; nIndex < nDirs; nIndex++)
+		{
+			String sDir = subdir[0].empty() ? paths[nIndex] : paths::ConcatPath(paths[nIndex], subdir[nIndex]);
+			m_queue.enqueueNotification(new LoadDirNotification(listing, nIndex, sDir, casesensitive, m_pool));
+		}
+		return listing;
+	}
+
+	/** Number of subfolder listings requested ahead of the one being scanned */
+	int GetPrefetchCount() const { return 2 * static_cast<int>(m_loaders.size()); }
+
+private:
+	ThreadPool m_threadPool;
+	NotificationQueue m_queue;
+	StringPool &m_pool; /**< Pool for the names in the listings */
+	std::vector<DirLoaderPtr> m_loaders;
+};
+
+/**
+ * @brief Return number of worker threads to use, from OPT_CMP_COMPARE_THREADS.
+ */
+static int GetWorkerThreadCount()
+{
+	int nworkers = GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_THREADS);
+	if (nworkers <= 0)
+	{
+		nworkers += Environment::processorCount();
+		if (nworkers <= 0)
+			nworkers = 1;
+	}
+	return nworkers;
+}
+
+/**
+ * @brief Subfolder found while merging the folder listings.
+ */
+struct SubdirEntry
+{
+	unsigned nDiffCode;
+	const DirItem *ent[3];
+	String newsubdir[3];
+	bool bRecurse; /**< Walk into the subfolder? */
+};
 
 /**
  * @brief Collect file- and folder-names to list.
@@ -120,12 +242,16 @@ typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
  *   contain into list.
  *
  * Items are tested against file filters in this function.
+ *
+ * Folder listings are loaded on the threads of @p collector. Listings of
+ * subfolders are requested before they are walked into so that siblings
+ * are enumerated in parallel, but items are added to the list in the same
+ * order as a sequential walk would add them.
  * 
+ * @param [in] collector Loads folder listings.
  * @param [in] paths Root paths of compare
- * @param [in] leftsubdir Left side subdirectory under root path
- * @param [in] bLeftUniq Is left-side folder unique folder?
- * @param [in] rightsubdir Right side subdirectory under root path
- * @param [in] bRightUniq Is right-side folder unique folder?
+ * @param [in] subdir Subdirectories under root paths
+ * @param [in] listing Listing of the folders, if already requested.
  * @param [in] myStruct Compare-related data, like context etc.
  * @param [in] casesensitive Is filename compare case sensitive?
  * @param [in] depth Levels of subdirectories to scan, -1 scans all
@@ -133,31 +259,26 @@ typedef std::shared_ptr<DiffWorker> DiffWorkerPtr;
  * @param [in] bUniques If true, walk into unique folders.
  * @return 1 normally, -1 if compare was aborted
  */
-int DirScan_GetItems(const PathContext &paths, const String subdir[],
-		DiffFuncStruct *myStruct,
+static int GetItems(DirCollector &collector, const PathContext &paths, const String subdir[],
+		DirListingPtr listing, DiffFuncStruct *myStruct,
 		bool casesensitive, int depth, DIFFITEM *parent,
 		bool bUniques)
 {
 	static const TCHAR backslash[] = _T("\\");
 	int nDirs = paths.GetSize();
 	CDiffContext *pCtxt = myStruct->context;
-	String sDir[3];
 	String subprefix[3];
 
-	std::copy(paths.begin(), paths.end(), sDir);
-
 	if (!subdir[0].empty())
 	{
 		for (int nIndex = 0; nIndex < paths.GetSize(); nIndex++)
-		{
-			sDir[nIndex] = paths::ConcatPath(sDir[nIndex], subdir[nIndex]);
 			subprefix[nIndex] = subdir[nIndex] + backslash;
-		}
 	}
 
-	DirItemArray dirs[3], aFiles[3];
-	for (int nIndex = 0; nIndex < nDirs; nIndex++)
-		LoadAndSortFiles(sDir[nIndex], &dirs[nIndex], &aFiles[nIndex], casesensitive);
+	if (listing == nullptr)
+		listing = collector.Load(paths, subdir, casesensitive);
+	listing->Wait();
+	const DirItemArray *dirs = listing->dirs, *aFiles = listing->files;
 
 	// Allow user to abort scanning
 	if (pCtxt->ShouldAbort())
@@ -175,6 +296,7 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 			return 0;
 	}
 
+	std::vector<SubdirEntry> subdirs;
 	DirItemArray::size_type i=0, j=0, k=0;
 	while (true)
 	{
@@ -186,13 +308,13 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 
 		unsigned nDiffCode = DIFFCODE::DIR;
 		// Comparing directories leftDirs[i].name to rightDirs[j].name
-		if (i<dirs[0].size() && (j==dirs[1].size() || collstr(dirs[0][i].filename, dirs[1][j].filename, casesensitive)<0)
-			&& (nDirs < 3 ||      (k==dirs[2].size() || collstr(dirs[0][i].filename, dirs[2][k].filename, casesensitive)<0) ))
+		if (i<dirs[0].size() && (j==dirs[1].size() || collkey(dirs[0][i], dirs[1][j])<0)
+			&& (nDirs < 3 ||      (k==dirs[2].size() || collkey(dirs[0][i], dirs[2][k])<0) ))
 		{
 			nDiffCode |= DIFFCODE::FIRST;
 		}
-		else if (j<dirs[1].size() && (i==dirs[0].size() || collstr(dirs[1][j].filename, dirs[0][i].filename, casesensitive)<0)
-			&& (nDirs < 3 ||      (k==dirs[2].size() || collstr(dirs[1][j].filename, dirs[2][k].filename, casesensitive)<0) ))
+		else if (j<dirs[1].size() && (i==dirs[0].size() || collkey(dirs[1][j], dirs[0][i])<0)
+			&& (nDirs < 3 ||      (k==dirs[2].size() || collkey(dirs[1][j], dirs[2][k])<0) ))
 		{
 			nDiffCode |= DIFFCODE::SECOND;
 		}
@@ -202,23 +324,23 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		}
 		else
 		{
-			if (k<dirs[2].size() && (i==dirs[0].size() || collstr(dirs[2][k].filename, dirs[0][i].filename, casesensitive)<0)
-				&&                     (j==dirs[1].size() || collstr(dirs[2][k].filename, dirs[1][j].filename, casesensitive)<0) )
+			if (k<dirs[2].size() && (i==dirs[0].size() || collkey(dirs[2][k], dirs[0][i])<0)
+				&&                     (j==dirs[1].size() || collkey(dirs[2][k], dirs[1][j])<0) )
 			{
 				nDiffCode |= DIFFCODE::THIRD;
 			}
-			else if ((i<dirs[0].size() && j<dirs[1].size() && collstr(dirs[0][i].filename, dirs[1][j].filename, casesensitive) == 0)
-				&& (k==dirs[2].size() || collstr(dirs[2][k].filename, dirs[0][i].filename, casesensitive) != 0))
+			else if ((i<dirs[0].size() && j<dirs[1].size() && collkey(dirs[0][i], dirs[1][j]) == 0)
+				&& (k==dirs[2].size() || collkey(dirs[2][k], dirs[0][i]) != 0))
 			{
 				nDiffCode |= DIFFCODE::FIRST | DIFFCODE::SECOND;
 			}
-			else if ((i<dirs[0].size() && k<dirs[2].size() && collstr(dirs[0][i].filename, dirs[2][k].filename, casesensitive) == 0)
-				&& (j==dirs[1].size() || collstr(dirs[1][j].filename, dirs[2][k].filename, casesensitive) != 0))
+			else if ((i<dirs[0].size() && k<dirs[2].size() && collkey(dirs[0][i], dirs[2][k]) == 0)
+				&& (j==dirs[1].size() || collkey(dirs[1][j], dirs[2][k]) != 0))
 			{
 				nDiffCode |= DIFFCODE::FIRST | DIFFCODE::THIRD;
 			}
-			else if ((j<dirs[1].size() && k<dirs[2].size() && collstr(dirs[1][j].filename, dirs[2][k].filename, casesensitive) == 0)
-				&& (i==dirs[0].size() || collstr(dirs[0][i].filename, dirs[1][j].filename, casesensitive) != 0))
+			else if ((j<dirs[1].size() && k<dirs[2].size() && collkey(dirs[1][j], dirs[2][k]) == 0)
+				&& (i==dirs[0].size() || collkey(dirs[0][i], dirs[1][j]) != 0))
 			{
 				nDiffCode |= DIFFCODE::SECOND | DIFFCODE::THIRD;
 			}
@@ -273,58 +395,19 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 				nDiffCode |= DIFFCODE::SKIPPED;
 		}
 
-		// add to list
-		if (!depth)
-		{
-			if (nDirs < 3)
-				AddToList(subdir[0], subdir[1], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : nullptr, 
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : nullptr,
-					nDiffCode, myStruct, parent);
-			else
-				AddToList(subdir[0], subdir[1], subdir[2], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : nullptr,
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : nullptr,
-					(nDiffCode & DIFFCODE::THIRD ) ? &dirs[2][k] : nullptr,
-					nDiffCode, myStruct, parent);
-		}
-		else
-		{
-			// Recursive compare
-			if (nDirs < 3)
-			{
-				DIFFITEM *me = AddToList(subdir[0], subdir[1], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : nullptr, 
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : nullptr,
-					nDiffCode, myStruct, parent);
-				if ((nDiffCode & DIFFCODE::SKIPPED) == 0 && ((nDiffCode & DIFFCODE::SIDEFLAGS) == DIFFCODE::BOTH || bUniques))
-				{
-					// Scan recursively all subdirectories too, we are not adding folders
-					String newsubdir[3] = {leftnewsub, rightnewsub};
-					int result = DirScan_GetItems(paths, newsubdir, myStruct, casesensitive,
-							depth - 1, me, bUniques);
-					if (result == -1)
-						return -1;
-				}
-			}
-			else
-			{
-				DIFFITEM *me = AddToList(subdir[0], subdir[1], subdir[2], 
-					(nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : nullptr,
-					(nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : nullptr,
-					(nDiffCode & DIFFCODE::THIRD ) ? &dirs[2][k] : nullptr,
-					nDiffCode, myStruct, parent);
-				if ((nDiffCode & DIFFCODE::SKIPPED) == 0 && ((nDiffCode & DIFFCODE::SIDEFLAGS) == DIFFCODE::ALL || bUniques))
-				{
-					// Scan recursively all subdirectories too, we are not adding folders
-					String newsubdir[3] = {leftnewsub, middlenewsub, rightnewsub};
-					int result = DirScan_GetItems(paths, newsubdir, myStruct, casesensitive,
-							depth - 1, me, bUniques);
-					if (result == -1)
-						return -1;
-				}
-			}
-		}
+		SubdirEntry entry;
+		entry.nDiffCode = nDiffCode;
+		entry.ent[0] = (nDiffCode & DIFFCODE::FIRST ) ? &dirs[0][i] : nullptr;
+		entry.ent[1] = (nDiffCode & DIFFCODE::SECOND) ? &dirs[1][j] : nullptr;
+		entry.ent[2] = (nDirs > 2 && (nDiffCode & DIFFCODE::THIRD)) ? &dirs[2][k] : nullptr;
+		entry.newsubdir[0] = leftnewsub;
+		entry.newsubdir[1] = (nDirs < 3) ? rightnewsub : middlenewsub;
+		entry.newsubdir[2] = (nDirs < 3) ? String() : rightnewsub;
+		// Scan recursively all subdirectories too, we are not adding folders
+		entry.bRecurse = depth != 0 && (nDiffCode & DIFFCODE::SKIPPED) == 0 &&
+			((nDiffCode & DIFFCODE::SIDEFLAGS) == (nDirs < 3 ? DIFFCODE::BOTH : DIFFCODE::ALL) || bUniques);
+		subdirs.push_back(entry);
+
 		if (nDiffCode & DIFFCODE::FIRST)
 			i++;
 		if (nDiffCode & DIFFCODE::SECOND)
@@ -332,6 +415,37 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		if (nDiffCode & DIFFCODE::THIRD)
 			k++;
 	}
+
+	// Add subfolders to list in listing order, requesting the listings
+	// of the next few subfolders before walking into the current one
+	std::vector<DirListingPtr> listings(subdirs.size());
+	size_t nRequested = 0;
+	for (size_t n = 0; n < subdirs.size(); ++n)
+	{
+		if (pCtxt->ShouldAbort())
+			return -1;
+
+		for (; nRequested < subdirs.size() && nRequested <= n + static_cast<size_t>(collector.GetPrefetchCount()); ++nRequested)
+		{
+			if (subdirs[nRequested].bRecurse)
+				listings[nRequested] = collector.Load(paths, subdirs[nRequested].newsubdir, casesensitive);
+		}
+
+		const SubdirEntry& entry = subdirs[n];
+		DIFFITEM *me;
+		if (nDirs < 3)
+			me = AddToList(subdir[0], subdir[1], entry.ent[0], entry.ent[1], entry.nDiffCode, myStruct, parent);
+		else
+			me = AddToList(subdir[0], subdir[1], subdir[2], entry.ent[0], entry.ent[1], entry.ent[2], entry.nDiffCode, myStruct, parent);
+		if (entry.bRecurse)
+		{
+			int result = GetItems(collector, paths, entry.newsubdir, listings[n], myStruct, casesensitive,
+					depth - 1, me, bUniques);
+			listings[n].reset();
+			if (result == -1)
+				return -1;
+		}
+	}
 	// Handle files
 	// i points to current file in left list (aFiles[0])
 	// j points to current file in right list (aFiles[1])
@@ -344,9 +458,9 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 
 		// Comparing file aFiles[0][i].name to aFiles[1][j].name
 		if (i<aFiles[0].size() && (j==aFiles[1].size() ||
-				collstr(aFiles[0][i].filename, aFiles[1][j].filename, casesensitive) < 0)
+				collkey(aFiles[0][i], aFiles[1][j]) < 0)
 			&& (nDirs < 3 || 
-				(k==aFiles[2].size() || collstr(aFiles[0][i].filename, aFiles[2][k].filename, casesensitive)<0) ))
+				(k==aFiles[2].size() || collkey(aFiles[0][i], aFiles[2][k])<0) ))
 		{
 			if (nDirs < 3)
 			{
@@ -363,9 +477,9 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 			continue;
 		}
 		if (j<aFiles[1].size() && (i==aFiles[0].size() ||
-				collstr(aFiles[0][i].filename, aFiles[1][j].filename, casesensitive) > 0)
+				collkey(aFiles[0][i], aFiles[1][j]) > 0)
 			&& (nDirs < 3 ||
-				(k==aFiles[2].size() || collstr(aFiles[1][j].filename, aFiles[2][k].filename, casesensitive)<0) ))
+				(k==aFiles[2].size() || collkey(aFiles[1][j], aFiles[2][k])<0) ))
 		{
 			const unsigned nDiffCode = DIFFCODE::SECOND | DIFFCODE::FILE;
 			if (nDirs < 3)
@@ -379,8 +493,8 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 		if (nDirs == 3)
 		{
 			if (k<aFiles[2].size() && (i==aFiles[0].size() ||
-					collstr(aFiles[2][k].filename, aFiles[0][i].filename, casesensitive)<0)
-				&& (j==aFiles[1].size() || collstr(aFiles[2][k].filename, aFiles[1][j].filename, casesensitive)<0) )
+					collkey(aFiles[2][k], aFiles[0][i])<0)
+				&& (j==aFiles[1].size() || collkey(aFiles[2][k], aFiles[1][j])<0) )
 			{
 				const unsigned nDiffCode = DIFFCODE::THIRD | DIFFCODE::FILE;
 				AddToList(subdir[0], subdir[1], subdir[2], nullptr, nullptr, &aFiles[2][k], nDiffCode, myStruct, parent);
@@ -389,8 +503,8 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 				continue;
 			}
 
-			if ((i<aFiles[0].size() && j<aFiles[1].size() && collstr(aFiles[0][i].filename, aFiles[1][j].filename, casesensitive) == 0)
-			    && (k==aFiles[2].size() || collstr(aFiles[0][i].filename, aFiles[2][k].filename, casesensitive) != 0))
+			if ((i<aFiles[0].size() && j<aFiles[1].size() && collkey(aFiles[0][i], aFiles[1][j]) == 0)
+			    && (k==aFiles[2].size() || collkey(aFiles[0][i], aFiles[2][k]) != 0))
 			{
 				const unsigned nDiffCode = DIFFCODE::FIRST | DIFFCODE::SECOND | DIFFCODE::FILE;
 				AddToList(subdir[0], subdir[1], subdir[2], &aFiles[0][i], &aFiles[1][j], nullptr, nDiffCode, myStruct, parent);
@@ -398,8 +512,8 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 				++j;
 				continue;
 			}
-			else if ((i<aFiles[0].size() && k<aFiles[2].size() && collstr(aFiles[0][i].filename, aFiles[2][k].filename, casesensitive) == 0)
-			    && (j==aFiles[1].size() || collstr(aFiles[1][j].filename, aFiles[2][k].filename, casesensitive) != 0))
+			else if ((i<aFiles[0].size() && k<aFiles[2].size() && collkey(aFiles[0][i], aFiles[2][k]) == 0)
+			    && (j==aFiles[1].size() || collkey(aFiles[1][j], aFiles[2][k]) != 0))
 			{
 				const unsigned nDiffCode = DIFFCODE::FIRST | DIFFCODE::THIRD | DIFFCODE::FILE;
 				AddToList(subdir[0], subdir[1], subdir[2], &aFiles[0][i], nullptr, &aFiles[2][k], nDiffCode, myStruct, parent);
@@ -407,8 +521,8 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 				++k;
 				continue;
 			}
-			else if ((j<aFiles[1].size() && k<aFiles[2].size() && collstr(aFiles[1][j].filename, aFiles[2][k].filename, casesensitive) == 0)
-			    && (i==aFiles[0].size() || collstr(aFiles[0][i].filename, aFiles[1][j].filename, casesensitive) != 0))
+			else if ((j<aFiles[1].size() && k<aFiles[2].size() && collkey(aFiles[1][j], aFiles[2][k]) == 0)
+			    && (i==aFiles[0].size() || collkey(aFiles[0][i], aFiles[1][j]) != 0))
 			{
 				const unsigned nDiffCode = DIFFCODE::SECOND | DIFFCODE::THIRD | DIFFCODE::FILE;
 				AddToList(subdir[0], subdir[1], subdir[2], nullptr, &aFiles[1][j], &aFiles[2][k], nDiffCode, myStruct, parent);
@@ -464,6 +578,28 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
 	return 1;
 }
 
+/**
+ * @brief Collect file- and folder-names to list.
+ * Folder listings are loaded on OPT_CMP_COMPARE_THREADS threads.
+ * @sa GetItems()
+ * @param [in] paths Root paths of compare
+ * @param [in] subdir Subdirectories under root paths
+ * @param [in] myStruct Compare-related data, like context etc.
+ * @param [in] casesensitive Is filename compare case sensitive?
+ * @param [in] depth Levels of subdirectories to scan, -1 scans all
+ * @param [in] parent Folder diff item to be scanned
+ * @param [in] bUniques If true, walk into unique folders.
+ * @return 1 normally, -1 if compare was aborted
+ */
+int DirScan_GetItems(const PathContext &paths, const String subdir[],
+		DiffFuncStruct *myStruct,
+		bool casesensitive, int depth, DIFFITEM *parent,
+		bool bUniques)
+{
+	DirCollector collector(GetWorkerThreadCount(), myStruct->context->m_stringPool);
+	return GetItems(collector, paths, subdir, nullptr, myStruct, casesensitive, depth, parent, bUniques);
+}
+
 /**
  * @brief Compare DiffItems in list and add results to compare context.
  *
@@ -472,52 +608,71 @@ int DirScan_GetItems(const PathContext &paths, const String subdir[],
  * @return >= 0 number of diff items, -1 if compare was aborted
  */
 int DirScan_CompareItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+{
+	if (GetOptionsMgr()->GetBool(OPT_CMP_COMPARE_LARGEST_FIRST))
+		return CompareWithWorkers(CompareItemsLargestFirst, DiffScheduler::SCHEDULE_LARGEST_FIRST, myStruct, parentdiffpos);
+	return CompareWithWorkers(CompareItems, DiffScheduler::SCHEDULE_TREE_ORDER, myStruct, parentdiffpos);
+}
+
+/**
+ * @brief Start the compare worker threads and run @p compareFunc with them.
+ * Workers are used only for the compare methods that read file contents,
+ * other methods are fast enough to be run on one worker. The number of
+ * workers reading from one disk is limited by OPT_CMP_COMPARE_READERS_PER_DEVICE.
+ * @param [in] compareFunc Function handing the items to the workers.
+ * @param [in] policy Order in which the workers take the items.
+ * @param [in] myStruct A structure containing compare-related data.
+ * @param [in] parentdiffpos Position of parent diff item
+ * @return Return value of @p compareFunc
+ */
+static int CompareWithWorkers(CompareFunc compareFunc, DiffScheduler::SchedulePolicy policy, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
 	const int compareMethod = myStruct->context->GetCompareMethod();
 	int nworkers = 1;
 
-	if (compareMethod == CMP_CONTENT || compareMethod == CMP_QUICK_CONTENT)
+	if (compareMethod == CMP_CONTENT || compareMethod == CMP_QUICK_CONTENT || compareMethod == CMP_HASH)
 	{
-		nworkers = GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_THREADS);
-		if (nworkers <= 0)
-		{
-			nworkers += Environment::processorCount();
-			if (nworkers <= 0)
-				nworkers = 1;
-		}
+		nworkers = GetWorkerThreadCount();
+	}
+
+	std::unique_ptr<DeviceIoLimiter> pIoLimiter;
+	if (nworkers > 1)
+	{
+		pIoLimiter.reset(new DeviceIoLimiter(myStruct->context->GetNormalizedPaths(),
+			GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_READERS_PER_DEVICE)));
 	}
 
 	ThreadPool threadPool(nworkers, nworkers);
 	std::vector<DiffWorkerPtr> workers;
-	NotificationQueue queue;
+	DiffScheduler scheduler(nworkers, policy);
 	myStruct->context->m_pCompareStats->SetCompareThreadCount(nworkers);
 	for (int i = 0; i < nworkers; ++i)
 	{
-		workers.push_back(DiffWorkerPtr(new DiffWorker(queue, myStruct->context, i)));
+		workers.push_back(DiffWorkerPtr(new DiffWorker(scheduler, pIoLimiter.get(), myStruct->context, i)));
 		threadPool.start(*workers[i]);
 	}
 
-	int res = CompareItems(queue, myStruct, parentdiffpos);
+	int res = compareFunc(scheduler, myStruct, parentdiffpos);
 
-	Thread::sleep(100);
-	queue.wakeUpAll();
+	scheduler.Shutdown();
 	threadPool.joinAll();
 
 	return res;
 }
 
-static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+static int CompareItems(DiffScheduler& scheduler, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
-	NotificationQueue queueResult;
+	DiffWorkGroup group;
+	DiffWorkBatch batch(scheduler, group);
 	Stopwatch stopwatch;
 	CDiffContext *pCtxt = myStruct->context;
 	int res = 0;
-	int count = 0;
 	bool bCompareFailure = false;
 	if (parentdiffpos == nullptr)
 		myStruct->pSemaphore->wait();
 	stopwatch.start();
 	DIFFITEM *pos = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
+	DIFFITEM *first = pos, *last = nullptr;
 	while (pos != nullptr)
 	{
 		if (pCtxt->ShouldAbort())
@@ -529,7 +684,13 @@ static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFF
 			myStruct->m_listeners.notify(myStruct, event);
 			stopwatch.restart();
 		}
-		myStruct->pSemaphore->wait();
+		// Don't hold a partial batch back from the workers while
+		// waiting for the collect thread to find more items
+		if (!myStruct->pSemaphore->tryWait(0))
+		{
+			batch.Flush();
+			myStruct->pSemaphore->wait();
+		}
 		DIFFITEM *curpos = pos;
 		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
 		bool existsalldirs = di.diffcode.existAll();
@@ -539,7 +700,8 @@ static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFF
 			{	// Only clear DIFF|SAME flags if not CMPERR (eg. both flags together)
 				di.diffcode.diffcode &= ~(DIFFCODE::DIFF | DIFFCODE::SAME);
 			}
-			int ndiff = CompareItems(queue, myStruct, curpos);
+			batch.Flush();
+			int ndiff = CompareItems(scheduler, myStruct, curpos);
 			// Propogate sub-directory status to this directory
 			if (ndiff > 0)
 			{	// There were differences in the sub-directories
@@ -560,43 +722,171 @@ static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFF
 				bCompareFailure = true;
 			}
 		}
-		if (existsalldirs)
-			queue.enqueueUrgentNotification(new WorkNotification(di, queueResult));
-		else
-			queue.enqueueNotification(new WorkNotification(di, queueResult));
-		++count;
+		// Items existing on all sides go to the front of the deques
+		batch.Add(&di, existsalldirs);
+		last = curpos;
 		pos = curpos;
 		pCtxt->GetNextSiblingDiffRefPosition(pos);
 	}
 
-	while (count > 0)
+	batch.Flush();
+	group.Wait();
+
+	// Collect the results of this level now that the workers are done with it
+	pos = (last != nullptr) ? first : nullptr;
+	while (pos != nullptr)
 	{
-		AutoPtr<Notification> pNf(queueResult.waitDequeueNotification());
-		if (pNf.get() == nullptr)
-			break;
-		WorkCompletedNotification* pWorkCompletedNf = dynamic_cast<WorkCompletedNotification*>(pNf.get());
-		if (pWorkCompletedNf != nullptr) {
-			DIFFITEM &di = pWorkCompletedNf->data();
-			if (di.diffcode.isResultError()) { 
-				DIFFITEM *diParent = di.GetParentLink();
-				assert(diParent != nullptr);
-				if (diParent != nullptr)
-				{
-					diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
-					bCompareFailure = true;
-				}
+		DIFFITEM *curpos = pos;
+		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
+		if (di.diffcode.isResultError()) { 
+			DIFFITEM *diParent = di.GetParentLink();
+			assert(diParent != nullptr);
+			if (diParent != nullptr)
+			{
+				diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
+				bCompareFailure = true;
 			}
-				
-			if (di.diffcode.isResultDiff() ||
-				(!di.diffcode.existAll() && !di.diffcode.isResultFiltered()))
-				res++;
 		}
-		--count;
+			
+		if (di.diffcode.isResultDiff() ||
+			(!di.diffcode.existAll() && !di.diffcode.isResultFiltered()))
+			res++;
+		if (curpos == last)
+			break;
 	}
 
 	return bCompareFailure || pCtxt->ShouldAbort() ? -1 : res;
 }
 
+/**
+ * @brief Hand all items under @p parentdiffpos to the workers.
+ * Unlike CompareItems() this does not wait for the items of a folder
+ * before continuing with the next folder, so the scheduler sees the items
+ * of the whole tree as soon as they have been collected.
+ * @return false if compare was aborted
+ */
+static bool SubmitItems(DiffWorkBatch &batch, Stopwatch &stopwatch, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+{
+	CDiffContext *pCtxt = myStruct->context;
+	DIFFITEM *pos = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
+	while (pos != nullptr)
+	{
+		if (pCtxt->ShouldAbort())
+			return false;
+
+		if (stopwatch.elapsed() > 2000000)
+		{
+			int event = CDiffThread::EVENT_COMPARE_PROGRESSED;
+			myStruct->m_listeners.notify(myStruct, event);
+			stopwatch.restart();
+		}
+		if (!myStruct->pSemaphore->tryWait(0))
+		{
+			batch.Flush();
+			myStruct->pSemaphore->wait();
+		}
+		DIFFITEM *curpos = pos;
+		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
+		if (di.diffcode.isDirectory() && pCtxt->m_bRecursive)
+		{
+			if ((di.diffcode.diffcode & DIFFCODE::CMPERR) != DIFFCODE::CMPERR)
+			{	// Only clear DIFF|SAME flags if not CMPERR (eg. both flags together)
+				di.diffcode.diffcode &= ~(DIFFCODE::DIFF | DIFFCODE::SAME);
+			}
+			if (!SubmitItems(batch, stopwatch, myStruct, curpos))
+				return false;
+		}
+		else
+		{
+			batch.Add(&di, false);
+		}
+		pos = curpos;
+		pCtxt->GetNextSiblingDiffRefPosition(pos);
+	}
+	return true;
+}
+
+/**
+ * @brief Set folder statuses from the results of compared items.
+ * @return >= 0 number of diff items, -1 if there were compare errors
+ */
+static int CollectResults(CDiffContext *pCtxt, DIFFITEM *parentdiffpos)
+{
+	int res = 0;
+	bool bCompareFailure = false;
+	DIFFITEM *pos = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
+	while (pos != nullptr)
+	{
+		DIFFITEM *curpos = pos;
+		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
+		bool existsalldirs = di.diffcode.existAll();
+		if (di.diffcode.isDirectory() && pCtxt->m_bRecursive)
+		{
+			int ndiff = CollectResults(pCtxt, curpos);
+			// Propogate sub-directory status to this directory
+			if (ndiff > 0)
+			{	// There were differences in the sub-directories
+				if (existsalldirs)
+					di.diffcode.diffcode |= DIFFCODE::DIFF;
+				res += ndiff;
+			}
+			else 
+			if (ndiff == 0)
+			{	// Sub-directories were identical
+				if (existsalldirs)
+					di.diffcode.diffcode |= DIFFCODE::SAME;
+			}
+			else
+			if (ndiff == -1)
+			{	// There were file IO-errors during sub-directory comparison.
+				di.diffcode.diffcode |= DIFFCODE::CMPERR;
+				bCompareFailure = true;
+			}
+			// Folders were not handed to the workers, their status is known only now
+			di.diffcode.diffcode &= ~DIFFCODE::NEEDSCAN;
+			pCtxt->m_pCompareStats->AddItem(di.diffcode.diffcode);
+		}
+		if (di.diffcode.isResultError()) { 
+			DIFFITEM *diParent = di.GetParentLink();
+			assert(diParent != nullptr);
+			if (diParent != nullptr)
+			{
+				diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
+				bCompareFailure = true;
+			}
+		}
+		if (di.diffcode.isResultDiff() ||
+			(!existsalldirs && !di.diffcode.isResultFiltered()))
+			res++;
+	}
+	return bCompareFailure ? -1 : res;
+}
+
+/**
+ * @brief Compare DiffItems in list, largest files first.
+ * All items are handed to a SCHEDULE_LARGEST_FIRST scheduler while they
+ * are collected. Folder statuses are set after all items have been compared.
+ * @return >= 0 number of diff items, -1 if compare was aborted
+ */
+static int CompareItemsLargestFirst(DiffScheduler& scheduler, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+{
+	CDiffContext *pCtxt = myStruct->context;
+	DiffWorkGroup group;
+	Stopwatch stopwatch;
+	if (parentdiffpos == nullptr)
+		myStruct->pSemaphore->wait();
+	stopwatch.start();
+	{
+		DiffWorkBatch batch(scheduler, group);
+		SubmitItems(batch, stopwatch, myStruct, parentdiffpos);
+	}
+	group.Wait();
+
+	if (pCtxt->ShouldAbort())
+		return -1;
+	return CollectResults(pCtxt, parentdiffpos);
+}
+
 /**
  * @brief Compare DiffItems in context marked for rescan.
  *
@@ -604,23 +894,30 @@ static int CompareItems(NotificationQueue& queue, DiffFuncStruct *myStruct, DIFF
  * @param parentdiffpos [in] Position of parent diff item 
  * @return >= 0 number of diff items, -1 if compare was aborted
  */
-static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+static int CompareRequestedItems(DiffScheduler& scheduler, DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
+	DiffWorkGroup group;
+	DiffWorkBatch batch(scheduler, group);
+	Stopwatch stopwatch;
 	CDiffContext *pCtxt = myStruct->context;
-	FolderCmp fc(pCtxt);
 	int res = 0;
 	bool bCompareFailure = false;
 	if (parentdiffpos == nullptr)
 		myStruct->pSemaphore->wait();
-	DIFFITEM *pos = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
+	stopwatch.start();
+	DIFFITEM *first = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
+	DIFFITEM *pos = first;
 	while (pos != nullptr)
 	{
 		if (pCtxt->ShouldAbort())
-		{
-			res = -1;
 			break;
-		}
 
+		if (stopwatch.elapsed() > 2000000)
+		{
+			int event = CDiffThread::EVENT_COMPARE_PROGRESSED;
+			myStruct->m_listeners.notify(myStruct, event);
+			stopwatch.restart();
+		}
 		DIFFITEM *curpos = pos;
 		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
 		bool existsalldirs = di.diffcode.existAll();
@@ -629,7 +926,8 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 			if (pCtxt->m_bRecursive)
 			{
 				di.diffcode.diffcode &= ~(DIFFCODE::DIFF | DIFFCODE::SAME);
-				int ndiff = CompareRequestedItems(myStruct, curpos);
+				batch.Flush();
+				int ndiff = CompareRequestedItems(scheduler, myStruct, curpos);
 				if (ndiff > 0)
 				{
 					if (existsalldirs)
@@ -653,30 +951,41 @@ static int CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffp
 		else
 		{
 			if (di.diffcode.isScanNeeded())
+				batch.Add(&di, existsalldirs);
+		}
+	}
+
+	batch.Flush();
+	group.Wait();
+
+	// Collect the results of this level now that the workers are done with it
+	pos = pCtxt->ShouldAbort() ? nullptr : first;
+	while (pos != nullptr)
+	{
+		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
+		if (!di.diffcode.isDirectory() && di.diffcode.isResultError()) { 
+			DIFFITEM *diParent = di.GetParentLink();
+			assert(diParent != nullptr);
+			if (diParent != nullptr)
 			{
-				CompareDiffItem(fc, di);
-				if (di.diffcode.isResultError()) { 
-					DIFFITEM *diParent = di.GetParentLink();
-					assert(diParent != nullptr);
-					if (diParent != nullptr)
-					{
-						diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
-						bCompareFailure = true;
-					}
-			}
-				
+				diParent->diffcode.diffcode |= DIFFCODE::CMPERR;
+				bCompareFailure = true;
 			}
 		}
 		if (di.diffcode.isResultDiff() ||
-			(!existsalldirs && !di.diffcode.isResultFiltered()))
+			(!di.diffcode.existAll() && !di.diffcode.isResultFiltered()))
 			res++;
 	}
-	return bCompareFailure ? -1 : res;;
+	return bCompareFailure || pCtxt->ShouldAbort() ? -1 : res;
 }
 
+/**
+ * @brief Compare DiffItems marked for rescan on the compare worker threads.
+ * Progress is reported through CompareStats as with DirScan_CompareItems().
+ */
 int DirScan_CompareRequestedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
-	return CompareRequestedItems(myStruct, parentdiffpos);
+	return CompareWithWorkers(CompareRequestedItems, DiffScheduler::SCHEDULE_TREE_ORDER, myStruct, parentdiffpos);
 }
 
 static int markChildrenForRescan(CDiffContext *pCtxt, DIFFITEM *parentdiffpos)
@@ -698,7 +1007,130 @@ static int markChildrenForRescan(CDiffContext *pCtxt, DIFFITEM *parentdiffpos)
 	return ncount;
 }
 
-int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
+/**
+ * @brief Items marked for rescan having the same parent folder.
+ */
+struct MarkedFolder
+{
+	std::vector<DIFFITEM *> items;
+};
+
+/**
+ * @brief Group items marked for rescan by their parent folder.
+ * Children of folders which DirScan_UpdateMarkedItems() collects again
+ * are not added.
+ */
+static void CollectMarkedFolders(CDiffContext *pCtxt, DIFFITEM *parentdiffpos, std::vector<MarkedFolder> &folders)
+{
+	MarkedFolder folder;
+	DIFFITEM *pos = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
+	while (pos != nullptr)
+	{
+		DIFFITEM *curpos = pos;
+		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
+		if (di.diffcode.isScanNeeded())
+			folder.items.push_back(&di);
+		if (di.diffcode.isDirectory() && pCtxt->m_bRecursive &&
+			!(di.diffcode.isScanNeeded() && !di.diffcode.isResultFiltered()))
+			CollectMarkedFolders(pCtxt, curpos, folders);
+	}
+	if (!folder.items.empty())
+		folders.push_back(std::move(folder));
+}
+
+/**
+ * @brief Find an item by name from a sorted folder listing.
+ */
+static const DirItem *FindDirItem(const DirItemArray &items, const String &filename, bool casesensitive)
+{
+	const String key = MakeCollationKey(filename, casesensitive);
+	auto it = std::lower_bound(items.begin(), items.end(), key,
+		[](const DirListItem &ent, const String &key) { return ent.collationKey.compare(key) < 0; });
+	if (it == items.end() || it->collationKey != key)
+		return nullptr;
+	return &*it;
+}
+
+/**
+ * @brief Update diffitem file/dir infos of one folder.
+ *
+ * Re-tests dirs/files if sides still exists, and updates infos for
+ * existing sides. This assumes filenames, or paths are not changed.
+ * Since in normal situations (I can think of) they cannot change
+ * after first compare.
+ *
+ * The folder is enumerated once per side instead of querying every
+ * item separately. Items which no longer exist on any side are left
+ * without side flags; DirScan_UpdateMarkedItems() removes them.
+ *
+ * @param [in,out] folder Items to update.
+ * @param [in] pCtxt Compare context
+ */
+static void UpdateMarkedFolder(MarkedFolder &folder, CDiffContext *pCtxt)
+{
+	for (DIFFITEM *di : folder.items)
+	{
+		di->diffcode.setSideNone();
+		for (int i = 0; i < pCtxt->GetCompareDirs(); ++i)
+			di->diffFileInfo[i].ClearPartial();
+	}
+	for (int i = 0; i < pCtxt->GetCompareDirs(); ++i)
+	{
+		const String &sSubdir = folder.items[0]->diffFileInfo[i].path;
+		DirItemArray dirs, files;
+		LoadAndSortFiles(paths::ConcatPath(pCtxt->GetNormalizedPath(i), sSubdir), &dirs, &files, pCtxt->m_bCaseSensitive, &pCtxt->m_stringPool);
+		for (DIFFITEM *di : folder.items)
+		{
+			if (pCtxt->ShouldAbort())
+				return;
+			bool bExists;
+			if (di->diffFileInfo[i].path.get() == sSubdir)
+			{
+				const String &filename = di->diffFileInfo[i].filename;
+				const DirItem *ent = FindDirItem(di->diffcode.isDirectory() ? dirs : files, filename, pCtxt->m_bCaseSensitive);
+				if (ent == nullptr)
+					ent = FindDirItem(di->diffcode.isDirectory() ? files : dirs, filename, pCtxt->m_bCaseSensitive);
+				bExists = (ent != nullptr);
+				if (bExists)
+					pCtxt->UpdateInfoFromDirItem(*di, i, *ent);
+			}
+			else
+			{
+				bExists = pCtxt->UpdateInfoFromDiskHalf(*di, i);
+			}
+			if (bExists)
+				di->diffcode.diffcode |= DIFFCODE::FIRST << i;
+		}
+	}
+}
+
+class MarkedFolderUpdater: public Runnable
+{
+public:
+	MarkedFolderUpdater(std::vector<MarkedFolder> &folders, std::atomic_size_t &next, CDiffContext *pCtxt):
+	  m_folders(folders), m_next(next), m_pCtxt(pCtxt) {}
+
+	void run()
+	{
+		size_t i;
+		while (!m_pCtxt->ShouldAbort() && (i = m_next++) < m_folders.size())
+			UpdateMarkedFolder(m_folders[i], m_pCtxt);
+	}
+
+private:
+	std::vector<MarkedFolder> &m_folders;
+	std::atomic_size_t &m_next;
+	CDiffContext *m_pCtxt;
+};
+
+typedef std::shared_ptr<MarkedFolderUpdater> MarkedFolderUpdaterPtr;
+
+/**
+ * @brief Remove deleted items marked for rescan and collect marked folders again.
+ * File/dir infos have been updated by UpdateMarkedFolder() already.
+ * @return Number of items to compare.
+ */
+static int UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
 	CDiffContext *pCtxt = myStruct->context;
 	DIFFITEM *pos = pCtxt->GetFirstChildDiffPosition(parentdiffpos);
@@ -712,12 +1144,9 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 		DIFFITEM &di = pCtxt->GetNextSiblingDiffRefPosition(pos);
 		if (di.diffcode.isScanNeeded())
 		{
-			bool bItemsExist = true;
-			UpdateDiffItem(di, bItemsExist, pCtxt);
-			if (!bItemsExist)
+			if ((di.diffcode.diffcode & DIFFCODE::SIDEFLAGS) == 0)
 			{ 
-				di.DelinkFromSiblings();	// delink from list of Siblings
-				delete &di;					// Also delete all Children items
+				pCtxt->RemoveDiff(curpos);	// Also removes all Children items
 				continue;					// (... because `di` is now invalid)
 			}
 			if (!di.diffcode.isDirectory())
@@ -730,10 +1159,10 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 					di.diffFileInfo[i].size = 0;
 			if (di.diffcode.isScanNeeded() && !di.diffcode.isResultFiltered())
 			{
-				di.RemoveChildren();
+				pCtxt->RemoveChildren(&di);
 				di.diffcode.diffcode &= ~DIFFCODE::NEEDSCAN;
 
-				bool casesensitive = false;
+				bool casesensitive = myStruct->context->m_bCaseSensitive;
 				int depth = myStruct->context->m_bRecursive ? -1 : 0;
 				String subdir[3];
 				PathContext paths = myStruct->context->GetNormalizedPaths();
@@ -745,7 +1174,7 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 			}
 			else
 			{
-				ncount += DirScan_UpdateMarkedItems(myStruct, curpos);
+				ncount += UpdateMarkedItems(myStruct, curpos);
 			}
 		}
 		if (parentdiffpos != nullptr && pCtxt->m_bRecursive)
@@ -757,33 +1186,35 @@ int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 	}
 	return ncount;
 }
+
 /**
- * @brief Update diffitem file/dir infos.
- *
- * Re-tests dirs/files if sides still exists, and updates infos for
- * existing sides. This assumes filenames, or paths are not changed.
- * Since in normal situations (I can think of) they cannot change
- * after first compare.
- *
- * @param [in,out] di DiffItem to update.
- * @param [out] bExists Set to
- *  - true if one of items exists so diffitem is valid
- *  - false if items were deleted, so diffitem is not valid
- * @param [in] pCtxt Compare context
+ * @brief Update items marked for rescan from disk.
+ * Folders containing marked items are enumerated on OPT_CMP_COMPARE_THREADS
+ * threads, then deleted items are removed and marked folders collected
+ * again on the calling thread.
+ * @return Number of items to compare.
  */
-static void UpdateDiffItem(DIFFITEM &di, bool & bExists, CDiffContext *pCtxt)
+int DirScan_UpdateMarkedItems(DiffFuncStruct *myStruct, DIFFITEM *parentdiffpos)
 {
-	bExists = false;
-	di.diffcode.setSideNone();
-	for (int i = 0; i < pCtxt->GetCompareDirs(); ++i)
+	CDiffContext *pCtxt = myStruct->context;
+	std::vector<MarkedFolder> folders;
+	CollectMarkedFolders(pCtxt, parentdiffpos, folders);
+
+	int nworkers = (std::min)(GetWorkerThreadCount(), static_cast<int>(folders.size()));
+	if (nworkers > 0)
 	{
-		di.diffFileInfo[i].ClearPartial();
-		if (pCtxt->UpdateInfoFromDiskHalf(di, i))
+		std::atomic_size_t next(0);
+		ThreadPool threadPool(nworkers, nworkers);
+		std::vector<MarkedFolderUpdaterPtr> updaters;
+		for (int i = 0; i < nworkers; ++i)
 		{
-			di.diffcode.diffcode |= DIFFCODE::FIRST << i;
-			bExists = true;
+			updaters.push_back(MarkedFolderUpdaterPtr(new MarkedFolderUpdater(folders, next, pCtxt)));
+			threadPool.start(*updaters[i]);
 		}
+		threadPool.joinAll();
 	}
+
+	return UpdateMarkedItems(myStruct, parentdiffpos);
 }
 
 /**
@@ -831,8 +1262,16 @@ static void CompareDiffItem(FolderCmp &fc, DIFFITEM &di)
 				// Set text statistics
 				if (di.diffcode.exists(i))
 				{
-					di.diffFileInfo[i].m_textStats = fc.m_diffFileData.m_textStats[i];
-					di.diffFileInfo[i].encoding = fc.m_diffFileData.m_FileLocation[i].encoding;
+					const FileTextStats &stats = fc.m_diffFileData.m_textStats[i];
+					const FileTextEncoding &encoding = fc.m_diffFileData.m_FileLocation[i].encoding;
+					// Quick compares leave these empty, don't allocate details for them
+					if (di.diffFileInfo[i].HasDetails() || encoding != FileTextEncoding() ||
+						stats.ncrs != 0 || stats.nlfs != 0 || stats.ncrlfs != 0 || stats.nzeros != 0)
+					{
+						DiffFileDetails &details = di.diffFileInfo[i].GetDetailsRef();
+						details.m_textStats = stats;
+						details.encoding = encoding;
+					}
 				}
 			}
 		}
@@ -872,9 +1311,10 @@ static DIFFITEM *AddToList(const String& sDir1, const String& sDir2, const Strin
 	// change to identical
 	DIFFITEM *di = myStruct->context->AddNewDiff(parent);
 
-	di->diffFileInfo[0].path = sDir1;
-	di->diffFileInfo[1].path = sDir2;
-	di->diffFileInfo[2].path = sDir3;
+	StringPool &pool = myStruct->context->m_stringPool;
+	di->diffFileInfo[0].path = pool.Intern(sDir1);
+	di->diffFileInfo[1].path = pool.Intern(sDir2);
+	di->diffFileInfo[2].path = pool.Intern(sDir3);
 
 	if (ent1 != nullptr)
 	{
@@ -23,17 +23,18 @@
 using Poco::DirectoryIterator;
 using Poco::Timestamp;
 
-static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files);
-static void Sort(DirItemArray * dirs, bool casesensitive);
+static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files, StringPool &pool, bool casesensitive);
+static void Sort(DirItemArray * dirs);
 
 /**
  * @brief Load arrays with all directories & files in specified dir
+ * @param [in] pool Pool for the names, `nullptr` for StringPool::Default().
  */
-void LoadAndSortFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files, bool casesensitive)
+void LoadAndSortFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files, bool casesensitive, StringPool *pool)
 {
-	LoadFiles(sDir, dirs, files);
-	Sort(dirs, casesensitive);
-	Sort(files, casesensitive);
+	LoadFiles(sDir, dirs, files, pool != nullptr ? *pool : StringPool::Default(), casesensitive);
+	Sort(dirs);
+	Sort(files);
 }
 
 /**
@@ -47,10 +48,12 @@ void LoadAndSortFiles(const String& sDir, DirItemArray * dirs, DirItemArray * fi
  * @param [in] sDir Base folder for files and subfolders.
  * @param [in, out] dirs Array where subfolder names are stored.
  * @param [in, out] files Array where file names are stored.
+ * @param [in] pool Pool for the names.
+ * @param [in] casesensitive Are the collation keys case sensitive?
  */
-static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files)
+static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files, StringPool &pool, bool casesensitive)
 {
-	boost::flyweight<String> dir(sDir);
+	PooledString dir = pool.Intern(sDir);
 #if 0
 	DirectoryIterator it(ucr::toUTF8(sDir));
 	DirectoryIterator end;
@@ -61,7 +64,7 @@ static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * fi
 		if (bIsDirectory)
 			continue;
 
-		DirItem ent;
+		DirListItem ent;
 		ent.ctime = it->created();
 		if (ent.ctime < 0)
 			ent.ctime = 0;
@@ -70,7 +73,8 @@ static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * fi
 			ent.mtime = 0;
 		ent.size = it->getSize();
 		ent.path = dir;
-		ent.filename = ucr::toTString(it.name());
+		ent.filename = pool.Intern(ucr::toTString(it.name()));
+		ent.collationKey = MakeCollationKey(ent.filename, casesensitive);
 		ent.flags.attributes = GetFileAttributes(ucr::toTString(it.name()).c_str());		
 		(bIsDirectory ? dirs : files)->push_back(ent);
 	}
@@ -92,7 +96,7 @@ static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * fi
 			if (bIsDirectory && _tcsstr(_T(".."), ff.cFileName))
 				continue;
 
-			DirItem ent;
+			DirListItem ent;
 
 			// Save filetimes as seconds since January 1, 1970
 			// Note that times can be < 0 if they are around that 1970..
@@ -113,7 +117,8 @@ static void LoadFiles(const String& sDir, DirItemArray * dirs, DirItemArray * fi
 			}
 
 			ent.path = dir;
-			ent.filename = ff.cFileName;
+			ent.filename = pool.Intern(ff.cFileName);
+			ent.collationKey = MakeCollationKey(ent.filename, casesensitive);
 			ent.flags.attributes = ff.dwFileAttributes;
 			
 			(bIsDirectory ? dirs : files)->push_back(ent);
@@ -134,25 +139,15 @@ static inline int collate_ignore_case(const String &str1, const String &str2)
 	return _tcsicoll(str1.c_str(), str2.c_str());
 }
 
-
-template<int (*compfunc)(const TCHAR *, const TCHAR *)>
-struct StringComparer
-{
-	bool operator()(const DirItem &elem1, const DirItem &elem2)
-	{
-		return compfunc(elem1.filename.get().c_str(), elem2.filename.get().c_str()) < 0;
-	}
-};
-
 /**
  * @brief sort specified array
+ * The order is the same as with collstr(), see MakeCollationKey().
  */
-static void Sort(DirItemArray * dirs, bool casesensitive)
+static void Sort(DirItemArray * dirs)
 {
-	if (casesensitive)
-        std::sort(dirs->begin(), dirs->end(), StringComparer<_tcscoll>());
-	else
-		std::sort(dirs->begin(), dirs->end(), StringComparer<_tcsicoll>());
+	std::sort(dirs->begin(), dirs->end(), [](const DirListItem &elem1, const DirListItem &elem2) {
+		return collkey(elem1, elem2) < 0;
+	});
 }
 
 /**
@@ -166,3 +161,27 @@ int collstr(const String & s1, const String & s2, bool casesensitive)
 	else
 		return collate_ignore_case(s1, s2);
 }
+
+/**
+ * @brief Return key for comparing names like collstr() does.
+ * WinMerge runs with the "C" locale of the C runtime, where _tcscoll()
+ * compares strings character by character and _tcsicoll() does the same
+ * after mapping ASCII letters A-Z to lowercase. Comparing keys with
+ * String::compare() then gives the same order as collstr() of the names,
+ * without collating the names again for every comparison.
+ * @param [in] name Name to make the key for.
+ * @param [in] casesensitive Is the key for case sensitive comparisons?
+ */
+String MakeCollationKey(const String & name, bool casesensitive)
+{
+	String key(name);
+	if (!casesensitive)
+	{
+		for (TCHAR &c : key)
+		{
+			if (c >= 'A' && c <= 'Z')
+				c += 'a' - 'A';
+		}
+	}
+	return key;
+}
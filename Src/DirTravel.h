@@ -8,10 +8,29 @@
 
 #include <vector>
 #include "UnicodeString.h"
+#include "DirItem.h"
 
-struct DirItem;
+class StringPool;
 
-typedef std::vector<DirItem> DirItemArray;
+/**
+ * @brief Entry of a folder listing loaded by LoadAndSortFiles().
+ */
+struct DirListItem : public DirItem
+{
+	String collationKey; /**< MakeCollationKey() of the filename */
+};
+
+typedef std::vector<DirListItem> DirItemArray;
 
-void LoadAndSortFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files, bool casesensitive);
+void LoadAndSortFiles(const String& sDir, DirItemArray * dirs, DirItemArray * files, bool casesensitive, StringPool *pool = nullptr);
 int collstr(const String & s1, const String & s2, bool casesensitive);
+String MakeCollationKey(const String & name, bool casesensitive);
+
+/**
+ * @brief Compare listing entries, same as collstr() of their filenames.
+ * The entries must come from listings loaded with the same case sensitivity.
+ */
+inline int collkey(const DirListItem & ent1, const DirListItem & ent2)
+{
+	return ent1.collationKey.compare(ent2.collationKey);
+}
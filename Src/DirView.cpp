@@ -1649,12 +1649,7 @@ void CDirView::DeleteItem(int sel, bool removeDIFFITEM)
 		DIFFITEM *diffpos = GetItemKey(sel);
 		m_pList->DeleteItem(sel);
 		if (diffpos != (DIFFITEM *)SPECIAL_ITEM_POS)
-		{
-			if (diffpos->HasChildren())
-				diffpos->RemoveChildren();
-			diffpos->DelinkFromSiblings();
-			delete diffpos;
-		}
+			GetDiffContext().RemoveDiff(diffpos);
 	}
 	else
 	{
@@ -3919,9 +3914,9 @@ void CDirView::OnSearch()
 				if (!ufile.OpenReadOnly(paths[i]))
 					continue;
 
-				ufile.SetUnicoding(di.diffFileInfo[i].encoding.m_unicoding);
-				ufile.SetBom(di.diffFileInfo[i].encoding.m_bom);
-				ufile.SetCodepage(di.diffFileInfo[i].encoding.m_codepage);
+				ufile.SetUnicoding(di.diffFileInfo[i].GetDetails().encoding.m_unicoding);
+				ufile.SetBom(di.diffFileInfo[i].GetDetails().encoding.m_bom);
+				ufile.SetCodepage(di.diffFileInfo[i].GetDetails().encoding.m_codepage);
 
 				ufile.ReadBom();
 
@@ -16,6 +16,7 @@
 #include "locality.h"
 #include "paths.h"
 #include "MergeApp.h"
+#include "DiffAlgorithmSelector.h"
 #include "DebugNew.h"
 
 using Poco::Timestamp;
@@ -57,6 +58,7 @@ const char *COLHDR_MENCODING    = N_("Middle Encoding");
 const char *COLHDR_NIDIFFS      = N_("Ignored Diff");
 const char *COLHDR_NSDIFFS      = N_("Differences");
 const char *COLHDR_BINARY       = NC_("DirView|ColumnHeader", "Binary");
+const char *COLHDR_ALGORITHM    = N_("Diff Algorithm");
 
 const char *COLDESC_FILENAME    = N_("Filename or folder name.");
 const char *COLDESC_DIR         = N_("Subfolder name when subfolders are included.");
@@ -91,6 +93,7 @@ const char *COLDESC_MENCODING   = N_("Middle side encoding.");
 const char *COLDESC_NIDIFFS     = N_("Number of ignored differences in file. These differences are ignored by WinMerge and cannot be merged.");
 const char *COLDESC_NSDIFFS     = N_("Number of differences in file. This number does not include ignored differences.");
 const char *COLDESC_BINARY      = N_("Shows an asterisk (*) if the file is binary.");
+const char *COLDESC_ALGORITHM   = N_("Diff algorithm chosen for the text file when the diff algorithm is auto.");
 }
 
 /**
@@ -185,8 +188,8 @@ static String MakeShortSize(int64_t size)
 template<class Type>
 static Type ColFileNameGet(const CDiffContext *, const void *p) //sfilename
 {
-	const boost::flyweight<String> &lfilename = static_cast<const DIFFITEM*>(p)->diffFileInfo[0].filename;
-	const boost::flyweight<String> &rfilename = static_cast<const DIFFITEM*>(p)->diffFileInfo[1].filename;
+	const PooledString &lfilename = static_cast<const DIFFITEM*>(p)->diffFileInfo[0].filename;
+	const PooledString &rfilename = static_cast<const DIFFITEM*>(p)->diffFileInfo[1].filename;
 	if (lfilename.get().empty())
 		return rfilename;
 	else if (rfilename.get().empty() || lfilename == rfilename)
@@ -497,22 +500,22 @@ static String GetVersion(const CDiffContext * pCtxt, const DIFFITEM *pdi, int nI
 {
 	DIFFITEM &di = const_cast<DIFFITEM &>(*pdi);
 	DiffFileInfo & dfi = di.diffFileInfo[nIndex];
-	if (dfi.version.IsCleared())
+	if (dfi.GetDetails().version.IsCleared())
 	{
 		pCtxt->UpdateVersion(di, nIndex);
 	}
-	return dfi.version.GetFileVersionString();
+	return dfi.GetDetails().version.GetFileVersionString();
 }
 
 static uint64_t GetVersionQWORD(const CDiffContext * pCtxt, const DIFFITEM *pdi, int nIndex)
 {
 	DIFFITEM &di = const_cast<DIFFITEM &>(*pdi);
 	DiffFileInfo & dfi = di.diffFileInfo[nIndex];
-	if (dfi.version.IsCleared())
+	if (dfi.GetDetails().version.IsCleared())
 	{
 		pCtxt->UpdateVersion(di, nIndex);
 	}
-	return dfi.version.GetFileVersionQWORD();
+	return dfi.GetDetails().version.GetFileVersionQWORD();
 }
 
 /**
@@ -634,6 +637,20 @@ static String ColBinGet(const CDiffContext *, const void *p)
 		return _T("");
 }
 
+/**
+ * @brief Format Diff Algorithm column data.
+ * @param [in] p Pointer to DIFFITEM.
+ * @return Algorithm chosen for the files, empty if not chosen automatically.
+ */
+static String ColAlgorithmGet(const CDiffContext *, const void *p)
+{
+	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
+
+	if (di.diffAlgorithm < 0)
+		return _T("");
+	return tr(DiffAlgorithmSelector::GetName(static_cast<DiffAlgorithm>(di.diffAlgorithm)));
+}
+
 /**
  * @brief Format File Attributes column data.
  * @param [in] p Pointer to file flags class.
@@ -653,7 +670,7 @@ static String ColAttrGet(const CDiffContext *, const void *p)
 static String ColEncodingGet(const CDiffContext *, const void *p)
 {
 	const DiffFileInfo &r = *static_cast<const DiffFileInfo *>(p);
-	return r.encoding.GetName();
+	return r.GetDetails().encoding.GetName();
 }
 
 /**
@@ -666,7 +683,7 @@ static String GetEOLType(const CDiffContext *, const void *p, int index)
 {
 	const DIFFITEM &di = *static_cast<const DIFFITEM *>(p);
 	const DiffFileInfo & dfi = di.diffFileInfo[index];
-	const FileTextStats &stats = dfi.m_textStats;
+	const FileTextStats &stats = dfi.GetDetails().m_textStats;
 
 	if (stats.ncrlfs == 0 && stats.ncrs == 0 && stats.nlfs == 0)
 	{
@@ -759,7 +776,7 @@ static int ColFileNameSort(const CDiffContext *pCtxt, const void *p, const void
 		return -1;
 	if (!ldi.diffcode.isDirectory() && rdi.diffcode.isDirectory())
 		return 1;
-	return strutils::compare_nocase(ColFileNameGet<boost::flyweight<String> >(pCtxt, p), ColFileNameGet<boost::flyweight<String> >(pCtxt, q));
+	return strutils::compare_nocase(ColFileNameGet<String>(pCtxt, p), ColFileNameGet<String>(pCtxt, q));
 }
 
 /**
@@ -920,6 +937,19 @@ static int ColBinSort(const CDiffContext *, const void *p, const void *q)
 		return 0;
 }
 
+/**
+ * @brief Compare diff algorithms chosen for the files.
+ * @param [in] p Pointer to first DIFFITEM to compare.
+ * @param [in] q Pointer to second DIFFITEM to compare.
+ * @return Compare result.
+ */
+static int ColAlgorithmSort(const CDiffContext *, const void *p, const void *q)
+{
+	const DIFFITEM &ldi = *static_cast<const DIFFITEM *>(p);
+	const DIFFITEM &rdi = *static_cast<const DIFFITEM *>(q);
+	return ldi.diffAlgorithm - rdi.diffAlgorithm;
+}
+
 /**
  * @brief Compare file flags.
  * @param [in] p Pointer to first flag structure to compare.
@@ -945,7 +975,7 @@ static int ColEncodingSort(const CDiffContext *, const void *p, const void *q)
 {
 	const DiffFileInfo &r = *static_cast<const DiffFileInfo *>(p);
 	const DiffFileInfo &s = *static_cast<const DiffFileInfo *>(q);
-	return FileTextEncoding::Collate(r.encoding, s.encoding);
+	return FileTextEncoding::Collate(r.GetDetails().encoding, s.GetDetails().encoding);
 }
 /* @} */
 
@@ -994,6 +1024,7 @@ static DirColInfo f_cols[] =
 	{ _T("Snidiffs"), nullptr, COLHDR_NIDIFFS, COLDESC_NIDIFFS, ColDiffsGet, ColDiffsSort, FIELD_OFFSET(DIFFITEM, nidiffs), -1, false, DirColInfo::ALIGN_RIGHT },
 	{ _T("Leoltype"), nullptr, COLHDR_LEOL_TYPE, COLDESC_LEOL_TYPE, &ColLEOLTypeGet, 0, 0, -1, true, DirColInfo::ALIGN_LEFT },
 	{ _T("Reoltype"), nullptr, COLHDR_REOL_TYPE, COLDESC_REOL_TYPE, &ColREOLTypeGet, 0, 0, -1, true, DirColInfo::ALIGN_LEFT },
+	{ _T("Algorithm"), nullptr, COLHDR_ALGORITHM, COLDESC_ALGORITHM, &ColAlgorithmGet, &ColAlgorithmSort, 0, -1, true, DirColInfo::ALIGN_LEFT },
 };
 static DirColInfo f_cols3[] =
 {
@@ -136,6 +136,18 @@ String GetMyDocuments()
 	return path;
 }
 
+/**
+ * @brief Return User's local (non-roaming) application data folder.
+ * @return Full path to the local application data folder.
+ */
+String GetLocalAppDataPath()
+{
+	TCHAR path[MAX_PATH];
+	path[0] = _T('\0');
+	SHGetFolderPath(nullptr, CSIDL_LOCAL_APPDATA, nullptr, 0, path);
+	return path;
+}
+
 /**
  * @brief Return unique string for the instance.
  * This function formats an unique string for WinMerge instance. The string
@@ -0,0 +1,253 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  FileIdentity.cpp
+ *
+ * @brief Implementation of functions telling if two paths have the same data.
+ *
+ * The contents of the files are not read. On Windows files are identified
+ * by volume serial number and file ID, which need an open handle. On POSIX
+ * systems by device and inode, and on Linux two files sharing all their
+ * extents on the same file system are recognized too. Callers which open
+ * the files anyway should pass the descriptors they have.
+ */
+
+#include "pch.h"
+#include "FileIdentity.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include "TFile.h"
+#else
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+#include "unicoder.h"
+#endif
+#include "DebugNew.h"
+
+namespace FileIdentity
+{
+
+#ifdef _WIN32
+
+/** @brief FILE_ID_INFO, not declared for the Windows versions WinMerge targets */
+struct FileIdInfo
+{
+	ULONGLONG VolumeSerialNumber;
+	BYTE FileId[16];
+};
+
+/** @brief FileIdInfo value of FILE_INFO_BY_HANDLE_CLASS */
+static const int FileIdInfoClass = 18;
+
+/**
+ * @brief Identity of an open file.
+ */
+struct FileId
+{
+	bool bExtended; /**< 128-bit ID from FileIdInfo, otherwise the 64-bit file index */
+	ULONGLONG volume;
+	BYTE id[16];
+};
+
+/**
+ * @brief Get the identity of an open file.
+ * The 64-bit file index is not unique on ReFS, so the 128-bit file ID is
+ * used where Windows provides it (Windows 8 and later).
+ */
+static bool GetFileId(HANDLE hFile, FileId& fid)
+{
+	typedef BOOL (WINAPI *GetFileInformationByHandleExFunc)(HANDLE, int, LPVOID, DWORD);
+	static GetFileInformationByHandleExFunc pfnGetFileInformationByHandleEx =
+		(GetFileInformationByHandleExFunc)GetProcAddress(GetModuleHandle(_T("kernel32.dll")), "GetFileInformationByHandleEx");
+
+	memset(&fid, 0, sizeof(fid));
+	FileIdInfo info;
+	if (pfnGetFileInformationByHandleEx != nullptr &&
+		pfnGetFileInformationByHandleEx(hFile, FileIdInfoClass, &info, sizeof(info)))
+	{
+		fid.bExtended = true;
+		fid.volume = info.VolumeSerialNumber;
+		memcpy(fid.id, info.FileId, sizeof(fid.id));
+	}
+	else
+	{
+		BY_HANDLE_FILE_INFORMATION hfi;
+		if (!GetFileInformationByHandle(hFile, &hfi))
+			return false;
+		fid.bExtended = false;
+		fid.volume = hfi.dwVolumeSerialNumber;
+		memcpy(fid.id, &hfi.nFileIndexLow, sizeof(hfi.nFileIndexLow));
+		memcpy(fid.id + sizeof(hfi.nFileIndexLow), &hfi.nFileIndexHigh, sizeof(hfi.nFileIndexHigh));
+	}
+	// Some network file systems don't have file IDs
+	static const BYTE zeros[sizeof(fid.id)] = {};
+	return memcmp(fid.id, zeros, sizeof(fid.id)) != 0;
+}
+
+/**
+ * @brief Compare two files opened by the caller by their metadata.
+ * @param [in] hFile1 Handle of the first file.
+ * @param [in] hFile2 Handle of the second file.
+ * @return How the files were found to have the same data.
+ */
+Result CompareHandles(HANDLE hFile1, HANDLE hFile2)
+{
+	FileId fid1, fid2;
+	if (hFile1 != INVALID_HANDLE_VALUE && hFile2 != INVALID_HANDLE_VALUE &&
+		GetFileId(hFile1, fid1) && GetFileId(hFile2, fid2) &&
+		fid1.bExtended == fid2.bExtended && fid1.volume == fid2.volume &&
+		memcmp(fid1.id, fid2.id, sizeof(fid1.id)) == 0)
+	{
+		return SAME_FILE;
+	}
+	return UNKNOWN;
+}
+
+/**
+ * @brief Compare two files by their metadata.
+ * @param [in] path1 Path of the first file.
+ * @param [in] path2 Path of the second file.
+ * @return How the files were found to have the same data.
+ */
+Result Compare(const String& path1, const String& path2)
+{
+	const DWORD dwShareMode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+	HANDLE hFile1 = CreateFileW(TFile(path1).wpath().c_str(), FILE_READ_ATTRIBUTES, dwShareMode,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+	HANDLE hFile2 = CreateFileW(TFile(path2).wpath().c_str(), FILE_READ_ATTRIBUTES, dwShareMode,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+	const Result result = CompareHandles(hFile1, hFile2);
+	if (hFile1 != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile1);
+	if (hFile2 != INVALID_HANDLE_VALUE)
+		CloseHandle(hFile2);
+	return result;
+}
+
+/**
+ * @brief Compare two files opened by the caller by their metadata.
+ * @param [in] fd1 Descriptor of the first file.
+ * @param [in] fd2 Descriptor of the second file.
+ * @return How the files were found to have the same data.
+ */
+Result Compare(int fd1, int fd2)
+{
+	if (fd1 == fd2)
+		return fd1 >= 0 ? SAME_FILE : UNKNOWN;
+	return CompareHandles(reinterpret_cast<HANDLE>(_get_osfhandle(fd1)), reinterpret_cast<HANDLE>(_get_osfhandle(fd2)));
+}
+
+#else
+
+#ifdef FS_IOC_FIEMAP
+/**
+ * @brief Get the extents of an open file.
+ * Dirty data is not written back for this, so a file with data not
+ * allocated yet fails like one whose extent locations don't tell their
+ * data: stored inline or as a tail, compressed or encrypted.
+ * @param [in] fd Descriptor of the file.
+ * @param [out] extents Extents of the file.
+ * @return true if the file has extents and they all are shared.
+ */
+static bool GetSharedExtents(int fd, std::vector<fiemap_extent>& extents)
+{
+	const unsigned ExtentBatch = 128;
+	const uint32_t UnsafeFlags = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+		FIEMAP_EXTENT_DATA_ENCRYPTED | FIEMAP_EXTENT_NOT_ALIGNED | FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL;
+	std::vector<uint64_t> buf((sizeof(fiemap) + ExtentBatch * sizeof(fiemap_extent)) / sizeof(uint64_t) + 1);
+	fiemap *fm = reinterpret_cast<fiemap *>(buf.data());
+	uint64_t start = 0;
+	for (;;)
+	{
+		memset(fm, 0, sizeof(fiemap));
+		fm->fm_start = start;
+		fm->fm_length = FIEMAP_MAX_OFFSET - start;
+		fm->fm_flags = 0;
+		fm->fm_extent_count = ExtentBatch;
+		if (ioctl(fd, FS_IOC_FIEMAP, fm) != 0 || fm->fm_mapped_extents == 0)
+			return false;
+		for (unsigned i = 0; i < fm->fm_mapped_extents; ++i)
+		{
+			const fiemap_extent &ext = fm->fm_extents[i];
+			if ((ext.fe_flags & UnsafeFlags) != 0 || (ext.fe_flags & FIEMAP_EXTENT_SHARED) == 0)
+				return false;
+			extents.push_back(ext);
+			if (ext.fe_flags & FIEMAP_EXTENT_LAST)
+				return true;
+		}
+		const fiemap_extent &last = fm->fm_extents[fm->fm_mapped_extents - 1];
+		start = last.fe_logical + last.fe_length;
+	}
+}
+#endif
+
+/**
+ * @brief Compare two files of known status by their metadata.
+ */
+static Result CompareStats(int fd1, int fd2, const struct stat& st1, const struct stat& st2)
+{
+	if (st1.st_dev != st2.st_dev)
+		return UNKNOWN;
+	if (st1.st_ino == st2.st_ino)
+		return SAME_FILE;
+#ifdef FS_IOC_FIEMAP
+	if (fd1 >= 0 && fd2 >= 0 &&
+		S_ISREG(st1.st_mode) && S_ISREG(st2.st_mode) && st1.st_size == st2.st_size && st1.st_size > 0)
+	{
+		// Physical locations of the same file system are comparable
+		std::vector<fiemap_extent> extents1, extents2;
+		if (GetSharedExtents(fd1, extents1) && GetSharedExtents(fd2, extents2) &&
+			extents1.size() == extents2.size() &&
+			std::equal(extents1.begin(), extents1.end(), extents2.begin(),
+				[](const fiemap_extent &ext1, const fiemap_extent &ext2) {
+					return ext1.fe_logical == ext2.fe_logical &&
+						ext1.fe_physical == ext2.fe_physical &&
+						ext1.fe_length == ext2.fe_length;
+				}))
+		{
+			return SHARED_EXTENTS;
+		}
+	}
+#endif
+	return UNKNOWN;
+}
+
+/**
+ * @brief Compare two files by their metadata.
+ * The files are not opened, so shared extents are not recognized.
+ * @param [in] path1 Path of the first file.
+ * @param [in] path2 Path of the second file.
+ * @return How the files were found to have the same data.
+ */
+Result Compare(const String& path1, const String& path2)
+{
+	struct stat st1, st2;
+	if (stat(ucr::toUTF8(path1).c_str(), &st1) != 0 || stat(ucr::toUTF8(path2).c_str(), &st2) != 0)
+		return UNKNOWN;
+	return CompareStats(-1, -1, st1, st2);
+}
+
+/**
+ * @brief Compare two files opened by the caller by their metadata.
+ * @param [in] fd1 Descriptor of the first file.
+ * @param [in] fd2 Descriptor of the second file.
+ * @return How the files were found to have the same data.
+ */
+Result Compare(int fd1, int fd2)
+{
+	struct stat st1, st2;
+	if (fd1 < 0 || fd2 < 0 || fstat(fd1, &st1) != 0 || fstat(fd2, &st2) != 0)
+		return UNKNOWN;
+	return CompareStats(fd1, fd2, st1, st2);
+}
+
+#endif
+
+}
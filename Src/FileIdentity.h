@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  FileIdentity.h
+ *
+ * @brief Declaration of functions telling if two paths have the same data.
+ */
+#pragma once
+
+#include "UnicodeString.h"
+
+namespace FileIdentity
+{
+
+/**
+ * @brief Result of comparing two files by their metadata.
+ */
+enum Result
+{
+	UNKNOWN,        /**< Files may or may not be identical */
+	SAME_FILE,      /**< Paths refer to the same file (hard links, bind mounts) */
+	SHARED_EXTENTS, /**< Different files sharing all their data blocks (reflinks) */
+};
+
+Result Compare(const String& path1, const String& path2);
+Result Compare(int fd1, int fd2);
+#ifdef _WIN32
+Result CompareHandles(void *hFile1, void *hFile2);
+#endif
+
+}
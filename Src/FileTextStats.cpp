@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  FileTextStats.cpp
+ *
+ * @brief Vectorized EOL and zero byte counting for FileTextStats.
+ */
+
+#include "pch.h"
+#include "FileTextStats.h"
+#include <cstdint>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define TEXTSTATS_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER) || defined(__GNUC__)
+#define TEXTSTATS_AVX2
+#include <immintrin.h>
+#endif
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+/** @brief Counts of one scanned range. */
+struct Counts
+{
+	int64_t crs;
+	int64_t lfs;
+	int64_t pairs; /**< CRs followed by a LF */
+	int64_t zeros;
+};
+
+typedef size_t (*BlockScanFunc)(const unsigned char *p, size_t size, Counts &counts);
+
+/**
+ * @brief Scalar scan of [i, size) after the vectorized part.
+ * @return 1 if the last byte is a CR which may start a CR+LF pair.
+ */
+int ScanTail(const unsigned char *p, size_t i, size_t size, Counts &counts)
+{
+	for (; i < size; ++i)
+	{
+		const unsigned char ch = p[i];
+		if (ch == 0)
+			++counts.zeros;
+		else if (ch == '\r')
+		{
+			if (i + 1 == size)
+				return 1;
+			if (p[i + 1] == '\n')
+			{
+				++counts.pairs;
+				++i;
+			}
+			else
+				++counts.crs;
+		}
+		else if (ch == '\n')
+			++counts.lfs;
+	}
+	return 0;
+}
+
+#ifdef TEXTSTATS_SSE2
+
+/** @brief Sum the byte counters of @p acc into @p total. */
+inline void Flush(__m128i acc, int64_t &total)
+{
+	__m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+	total += _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+
+/**
+ * @brief Count EOL and zero bytes 16 bytes at a time.
+ * CR+LF pairs are found by comparing the byte after each CR, so the
+ * block loop stops one byte before the end. Counts are kept in byte
+ * lanes and summed every 255 blocks.
+ * @return Offset where the scalar scan continues.
+ */
+size_t ScanBlocksSSE2(const unsigned char *p, size_t size, Counts &counts)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	int64_t crs = 0, lfs = 0, pairs = 0, zeros = 0;
+	size_t i = 0;
+	while (i + 17 <= size)
+	{
+		__m128i accCr = zero, accLf = zero, accPair = zero, accZero = zero;
+		for (int n = 0; n < 255 && i + 17 <= size; ++n, i += 16)
+		{
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+			__m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 1));
+			__m128i isCr = _mm_cmpeq_epi8(v, cr);
+			accCr = _mm_sub_epi8(accCr, isCr);
+			accLf = _mm_sub_epi8(accLf, _mm_cmpeq_epi8(v, lf));
+			accPair = _mm_sub_epi8(accPair, _mm_and_si128(isCr, _mm_cmpeq_epi8(next, lf)));
+			accZero = _mm_sub_epi8(accZero, _mm_cmpeq_epi8(v, zero));
+		}
+		Flush(accCr, crs);
+		Flush(accLf, lfs);
+		Flush(accPair, pairs);
+		Flush(accZero, zeros);
+	}
+	// The LF of a pair ending the blocks belongs to the blocks
+	if (i > 0 && p[i - 1] == '\r' && p[i] == '\n')
+	{
+		++lfs;
+		++i;
+	}
+	counts.crs += crs - pairs;
+	counts.lfs += lfs - pairs;
+	counts.pairs += pairs;
+	counts.zeros += zeros;
+	return i;
+}
+
+#ifdef TEXTSTATS_AVX2
+
+#ifdef __GNUC__
+#define TEXTSTATS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TEXTSTATS_TARGET_AVX2
+#endif
+
+TEXTSTATS_TARGET_AVX2 inline void Flush(__m256i acc, int64_t &total)
+{
+	__m256i sum = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+	__m128i sum128 = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	total += _mm_cvtsi128_si32(sum128) + _mm_cvtsi128_si32(_mm_srli_si128(sum128, 8));
+}
+
+/**
+ * @brief Count EOL and zero bytes 32 bytes at a time.
+ * Same as ScanBlocksSSE2() with 256-bit vectors.
+ */
+TEXTSTATS_TARGET_AVX2 size_t ScanBlocksAVX2(const unsigned char *p, size_t size, Counts &counts)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	int64_t crs = 0, lfs = 0, pairs = 0, zeros = 0;
+	size_t i = 0;
+	while (i + 33 <= size)
+	{
+		__m256i accCr = zero, accLf = zero, accPair = zero, accZero = zero;
+		for (int n = 0; n < 255 && i + 33 <= size; ++n, i += 32)
+		{
+			__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+			__m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i + 1));
+			__m256i isCr = _mm256_cmpeq_epi8(v, cr);
+			accCr = _mm256_sub_epi8(accCr, isCr);
+			accLf = _mm256_sub_epi8(accLf, _mm256_cmpeq_epi8(v, lf));
+			accPair = _mm256_sub_epi8(accPair, _mm256_and_si256(isCr, _mm256_cmpeq_epi8(next, lf)));
+			accZero = _mm256_sub_epi8(accZero, _mm256_cmpeq_epi8(v, zero));
+		}
+		Flush(accCr, crs);
+		Flush(accLf, lfs);
+		Flush(accPair, pairs);
+		Flush(accZero, zeros);
+	}
+	if (i > 0 && p[i - 1] == '\r' && p[i] == '\n')
+	{
+		++lfs;
+		++i;
+	}
+	counts.crs += crs - pairs;
+	counts.lfs += lfs - pairs;
+	counts.pairs += pairs;
+	counts.zeros += zeros;
+	return i;
+}
+
+/**
+ * @brief Check if the CPU and the OS support AVX2.
+ */
+bool HasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	const bool bOSXSave = (info[2] & (1 << 27)) != 0;
+	const bool bAVX = (info[2] & (1 << 28)) != 0;
+	if (!bOSXSave || !bAVX || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // TEXTSTATS_AVX2
+
+#endif // TEXTSTATS_SSE2
+
+#ifndef TEXTSTATS_SSE2
+size_t ScanBlocksNone(const unsigned char *, size_t, Counts &)
+{
+	return 0;
+}
+#endif
+
+BlockScanFunc GetBlockScanFunc()
+{
+#if defined(TEXTSTATS_AVX2)
+	return HasAVX2() ? ScanBlocksAVX2 : ScanBlocksSSE2;
+#elif defined(TEXTSTATS_SSE2)
+	return ScanBlocksSSE2;
+#else
+	return ScanBlocksNone;
+#endif
+}
+
+}
+
+/**
+ * @brief Count EOL and zero bytes of a buffer.
+ * The counts are added to the given counters. Uses AVX2 or SSE2
+ * depending on the CPU, with a scalar loop for the end of the buffer.
+ * A CR at the end of the buffer isn't counted because the next buffer
+ * may start with LF. It is passed to the next call as @p pendingCR, or
+ * counted as CR by the caller at the end of the file.
+ * @param [in] ptr Buffer to scan.
+ * @param [in] size Size of the buffer.
+ * @param [in] pendingCR Did the previous buffer end with a CR?
+ * @param [in,out] ncrs Count of CRs not followed by LF.
+ * @param [in,out] nlfs Count of LFs not preceded by CR.
+ * @param [in,out] ncrlfs Count of CR+LF pairs.
+ * @param [in,out] nzeros Count of zero bytes.
+ * @return 1 if the buffer ends with a CR (or is empty and @p pendingCR is set).
+ */
+extern "C" int ScanTextStats(const char *ptr, size_t size, int pendingCR,
+	__int64 *ncrs, __int64 *nlfs, __int64 *ncrlfs, __int64 *nzeros)
+{
+	static const BlockScanFunc scanBlocks = GetBlockScanFunc();
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(ptr);
+	Counts counts = {};
+	int result = 0;
+	if (pendingCR && size == 0)
+		return 1;
+	if (pendingCR)
+	{
+		if (p[0] == '\n')
+		{
+			++counts.pairs;
+			++p;
+			--size;
+		}
+		else
+			++counts.crs;
+	}
+	size_t i = scanBlocks(p, size, counts);
+	result = ScanTail(p, i, size, counts);
+	*ncrs += counts.crs;
+	*nlfs += counts.lfs;
+	*ncrlfs += counts.pairs;
+	*nzeros += counts.zeros;
+	return result;
+}
@@ -5,6 +5,16 @@
  */
 #pragma once
 
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C"
+#endif
+int ScanTextStats(const char *ptr, size_t size, int pendingCR,
+	__int64 *ncrs, __int64 *nlfs, __int64 *ncrlfs, __int64 *nzeros);
+
+#ifdef __cplusplus
+
 /**
  * @brief Structure containing statistics about compared file.
  * This structure contains EOL-byte and zero-byte statistics from compared
@@ -19,4 +29,14 @@ struct FileTextStats
 	__int64 nzeros; /**< Count of zero-bytes. */
 	FileTextStats() { clear(); }
 	void clear() { ncrs = nlfs = ncrlfs = nzeros = 0; }
+	/**
+	 * @brief Add the counts of a buffer, see ScanTextStats().
+	 * @return true if the buffer ends with a CR.
+	 */
+	bool Scan(const char *ptr, size_t size, bool bPendingCR)
+	{
+		return ScanTextStats(ptr, size, bPendingCR, &ncrs, &nlfs, &ncrlfs, &nzeros) != 0;
+	}
 };
+
+#endif
@@ -18,23 +18,38 @@
 #include "FileTransform.h"
 #include "codepage_detect.h"
 #include "BinaryCompare.h"
+#include "HashCompare.h"
 #include "TimeSizeCompare.h"
 #include "TFile.h"
 #include "FileFilterHelper.h"
+#include "CompareStats.h"
+#include "ContentHashCache.h"
+#include "FileIdentity.h"
+#include "DeviceIoLimiter.h"
 #include "DebugNew.h"
 
 using CompareEngines::ByteCompare;
 using CompareEngines::BinaryCompare;
+using CompareEngines::HashCompare;
+using CompareEngines::NWayCompare;
 using CompareEngines::TimeSizeCompare;
 using CompareEngines::ImageCompare;
 
 static void GetComparePaths(CDiffContext * pCtxt, const DIFFITEM &di, PathContext & files);
+static bool IsPluginUsed(const PackingInfo * infoUnpacker, const PrediffingInfo * infoPrediffer);
+static bool HasFileLargerThan(const DIFFITEM &di, int nDirs, int size);
+static int GetIdenticalFilesCode(const FileTextStats &stats);
+static void ClearEngineResults(DIFFITEM &di, int nDirs);
+static bool SetPairData(DiffFileData &diffdata, const NWayCompare &nway, int nFirst, int nSecond);
 
-FolderCmp::FolderCmp(CDiffContext *pCtxt)
+FolderCmp::FolderCmp(CDiffContext *pCtxt, DeviceIoLimiter *pIoLimiter)
 : m_pCtxt(pCtxt)
+, m_pIoLimiter(pIoLimiter)
 , m_pDiffUtilsEngine(nullptr)
 , m_pByteCompare(nullptr)
 , m_pBinaryCompare(nullptr)
+, m_pHashCompare(nullptr)
+, m_pNWayCompare(nullptr)
 , m_pTimeSizeCompare(nullptr)
 , m_ndiffs(CDiffContext::DIFFS_UNKNOWN)
 , m_ntrivialdiffs(CDiffContext::DIFFS_UNKNOWN)
@@ -70,6 +85,12 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 	int nDirs = m_pCtxt->GetCompareDirs();
 
 	unsigned code = DIFFCODE::FILE | DIFFCODE::CMPERR;
+	di.firstDiffOffset = -1;
+	di.diffAlgorithm = -1;
+
+	// Read slots on the disks of the files, held only while the files are
+	// opened and read, not while the data read is compared
+	DeviceIoSlots ioSlots(m_pIoLimiter, di);
 
 	if (nCompMethod == CMP_CONTENT || nCompMethod == CMP_QUICK_CONTENT)
 	{
@@ -105,6 +126,9 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		String filepathUnpacked[3];
 		String filepathTransformed[3];
 		int codepage = 0;
+		bool bSame10 = false, bSame12 = false, bSame02 = false;
+		bool bReadOnce = false;
+		bool bReadByNWay = false;
 
 		// For user chosen plugins, define bAutomaticUnpacker as false and use the chosen infoHandler
 		// but how can we receive the infoHandler ? DirScan actually only 
@@ -125,8 +149,73 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		FileTextEncoding encoding[3];
 		bool bForceUTF8 = m_pCtxt->GetCompareOptions(nCompMethod)->m_bIgnoreCase;
 
+		// A file compared to the same file is read only once. The files
+		// opened for the compare are identified after opening them.
+		const bool bTriage = nDirs == 2 && !IsPluginUsed(infoUnpacker, infoPrediffer);
+
+		// Files unchanged since an earlier compare are not read at all.
+		// Content hashes of other files are computed from the data the
+		// compare reads and stored after the compare.
+		const bool bUseHashCache = m_pCtxt->m_pContentHashCache != nullptr &&
+			di.diffcode.existAll() && !IsPluginUsed(infoUnpacker, infoPrediffer);
+		ContentHashEntry hashEntries[3];
+		bool bHashed[3] = {};
+		if (bUseHashCache && CompareByContentHash(di, tFiles, nCompMethod, encoding, code))
+			goto exitPrepAndCompare;
+
+		// If either file is larger than limit compare files by quick contents
+		// This allows us to (faster) compare big binary files
+		if (nCompMethod == CMP_CONTENT && HasFileLargerThan(di, nDirs, m_pCtxt->m_nQuickCompareLimit))
+		{
+			nCompMethod = CMP_QUICK_CONTENT;
+		}
+
+		// Large files are read from start to end, let the system read ahead
+		m_diffFileData.SetSequentialScan(HasFileLargerThan(di, nDirs, m_pCtxt->m_nQuickCompareLimit));
+
+		// Without plugins a 2-way full contents compare opens and reads each
+		// file only once: the encodings are guessed from the start of the
+		// data the compare engine then uses. Full contents compare reads whole
+		// files anyway and is used only for files up to the quick compare
+		// limit. Quick contents compare streams the files as before.
+		if (nDirs == 2 && !IsPluginUsed(infoUnpacker, infoPrediffer) && nCompMethod == CMP_CONTENT)
+		{
+			ioSlots.Acquire();
+			m_diffFileData.SetDisplayFilepaths(tFiles[0], tFiles[1]); // store true names for diff utils patch file
+			if (!m_diffFileData.OpenFiles(tFiles[0], tFiles[1]))
+				goto exitPrepAndCompare;
+			if (TriageByMetadata(di, nCompMethod, m_diffFileData.m_inf) == TRIAGE_SAME)
+				m_diffFileData.ShareFirstFile();
+			if (!m_diffFileData.ReadFiles())
+				goto exitPrepAndCompare;
+			ioSlots.Release();
+			bReadOnce = true;
+			for (nIndex = 0; bUseHashCache && nIndex < nDirs; nIndex++)
+			{
+				const file_data &inf = m_diffFileData.m_inf[nIndex];
+				if (inf.preloaded)
+				{
+					ContentHashCache::ComputeDigest(inf.buffer, inf.buffered_chars, hashEntries[nIndex]);
+					bHashed[nIndex] = true;
+				}
+			}
+		}
+
 		for (nIndex = 0; nIndex < nDirs; nIndex++)
 		{
+			if (bReadOnce)
+			{
+				filepathUnpacked[nIndex] = filepathTransformed[nIndex] = tFiles[nIndex];
+				// Both sides share one buffer when a file is compared to itself
+				const file_data &inf = m_diffFileData.m_inf[m_diffFileData.m_inf[nIndex].preloaded ? nIndex : 0];
+				// Guessing from the file maps all of it, so look at all the data
+				const size_t size = static_cast<size_t>(inf.buffered_chars);
+				encoding[nIndex] = GuessCodepageEncoding(tFiles[nIndex],
+					size > 0 ? inf.buffer : nullptr, size, m_pCtxt->m_iGuessEncodingType);
+				m_diffFileData.m_FileLocation[nIndex].encoding = encoding[nIndex];
+				continue;
+			}
+
 		// plugin may alter filepaths to temp copies (which we delete before returning in all cases)
 			filepathUnpacked[nIndex] = tFiles[nIndex];
 
@@ -145,7 +234,9 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			// Unpacked files will be deleted at end of this function.
 			filepathTransformed[nIndex] = filepathUnpacked[nIndex];
 
+			ioSlots.Acquire();
 			encoding[nIndex] = GuessCodepageEncoding(filepathTransformed[nIndex], m_pCtxt->m_iGuessEncodingType);
+			ioSlots.Release();
 			m_diffFileData.m_FileLocation[nIndex].encoding = encoding[nIndex];
 		}
 
@@ -158,6 +249,13 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			if (infoPrediffer && !m_diffFileData.Filepath_Transform(bForceUTF8, encoding[nIndex], filepathUnpacked[nIndex], filepathTransformed[nIndex], filteredFilenames, infoPrediffer))
 				goto exitPrepAndCompare;
 		}
+		// Files converted to UTF-8 are compared from the converted copies
+		if (bReadOnce && !std::equal(filepathTransformed, filepathTransformed + nDirs, filepathUnpacked))
+		{
+			m_diffFileData.Reset();
+			bReadOnce = false;
+			std::fill(bHashed, bHashed + nDirs, false);
+		}
 
 		// If options are binary equivalent, we could check for filesize
 		// difference here, and bail out if files are clearly different
@@ -167,37 +265,85 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		// Actually compare the files
 		// `diffutils_compare_files()` is a fairly thin front-end to GNU diffutils
 
-		if (tFiles.GetSize() == 2)
+		// In 3-way compare read each file once, before any pair is opened,
+		// to find identical files. Pairs of identical files are not opened
+		// or compared again below, and the other pairs are compared from
+		// the data read here. Files over the quick compare limit are not
+		// read to memory: quick contents compare streams each pair of them.
+		if (tFiles.GetSize() == 3 && di.diffcode.existAll() &&
+			!HasFileLargerThan(di, nDirs, m_pCtxt->m_nQuickCompareLimit))
+		{
+			if (m_pNWayCompare == nullptr)
+				m_pNWayCompare.reset(new NWayCompare());
+			ioSlots.Acquire();
+			if (!m_pNWayCompare->CompareFiles(filepathTransformed, 3))
+				goto exitPrepAndCompare;
+			bReadByNWay = true;
+			bSame10 = m_pNWayCompare->IsIdentical(1, 0);
+			bSame12 = m_pNWayCompare->IsIdentical(1, 2);
+			bSame02 = m_pNWayCompare->IsIdentical(0, 2);
+			for (nIndex = 0; nIndex < nDirs; nIndex++)
+				m_diffFileData.m_textStats[nIndex] = m_pNWayCompare->GetTextStats(nIndex);
+			if (m_pNWayCompare->IsAllIdentical())
+			{
+				code = DIFFCODE::FILE | DIFFCODE::SAME;
+				if (m_diffFileData.m_textStats[0].nzeros > 0)
+					code |= DIFFCODE::BIN | DIFFCODE::BINSIDE1 | DIFFCODE::BINSIDE2 | DIFFCODE::BINSIDE3;
+				else
+					code |= DIFFCODE::TEXT;
+				m_ndiffs = nCompMethod == CMP_QUICK_CONTENT ? CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE : 0;
+				m_ntrivialdiffs = nCompMethod == CMP_QUICK_CONTENT ? CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE : 0;
+				goto exitPrepAndCompare;
+			}
+		}
+
+		if (tFiles.GetSize() == 2 && !bReadOnce)
 		{
+			ioSlots.Acquire();
 			m_diffFileData.SetDisplayFilepaths(tFiles[0], tFiles[1]); // store true names for diff utils patch file
 			// This opens & fstats both files (if it succeeds)
 			if (!m_diffFileData.OpenFiles(filepathTransformed[0], filepathTransformed[1]))
 				goto exitPrepAndCompare;
+			if (bTriage && TriageByMetadata(di, nCompMethod, m_diffFileData.m_inf) == TRIAGE_SAME)
+				m_diffFileData.ShareFirstFile();
 		}
-		else
+		else if (tFiles.GetSize() == 3)
 		{
+			ioSlots.Acquire();
 			diffdata10.SetDisplayFilepaths(tFiles[1], tFiles[0]); // store true names for diff utils patch file
 			diffdata12.SetDisplayFilepaths(tFiles[1], tFiles[2]); // store true names for diff utils patch file
 			diffdata02.SetDisplayFilepaths(tFiles[0], tFiles[2]); // store true names for diff utils patch file
+			if (HasFileLargerThan(di, nDirs, m_pCtxt->m_nQuickCompareLimit))
+			{
+				diffdata10.SetSequentialScan(true);
+				diffdata12.SetSequentialScan(true);
+				diffdata02.SetSequentialScan(true);
+			}
 
-			if (!diffdata10.OpenFiles(filepathTransformed[1], filepathTransformed[0]))
+			if (!bSame10 && !diffdata10.OpenFiles(filepathTransformed[1], filepathTransformed[0]))
 				goto exitPrepAndCompare;
 
-			if (!diffdata12.OpenFiles(filepathTransformed[1], filepathTransformed[2]))
+			if (!bSame12 && !diffdata12.OpenFiles(filepathTransformed[1], filepathTransformed[2]))
 				goto exitPrepAndCompare;
 
-			if (!diffdata02.OpenFiles(filepathTransformed[0], filepathTransformed[2]))
+			// The first and third file are compared only if no pair is
+			// identical: if the first and second file are identical, the
+			// first and third file compare as the second and third file do
+			if (!bSame10 && !bSame12 && !bSame02 &&
+				!diffdata02.OpenFiles(filepathTransformed[0], filepathTransformed[2]))
 				goto exitPrepAndCompare;
-		}
 
-		// If either file is larger than limit compare files by quick contents
-		// This allows us to (faster) compare big binary files
-		if (nCompMethod == CMP_CONTENT && 
-			(di.diffFileInfo[0].size > m_pCtxt->m_nQuickCompareLimit ||
-			di.diffFileInfo[1].size > m_pCtxt->m_nQuickCompareLimit ||
-			(nDirs > 2 && di.diffFileInfo[2].size > m_pCtxt->m_nQuickCompareLimit)))
-		{
-			nCompMethod = CMP_QUICK_CONTENT;
+			// The opened pairs get copies of the data read once above,
+			// the compare engines may write into their buffers
+			if (bReadByNWay)
+			{
+				if (!SetPairData(diffdata10, *m_pNWayCompare, 1, 0) ||
+					!SetPairData(diffdata12, *m_pNWayCompare, 1, 2) ||
+					!SetPairData(diffdata02, *m_pNWayCompare, 0, 2))
+					goto exitPrepAndCompare;
+				m_pNWayCompare->ClearData();
+				ioSlots.Release();
+			}
 		}
 
 		if (nCompMethod == CMP_CONTENT)
@@ -213,6 +359,14 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 					m_pDiffUtilsEngine->ClearFilterList();
 				m_pDiffUtilsEngine->SetFilterCommentsManager(m_pCtxt->m_pFilterCommentsManager);
 			}
+			// Read the files to the buffers they are compared from up front,
+			// so that the diff runs without the read slots. The automatic
+			// choice of the algorithm samples the same buffers. Files are
+			// compared by full contents only up to the quick compare limit.
+			if (tFiles.GetSize() == 2 ? !m_diffFileData.ReadFiles() :
+				(!diffdata10.ReadFiles() || !diffdata12.ReadFiles() || !diffdata02.ReadFiles()))
+				goto exitPrepAndCompare;
+			ioSlots.Release();
 			if (tFiles.GetSize() == 2)
 			{
 				m_pDiffUtilsEngine->SetFileData(2, m_diffFileData.m_inf);
@@ -228,26 +382,37 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 					m_ndiffs = CDiffContext::DIFFS_UNKNOWN;
 					m_ntrivialdiffs = CDiffContext::DIFFS_UNKNOWN;
 				}
+				// Algorithm chosen for text files when the diff algorithm is auto
+				else if ((code & DIFFCODE::TEXTFLAGS) == DIFFCODE::TEXT)
+				{
+					di.diffAlgorithm = m_pDiffUtilsEngine->GetDiffAlgorithm();
+				}
 			}
 			else
 			{
 				bool bRet;
 				int bin_flag10 = 0, bin_flag12 = 0, bin_flag02 = 0;
 
-				m_pDiffUtilsEngine->SetFileData(2, diffdata10.m_inf);
-				bRet = m_pDiffUtilsEngine->Diff2Files(&script10, 0, &bin_flag10, false, nullptr);
-				m_pDiffUtilsEngine->GetTextStats(0, &m_diffFileData.m_textStats[1]);
-				m_pDiffUtilsEngine->GetTextStats(1, &m_diffFileData.m_textStats[0]);
-
-				m_pDiffUtilsEngine->SetFileData(2, diffdata12.m_inf);
-				bRet = m_pDiffUtilsEngine->Diff2Files(&script12, 0, &bin_flag12, false, nullptr);
-				m_pDiffUtilsEngine->GetTextStats(0, &m_diffFileData.m_textStats[1]);
-				m_pDiffUtilsEngine->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+				// Identical files have no diffs (script is nullptr)
+				if (!bSame10)
+				{
+					m_pDiffUtilsEngine->SetFileData(2, diffdata10.m_inf);
+					bRet = m_pDiffUtilsEngine->Diff2Files(&script10, 0, &bin_flag10, false, nullptr);
+					m_pDiffUtilsEngine->GetTextStats(0, &m_diffFileData.m_textStats[1]);
+					m_pDiffUtilsEngine->GetTextStats(1, &m_diffFileData.m_textStats[0]);
+				}
+				else if (m_diffFileData.m_textStats[1].nzeros > 0)
+					bin_flag10 = 1;
 
-				m_pDiffUtilsEngine->SetFileData(2, diffdata02.m_inf);
-				bRet = m_pDiffUtilsEngine->Diff2Files(&script02, 0, &bin_flag02, false, nullptr);
-				m_pDiffUtilsEngine->GetTextStats(0, &m_diffFileData.m_textStats[0]);
-				m_pDiffUtilsEngine->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+				if (!bSame12)
+				{
+					m_pDiffUtilsEngine->SetFileData(2, diffdata12.m_inf);
+					bRet = m_pDiffUtilsEngine->Diff2Files(&script12, 0, &bin_flag12, false, nullptr);
+					m_pDiffUtilsEngine->GetTextStats(0, &m_diffFileData.m_textStats[1]);
+					m_pDiffUtilsEngine->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+				}
+				else if (m_diffFileData.m_textStats[1].nzeros > 0)
+					bin_flag12 = 1;
 
 				code = DIFFCODE::FILE;
 
@@ -278,17 +443,35 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 
 				if ((code & DIFFCODE::COMPAREFLAGS) == DIFFCODE::DIFF)
 				{
+					// The first and third file are compared only when the
+					// second and third file differ and the result is not
+					// known from the pre-pass
+					const bool bCompare02 = !bSame10 && !bSame12 && !bSame02;
 					if ((code & DIFFCODE::TEXTFLAGS) == DIFFCODE::TEXT)
 					{
+						bool bSame02Text = bSame02;
+						if (script12 != nullptr && bCompare02)
+						{
+							m_pDiffUtilsEngine->SetFileData(2, diffdata02.m_inf);
+							bRet = m_pDiffUtilsEngine->Diff2Files(&script02, 0, &bin_flag02, false, nullptr);
+							bSame02Text = (script02 == nullptr);
+						}
 						if (script12 == nullptr)
 							code |= DIFFCODE::DIFF1STONLY;
-						else if (script02 == nullptr)
+						else if (bSame02Text)
 							code |= DIFFCODE::DIFF2NDONLY;
 						else if (script10 == nullptr)
 							code |= DIFFCODE::DIFF3RDONLY;
 					}
 					else
 					{
+						if (bSame02)
+							bin_flag02 = 1;
+						else if (bin_flag12 <= 0 && bCompare02)
+						{
+							m_pDiffUtilsEngine->SetFileData(2, diffdata02.m_inf);
+							bRet = m_pDiffUtilsEngine->Diff2Files(&script02, 0, &bin_flag02, false, nullptr);
+						}
 						if (bin_flag12 > 0)
 							code |= DIFFCODE::DIFF1STONLY;
 						else if (bin_flag02 > 0)
@@ -315,6 +498,9 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 		else if (nCompMethod == CMP_QUICK_CONTENT)
 		{
 			// use our own byte-by-byte compare
+			// It compares the files while reading them, the read slots
+			// taken when opening the files are held until it is done,
+			// unless the files were read to memory already
 			if (m_pByteCompare == nullptr)
 			{
 				m_pByteCompare.reset(new ByteCompare());
@@ -323,6 +509,7 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 				m_pByteCompare->SetAdditionalOptions(m_pCtxt->m_bStopAfterFirstDiff);
 				m_pByteCompare->SetAbortable(m_pCtxt->GetAbortable());
 			}
+			m_pByteCompare->SetComputeDigests(bUseHashCache && tFiles.GetSize() == 2);
 			if (tFiles.GetSize() == 2)
 			{
 				m_pByteCompare->SetFileData(2, m_diffFileData.m_inf);
@@ -333,6 +520,14 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 				m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[0]);
 				m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[1]);
 
+				std::vector<unsigned char> digest;
+				for (nIndex = 0; bUseHashCache && nIndex < nDirs; nIndex++)
+				{
+					bHashed[nIndex] = m_pByteCompare->GetDigest(nIndex, digest);
+					if (bHashed[nIndex])
+						std::copy(digest.begin(), digest.end(), hashEntries[nIndex].digest);
+				}
+
 				// Quick contents doesn't know about diff counts
 				// Set to special value to indicate invalid
 				m_ndiffs = CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE;
@@ -341,31 +536,50 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 			else
 			{
 				// 10
-				m_pByteCompare->SetFileData(2, diffdata10.m_inf);
+				int code10;
+				if (bSame10)
+					code10 = GetIdenticalFilesCode(m_diffFileData.m_textStats[1]);
+				else
+				{
+					m_pByteCompare->SetFileData(2, diffdata10.m_inf);
 
-				// use our own byte-by-byte compare
-				int code10 = m_pByteCompare->CompareFiles(diffdata10.m_FileLocation);
+					// use our own byte-by-byte compare
+					code10 = m_pByteCompare->CompareFiles(diffdata10.m_FileLocation);
 
-				m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[1]);
-				m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[0]);
+					m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[1]);
+					m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[0]);
+				}
 
 				// 12
-				m_pByteCompare->SetFileData(2, diffdata12.m_inf);
+				int code12;
+				if (bSame12)
+					code12 = GetIdenticalFilesCode(m_diffFileData.m_textStats[1]);
+				else
+				{
+					m_pByteCompare->SetFileData(2, diffdata12.m_inf);
 
-				// use our own byte-by-byte compare
-				int code12 = m_pByteCompare->CompareFiles(diffdata12.m_FileLocation);
+					// use our own byte-by-byte compare
+					code12 = m_pByteCompare->CompareFiles(diffdata12.m_FileLocation);
 
-				m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[1]);
-				m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+					m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[1]);
+					m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+				}
 
-				// 02
-				m_pByteCompare->SetFileData(2, diffdata02.m_inf);
+				// 02 is needed only if 12 differs and no pair is identical
+				int code02 = DIFFCODE::DIFF;
+				if (bSame02)
+					code02 = GetIdenticalFilesCode(m_diffFileData.m_textStats[0]);
+				else if (!bSame10 && !bSame12 &&
+					(code12 & DIFFCODE::COMPAREFLAGS) != DIFFCODE::SAME)
+				{
+					m_pByteCompare->SetFileData(2, diffdata02.m_inf);
 
-				// use our own byte-by-byte compare
-				int code02 = m_pByteCompare->CompareFiles(diffdata02.m_FileLocation);
+					// use our own byte-by-byte compare
+					code02 = m_pByteCompare->CompareFiles(diffdata02.m_FileLocation);
 
-				m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[0]);
-				m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+					m_pByteCompare->GetTextStats(0, &m_diffFileData.m_textStats[0]);
+					m_pByteCompare->GetTextStats(1, &m_diffFileData.m_textStats[2]);
+				}
 
 				code = DIFFCODE::FILE;
 				if (DIFFCODE::isResultError(code10) || DIFFCODE::isResultError(code12) || DIFFCODE::isResultError(code02))
@@ -401,11 +615,16 @@ int FolderCmp::prepAndCompareFiles(DIFFITEM &di)
 				m_ntrivialdiffs = CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE;
 			}
 		}
+		if (bUseHashCache && !DIFFCODE::isResultError(code) && !DIFFCODE::isResultAbort(code))
+			StoreContentHashes(di, tFiles, encoding, hashEntries, bHashed);
+
 exitPrepAndCompare:
 		m_diffFileData.Reset();
 		diffdata10.Reset();
 		diffdata12.Reset();
 		diffdata02.Reset();
+		if (m_pNWayCompare != nullptr)
+			m_pNWayCompare->ClearData();
 		
 		// delete the temp files after comparison
 		if (filepathTransformed[0] != filepathUnpacked[0])
@@ -433,7 +652,34 @@ exitPrepAndCompare:
 
 		PathContext tFiles;
 		GetComparePaths(m_pCtxt, di, tFiles);
-		code = m_pBinaryCompare->CompareFiles(tFiles, di);
+		switch (TriageByMetadata(di, nCompMethod))
+		{
+		case TRIAGE_SAME: code = DIFFCODE::SAME; ClearEngineResults(di, nDirs); break;
+		case TRIAGE_DIFF: code = DIFFCODE::DIFF; ClearEngineResults(di, nDirs); break;
+		default:
+			// The files are compared while they are read
+			ioSlots.Acquire();
+			code = m_pBinaryCompare->CompareFiles(tFiles, di);
+			break;
+		}
+	}
+	else if (nCompMethod == CMP_HASH)
+	{
+		if (m_pHashCompare == nullptr)
+			m_pHashCompare.reset(new HashCompare());
+
+		PathContext tFiles;
+		GetComparePaths(m_pCtxt, di, tFiles);
+		switch (TriageByMetadata(di, nCompMethod))
+		{
+		case TRIAGE_SAME: code = DIFFCODE::SAME; ClearEngineResults(di, nDirs); break;
+		case TRIAGE_DIFF: code = DIFFCODE::DIFF; ClearEngineResults(di, nDirs); break;
+		default:
+			// The files are hashed while they are read
+			ioSlots.Acquire();
+			code = m_pHashCompare->CompareFiles(tFiles, di);
+			break;
+		}
 	}
 	else if (nCompMethod == CMP_DATE || nCompMethod == CMP_DATE_SIZE || nCompMethod == CMP_SIZE)
 	{
@@ -453,6 +699,7 @@ exitPrepAndCompare:
 
 		PathContext tFiles;
 		GetComparePaths(m_pCtxt, di, tFiles);
+		ioSlots.Acquire();
 		code = DIFFCODE::IMAGE | m_pImageCompare->CompareFiles(tFiles, di);
 	}
 	else
@@ -464,6 +711,222 @@ exitPrepAndCompare:
 	return code;
 }
 
+/**
+ * @brief Decide the compare result from file metadata, before reading the files.
+ * Opened files that are the same file (hard links, bind mounts) or share
+ * all their data blocks (reflinks) are identical. In binary and hash
+ * compare, two files of different sizes are different. Files are not
+ * opened here: binary and hash compare recognize the same file from the
+ * handles they open themselves.
+ * @param [in] di Compared files.
+ * @param [in] nCompMethod Compare method.
+ * @param [in] inf Files of a 2-way compare opened already, nullptr if the
+ * files are not open. Identity is taken from their descriptors.
+ * @return TRIAGE_SAME or TRIAGE_DIFF if the result was decided.
+ */
+FolderCmp::TRIAGE FolderCmp::TriageByMetadata(const DIFFITEM &di, int nCompMethod, const file_data *inf)
+{
+	const int nDirs = m_pCtxt->GetCompareDirs();
+	if (!di.diffcode.existAll())
+		return TRIAGE_NONE;
+
+	CompareStats *pStats = m_pCtxt->m_pCompareStats;
+	if (di.diffFileInfo[0].size != di.diffFileInfo[1].size ||
+		(nDirs > 2 && di.diffFileInfo[1].size != di.diffFileInfo[2].size))
+	{
+		// In 3-way compare the engines tell which file differs
+		if (nDirs == 2 && (nCompMethod == CMP_BINARY_CONTENT || nCompMethod == CMP_HASH))
+		{
+			if (pStats != nullptr)
+				pStats->AddSizeDiffHit();
+			return TRIAGE_DIFF;
+		}
+		return TRIAGE_NONE;
+	}
+
+	if (inf == nullptr)
+		return TRIAGE_NONE;
+	const FileIdentity::Result result = FileIdentity::Compare(inf[0].desc, inf[1].desc);
+	if (result == FileIdentity::UNKNOWN)
+		return TRIAGE_NONE;
+	if (pStats != nullptr)
+	{
+		if (result == FileIdentity::SAME_FILE)
+			pStats->AddSameFileHit();
+		else
+			pStats->AddSharedExtentsHit();
+	}
+	return TRIAGE_SAME;
+}
+
+/**
+ * @brief Decide the compare result from content hashes.
+ * Hashes, text stats and encodings of files not modified since they were
+ * last stored are taken from the content hash cache. If any file is not
+ * found, the files must be compared by the compare engine. Files with
+ * identical contents are identical with any compare options. Different
+ * contents only mean different files with quick contents compare not
+ * ignoring any differences, otherwise the files must be compared by the
+ * compare engine too.
+ * @param [in] di Compared files.
+ * @param [in] tFiles Paths of the compared files.
+ * @param [in] nCompMethod CMP_CONTENT or CMP_QUICK_CONTENT.
+ * @param [out] encoding Encodings of the files.
+ * @param [out] code Compare result code.
+ * @return true if the result was decided.
+ */
+bool FolderCmp::CompareByContentHash(const DIFFITEM &di, const PathContext &tFiles, int nCompMethod,
+	FileTextEncoding encoding[], unsigned &code)
+{
+	ContentHashCache *pCache = m_pCtxt->m_pContentHashCache;
+	const int nDirs = m_pCtxt->GetCompareDirs();
+	// Guessed encodings depend on the detection options
+	const uint64_t optionsHash = static_cast<unsigned>(m_pCtxt->m_iGuessEncodingType);
+	ContentHashEntry entries[3];
+	int nIndex;
+	for (nIndex = 0; nIndex < nDirs; nIndex++)
+	{
+		const DiffFileInfo &dfi = di.diffFileInfo[nIndex];
+		const int64_t mtime = dfi.mtime.epochMicroseconds();
+		if (!pCache->Lookup(tFiles[nIndex], dfi.size, mtime, optionsHash, entries[nIndex]))
+			return false;
+	}
+
+	auto equalDigests = [&entries](int i, int j) {
+		return memcmp(entries[i].digest, entries[j].digest, ContentHashEntry::DIGEST_SIZE) == 0;
+	};
+	const bool bSame = equalDigests(0, 1) && (nDirs < 3 || equalDigests(1, 2));
+	if (!bSame)
+	{
+		if (nCompMethod != CMP_QUICK_CONTENT)
+			return false;
+		const CompareOptions *pOptions = m_pCtxt->GetCompareOptions(CMP_QUICK_CONTENT);
+		if (pOptions->m_ignoreWhitespace != WHITESPACE_COMPARE_ALL || pOptions->m_bIgnoreBlankLines ||
+			pOptions->m_bIgnoreCase || pOptions->m_bIgnoreEOLDifference)
+			return false;
+	}
+
+	code = DIFFCODE::FILE | (bSame ? DIFFCODE::SAME : DIFFCODE::DIFF);
+	static const unsigned binSides[3] = { DIFFCODE::BINSIDE1, DIFFCODE::BINSIDE2, DIFFCODE::BINSIDE3 };
+	unsigned bin = 0;
+	for (nIndex = 0; nIndex < nDirs; nIndex++)
+	{
+		if (entries[nIndex].textStats.nzeros > 0)
+			bin |= binSides[nIndex];
+		encoding[nIndex] = entries[nIndex].encoding;
+		m_diffFileData.m_FileLocation[nIndex].encoding = encoding[nIndex];
+		m_diffFileData.m_textStats[nIndex] = entries[nIndex].textStats;
+	}
+	code |= bin != 0 ? (DIFFCODE::BIN | bin) : DIFFCODE::TEXT;
+	if (!bSame && nDirs > 2)
+	{
+		if (equalDigests(1, 2))
+			code |= DIFFCODE::DIFF1STONLY;
+		else if (equalDigests(0, 2))
+			code |= DIFFCODE::DIFF2NDONLY;
+		else if (equalDigests(0, 1))
+			code |= DIFFCODE::DIFF3RDONLY;
+	}
+
+	// Quick contents doesn't know about diff counts
+	m_ndiffs = nCompMethod == CMP_QUICK_CONTENT ? CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE : 0;
+	m_ntrivialdiffs = nCompMethod == CMP_QUICK_CONTENT ? CDiffContext::DIFFS_UNKNOWN_QUICKCOMPARE : 0;
+	return true;
+}
+
+/**
+ * @brief Store content hashes computed by the compare to the content hash cache.
+ * @param [in] di Compared files.
+ * @param [in] tFiles Paths of the compared files.
+ * @param [in] encoding Encodings of the files.
+ * @param [in,out] entries Digests of the files, text stats and encodings are set here.
+ * @param [in] bHashed Which files have a digest of the whole file.
+ */
+void FolderCmp::StoreContentHashes(const DIFFITEM &di, const PathContext &tFiles, const FileTextEncoding encoding[],
+	ContentHashEntry entries[], const bool bHashed[])
+{
+	ContentHashCache *pCache = m_pCtxt->m_pContentHashCache;
+	const int nDirs = m_pCtxt->GetCompareDirs();
+	const uint64_t optionsHash = static_cast<unsigned>(m_pCtxt->m_iGuessEncodingType);
+	const Poco::Timestamp now;
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
+	{
+		const DiffFileInfo &dfi = di.diffFileInfo[nIndex];
+		// A file modified just now may still be being written and could
+		// change again within the resolution of its timestamp
+		if (!bHashed[nIndex] || now - dfi.mtime <= 2 * Poco::Timestamp::resolution())
+			continue;
+		entries[nIndex].textStats = m_diffFileData.m_textStats[nIndex];
+		entries[nIndex].encoding = encoding[nIndex];
+		pCache->Store(tFiles[nIndex], dfi.size, dfi.mtime.epochMicroseconds(), optionsHash, entries[nIndex]);
+	}
+}
+
+/**
+ * @brief Check if unpacker or prediffer plugins are applied to the files.
+ */
+static bool IsPluginUsed(const PackingInfo * infoUnpacker, const PrediffingInfo * infoPrediffer)
+{
+	if (infoUnpacker != nullptr && (infoUnpacker->m_PluginOrPredifferMode != PLUGIN_MANUAL || !infoUnpacker->m_PluginName.empty()))
+		return true;
+	if (infoPrediffer != nullptr && (infoPrediffer->m_PluginOrPredifferMode != PLUGIN_MANUAL || !infoPrediffer->m_PluginName.empty()))
+		return true;
+	return false;
+}
+
+/**
+ * @brief Check if any compared file is larger than the given size.
+ * @param [in] di Item to check.
+ * @param [in] nDirs Number of compared folders.
+ * @param [in] size Size to compare to.
+ */
+static bool HasFileLargerThan(const DIFFITEM &di, int nDirs, int size)
+{
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
+	{
+		if (di.diffcode.exists(nIndex) && di.diffFileInfo[nIndex].size > size)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * @brief Get the result of ByteCompare for two identical files.
+ * @param [in] stats Text stats of the files.
+ */
+static int GetIdenticalFilesCode(const FileTextStats &stats)
+{
+	if (stats.nzeros > 0)
+		return DIFFCODE::SAME | DIFFCODE::BIN | DIFFCODE::BINSIDE1 | DIFFCODE::BINSIDE2;
+	return DIFFCODE::SAME | DIFFCODE::TEXT;
+}
+
+/**
+ * @brief Clear the results a compare engine stored to an item in an earlier compare.
+ * @param [in,out] di Item whose result was decided without the engine.
+ * @param [in] nDirs Number of compared folders.
+ */
+static void ClearEngineResults(DIFFITEM &di, int nDirs)
+{
+	di.firstDiffOffset = -1;
+	for (int nIndex = 0; nIndex < nDirs; nIndex++)
+		di.diffFileInfo[nIndex].ClearContentHash();
+}
+
+/**
+ * @brief Give an opened pair of a 3-way compare the data read by NWayCompare.
+ * @param [in,out] diffdata Pair of files, not opened if the pair is not compared.
+ * @param [in] nway Engine which read the files.
+ * @param [in] nFirst Index of the first file of the pair in the 3-way compare.
+ * @param [in] nSecond Index of the second file of the pair in the 3-way compare.
+ * @return false if out of memory.
+ */
+static bool SetPairData(DiffFileData &diffdata, const NWayCompare &nway, int nFirst, int nSecond)
+{
+	return diffdata.SetFileData(0, nway.GetData(nFirst), nway.GetDataSize(nFirst)) &&
+		diffdata.SetFileData(1, nway.GetData(nSecond), nway.GetDataSize(nSecond));
+}
+
 /**
  * @brief Get actual compared paths from DIFFITEM.
  * @param [in] pCtx Pointer to compare context.
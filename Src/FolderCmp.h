@@ -10,13 +10,17 @@
 #include "Wrap_DiffUtils.h"
 #include "ByteCompare.h"
 #include "BinaryCompare.h"
+#include "HashCompare.h"
+#include "NWayCompare.h"
 #include "TimeSizeCompare.h"
 #include "ImageCompare.h"
 #include "PathContext.h"
 
 class CDiffContext;
+class DeviceIoLimiter;
 class PackingInfo;
 class PrediffingInfo;
+struct ContentHashEntry;
 
 /**
  * @brief Holds plugin-related paths and information.
@@ -39,7 +43,7 @@ struct PluginsContext
 class FolderCmp
 {
 public:
-	explicit FolderCmp(CDiffContext *pCtxt);
+	explicit FolderCmp(CDiffContext *pCtxt, DeviceIoLimiter *pIoLimiter = nullptr);
 	~FolderCmp();
 	bool RunPlugins(PluginsContext * plugCtxt, String &errStr);
 	void CleanupAfterPlugins(PluginsContext *plugCtxt);
@@ -52,9 +56,26 @@ public:
 	CDiffContext *const m_pCtxt;
 
 private:
+	/** @brief Result of TriageByMetadata() */
+	enum TRIAGE
+	{
+		TRIAGE_NONE, /**< Files must be compared */
+		TRIAGE_SAME, /**< Files are identical */
+		TRIAGE_DIFF, /**< Files are different */
+	};
+
+	TRIAGE TriageByMetadata(const DIFFITEM &di, int nCompMethod, const file_data *inf = nullptr);
+	bool CompareByContentHash(const DIFFITEM &di, const PathContext &tFiles, int nCompMethod,
+		FileTextEncoding encoding[], unsigned &code);
+	void StoreContentHashes(const DIFFITEM &di, const PathContext &tFiles, const FileTextEncoding encoding[],
+		ContentHashEntry entries[], const bool bHashed[]);
+
+	DeviceIoLimiter *const m_pIoLimiter; /**< Limits readers per disk, nullptr if not limited */
 	std::unique_ptr<CompareEngines::DiffUtils> m_pDiffUtilsEngine;
 	std::unique_ptr<CompareEngines::ByteCompare> m_pByteCompare;
 	std::unique_ptr<CompareEngines::BinaryCompare> m_pBinaryCompare;
+	std::unique_ptr<CompareEngines::HashCompare> m_pHashCompare;
+	std::unique_ptr<CompareEngines::NWayCompare> m_pNWayCompare;
 	std::unique_ptr<CompareEngines::TimeSizeCompare> m_pTimeSizeCompare;
 	std::unique_ptr<CompareEngines::ImageCompare> m_pImageCompare;
 };
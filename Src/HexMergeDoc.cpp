@@ -42,6 +42,7 @@
 int CHexMergeDoc::m_nBuffersTemp = 2;
 
 static void UpdateDiffItem(int nBuffers, DIFFITEM &di, CDiffContext *pCtxt);
+static int64_t GetFirstDiffOffset(CDirDoc *pDirDoc, const PathContext &paths);
 static int Try(HRESULT hr, UINT type = MB_OKCANCEL|MB_ICONSTOP);
 
 /**
@@ -63,6 +64,21 @@ static void UpdateDiffItem(int nBuffers, DIFFITEM &di, CDiffContext *pCtxt)
 	di.diffcode.diffcode |= folderCmp.prepAndCompareFiles(di);
 }
 
+/**
+ * @brief Get the offset of the first difference found by folder compare
+ * @return Offset of the first differing byte, -1 if unknown
+ */
+static int64_t GetFirstDiffOffset(CDirDoc *pDirDoc, const PathContext &paths)
+{
+	if (pDirDoc == nullptr || !pDirDoc->HasDiffs())
+		return -1;
+	const CDiffContext &ctxt = pDirDoc->GetDiffContext();
+	DIFFITEM *pos = FindItemFromPaths(ctxt, paths);
+	if (pos == nullptr)
+		return -1;
+	return ctxt.GetDiffAt(pos).firstDiffOffset;
+}
+
 /**
  * @brief Issue an error popup if passed in HRESULT is nonzero
  */
@@ -529,7 +545,15 @@ void CHexMergeDoc::MoveOnLoad(int nPane, int)
 	GetParentFrame()->SetActivePane(nPane);
 
 	if (GetOptionsMgr()->GetBool(OPT_SCROLL_TO_FIRST))
-		m_pView[0]->SendMessage(WM_COMMAND, ID_FIRSTDIFF);
+	{
+		// Binary compare of the folder compare already found the first
+		// difference, so the hex view needn't search big files again
+		int64_t offset = GetFirstDiffOffset(m_pDirDoc, m_filePaths);
+		if (offset > 0)
+			m_pView[0]->SelectDiffAt(offset);
+		else
+			m_pView[0]->SendMessage(WM_COMMAND, ID_FIRSTDIFF);
+	}
 }
 
 void CHexMergeDoc::CheckFileChanged(void)
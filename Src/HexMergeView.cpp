@@ -515,6 +515,22 @@ void CHexMergeView::OnFirstdiff()
 	m_pif->select_next_diff(TRUE);
 }
 
+/**
+ * @brief Select the difference starting at given offset
+ * The search for the next difference starts from the identical byte
+ * before the offset instead of the beginning of the file.
+ */
+void CHexMergeView::SelectDiffAt(int64_t offset)
+{
+	if (offset <= 0 || offset >= GetLength())
+	{
+		m_pif->select_next_diff(TRUE);
+		return;
+	}
+	m_pif->get_status()->iCurByte = static_cast<int>(offset - 1);
+	m_pif->select_next_diff(FALSE);
+}
+
 /**
  * @brief Go to last diff
  */
@@ -44,6 +44,7 @@ public:
 	void ResizeWindow();
 	IMergeDoc::FileChange IsFileChangedOnDisk(LPCTSTR);
 	void ZoomText(int amount);
+	void SelectDiffAt(int64_t offset);
 	static void CopySel(const CHexMergeView *src, CHexMergeView *dst);
 	static void CopyAll(const CHexMergeView *src, CHexMergeView *dst);
 	static bool IsLoadable();
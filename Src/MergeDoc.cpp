@@ -52,6 +52,7 @@
 #include "charsets.h"
 #include "markdown.h"
 #include "stringdiffs.h"
+#include "DiffAlgorithmSelector.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -124,6 +125,7 @@ CMergeDoc::CMergeDoc()
 , m_CurWordDiff{ -1, static_cast<size_t>(-1), -1 }
 , m_pDirDoc(nullptr)
 , m_bMixedEol(false)
+, m_diffAlgorithm(-1)
 , m_pInfoUnpacker(new PackingInfo)
 , m_pEncodingErrorBar(nullptr)
 , m_bHasSyncPoints(false)
@@ -467,6 +469,10 @@ int CMergeDoc::Rescan(bool &bBinary, IDENTLEVEL &identical,
 	// set identical/diff result as recorded by diffutils
 	identical = status.Identical;
 
+	// remember the algorithm chosen for the files to show it in the status bar
+	m_diffAlgorithm = (diffOptions.nDiffAlgorithm == DIFF_ALGORITHM_AUTO) ?
+		static_cast<int>(status.algorithm) : -1;
+
 	// Determine errors and binary file compares
 	if (!diffSuccess)
 		nResult = RESCAN_FILE_ERR;
@@ -1581,7 +1587,6 @@ bool CMergeDoc::DoSave(LPCTSTR szPath, bool &bSaveSuccess, int nBuffer)
 		// Preserve file times if user wants to
 		if (GetOptionsMgr()->GetBool(OPT_PRESERVE_FILETIMES))
 		{
-			fileInfo.SetFile(strSavePath);
 			try
 			{
 				TFile file(strSavePath);
@@ -1975,6 +1980,10 @@ void CMergeDoc::OnUpdateStatusNum(CCmdUI* pCmdUI)
 		_itot_s(nDiffs, sCnt, 10);
 		strutils::replace(s, _T("%2"), sCnt);
 	}
+
+	// Algorithm chosen for the files when the diff algorithm is auto
+	if (m_diffAlgorithm >= 0)
+		s += _T(" (") + tr(DiffAlgorithmSelector::GetName(static_cast<DiffAlgorithm>(m_diffAlgorithm))) + _T(")");
 	pCmdUI->SetText(s.c_str());
 }
 
@@ -335,6 +335,7 @@ protected:
 	TempFile m_tempFiles[3]; /**< Temp files for compared files */
 	int m_nDiffContext;
 	bool m_bMixedEol; /**< Does this document have mixed EOL style? */
+	int m_diffAlgorithm; /**< DiffAlgorithm chosen by the last rescan, -1 if not chosen automatically */
 	std::unique_ptr<CEncodingErrorBar> m_pEncodingErrorBar;
 	bool m_bHasSyncPoints;
 	bool m_bAutoMerged;
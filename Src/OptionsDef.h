@@ -207,6 +207,9 @@ extern const String OPT_CMP_STOP_AFTER_FIRST OP("Settings/StopAfterFirst");
 extern const String OPT_CMP_QUICK_LIMIT OP("Settings/QuickMethodLimit");
 extern const String OPT_CMP_BINARY_LIMIT OP("Settings/BinaryMethodLimit");
 extern const String OPT_CMP_COMPARE_THREADS OP("Settings/CompareThreads");
+extern const String OPT_CMP_COMPARE_LARGEST_FIRST OP("Settings/CompareLargestFirst");
+extern const String OPT_CMP_COMPARE_READERS_PER_DEVICE OP("Settings/CompareReadersPerDevice");
+extern const String OPT_CMP_CONTENT_HASH_CACHE OP("Settings/ContentHashCache");
 extern const String OPT_CMP_WALK_UNIQUE_DIRS OP("Settings/ScanUnpairedDir");
 extern const String OPT_CMP_IGNORE_REPARSE_POINTS OP("Settings/IgnoreReparsePoints");
 extern const String OPT_CMP_INCLUDE_SUBDIRS OP("Settings/Recurse");
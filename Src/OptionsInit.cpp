@@ -131,6 +131,9 @@ void Init(COptionsMgr *pOptions)
 	pOptions->InitOption(OPT_CMP_QUICK_LIMIT, 4 * 1024 * 1024); // 4 Megs
 	pOptions->InitOption(OPT_CMP_BINARY_LIMIT, 64 * 1024 * 1024); // 64 Megs
 	pOptions->InitOption(OPT_CMP_COMPARE_THREADS, -1);
+	pOptions->InitOption(OPT_CMP_COMPARE_LARGEST_FIRST, false);
+	pOptions->InitOption(OPT_CMP_COMPARE_READERS_PER_DEVICE, 0); // 0 = one reader on rotational disks
+	pOptions->InitOption(OPT_CMP_CONTENT_HASH_CACHE, false);
 	pOptions->InitOption(OPT_CMP_WALK_UNIQUE_DIRS, true);
 	pOptions->InitOption(OPT_CMP_IGNORE_REPARSE_POINTS, false);
 	pOptions->InitOption(OPT_CMP_IGNORE_CODEPAGE, false);
@@ -25,7 +25,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 static struct change *find_hunk(struct change *);
 static void mark_ignorable(struct change *);
 static void pr_unidiff_hunk(struct change *);
-static void print_1_escapedhtml(const char **line);
+static void print_1_escapedhtml(const file_data *file, int line);
 static void output_1_escapedhtml(const char *text, const char *limit);
 
 /* Print a header for a context diff, with the file names and dates.  */
@@ -249,10 +249,10 @@ pr_unidiff_hunk (struct change *hunk)
 	{
 	  fprintf (out, "  <tr>\n");
 	  fprintf (out, "    <td class=\"vc_diff_nochange\">&nbsp;");
-	  print_1_escapedhtml(&files[0].linbuf[i++]);
+	  print_1_escapedhtml(&files[0], i++);
 	  fprintf (out, "</td>\n");
 	  fprintf (out, "    <td class=\"vc_diff_nochange\">&nbsp;");
-	  print_1_escapedhtml(&files[1].linbuf[j++]);
+	  print_1_escapedhtml(&files[1], j++);
 	  fprintf (out, "</td>\n");
 	  fprintf (out, "  </tr>\n");
 	}
@@ -268,7 +268,7 @@ pr_unidiff_hunk (struct change *hunk)
 	          if (k0 > 0)
 	            {
 	              fprintf (out, "    <td class=\"vc_diff_change\">&nbsp;");
-	               print_1_escapedhtml(&files[0].linbuf[i++]);
+	               print_1_escapedhtml(&files[0], i++);
 	              fprintf (out, "</td>\n");
 	            }
 		  else
@@ -278,7 +278,7 @@ pr_unidiff_hunk (struct change *hunk)
 	          if (k1 > 0)
 	            {
 	              fprintf (out, "    <td class=\"vc_diff_change\">&nbsp;");
-	              print_1_escapedhtml(&files[1].linbuf[j++]);
+	              print_1_escapedhtml(&files[1], j++);
 	              fprintf (out, "</td>\n");
 	            }
 		  else
@@ -296,7 +296,7 @@ pr_unidiff_hunk (struct change *hunk)
 	        {
 	          fprintf (out, "  <tr>\n");
 	          fprintf (out, "    <td class=\"vc_diff_remove\">&nbsp;");
-	          print_1_escapedhtml(&files[0].linbuf[i++]);
+	          print_1_escapedhtml(&files[0], i++);
 	          fprintf (out, "</td>\n");
 	          fprintf (out, "    <td class=\"vc_diff_empty\">&nbsp;</td>");
 	          fprintf (out, "  </tr>\n");
@@ -309,7 +309,7 @@ pr_unidiff_hunk (struct change *hunk)
 	          fprintf (out, "  <tr>\n");
 	          fprintf (out, "    <td class=\"vc_diff_empty\">&nbsp;</td>");
 	          fprintf (out, "    <td class=\"vc_diff_add\">&nbsp;");
-	          print_1_escapedhtml(&files[1].linbuf[j++]);
+	          print_1_escapedhtml(&files[1], j++);
 	          fprintf (out, "</td>\n");
 	          fprintf (out, "  </tr>\n");
 	        }
@@ -385,9 +385,9 @@ mark_ignorable (struct change *script)
 }
 
 static void
-print_1_escapedhtml(const char **line)
+print_1_escapedhtml(const file_data *file, int line)
 {
-  output_1_escapedhtml(line[0], line[1]);
+  output_1_escapedhtml(LINE_START(file, line), LINE_START(file, line + 1));
 }
 
 static void
@@ -108,6 +108,7 @@ BOOL PropCompare::OnInitDialog()
 	combo->AddString(_("minimal").c_str());
 	combo->AddString(_("patience").c_str());
 	combo->AddString(_("histogram").c_str());
+	combo->AddString(_("auto").c_str());
 	combo->SetCurSel(m_nDiffAlgorithm);
 
 	OptionsPanel::OnInitDialog();
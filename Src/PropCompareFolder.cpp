@@ -32,6 +32,7 @@ PropCompareFolder::PropCompareFolder(COptionsMgr *optionsMgr)
  , m_nQuickCompareLimit(4 * Mega)
  , m_nBinaryCompareLimit(64 * Mega)
  , m_nCompareThreads(-1)
+ , m_bCompareLargestFirst(false)
 {
 }
 
@@ -49,6 +50,7 @@ void PropCompareFolder::DoDataExchange(CDataExchange* pDX)
 	DDX_Text(pDX, IDC_COMPARE_QUICKC_LIMIT, m_nQuickCompareLimit);
 	DDX_Text(pDX, IDC_COMPARE_BINARYC_LIMIT, m_nBinaryCompareLimit);
 	DDX_Text(pDX, IDC_COMPARE_THREAD_COUNT, m_nCompareThreads);
+	DDX_Check(pDX, IDC_COMPARE_LARGEST_FIRST, m_bCompareLargestFirst);
 	//}}AFX_DATA_MAP
 	UpdateControls();
 }
@@ -79,6 +81,7 @@ void PropCompareFolder::ReadOptions()
 	m_nQuickCompareLimit = GetOptionsMgr()->GetInt(OPT_CMP_QUICK_LIMIT) / Mega ;
 	m_nBinaryCompareLimit = GetOptionsMgr()->GetInt(OPT_CMP_BINARY_LIMIT) / Mega ;
 	m_nCompareThreads = GetOptionsMgr()->GetInt(OPT_CMP_COMPARE_THREADS);
+	m_bCompareLargestFirst = GetOptionsMgr()->GetBool(OPT_CMP_COMPARE_LARGEST_FIRST);
 }
 
 /** 
@@ -103,6 +106,7 @@ void PropCompareFolder::WriteOptions()
 		m_nBinaryCompareLimit = 2000;
 	GetOptionsMgr()->SaveOption(OPT_CMP_BINARY_LIMIT, m_nBinaryCompareLimit * Mega);
 	GetOptionsMgr()->SaveOption(OPT_CMP_COMPARE_THREADS, m_nCompareThreads);
+	GetOptionsMgr()->SaveOption(OPT_CMP_COMPARE_LARGEST_FIRST, m_bCompareLargestFirst);
 }
 
 /** 
@@ -125,6 +129,8 @@ BOOL PropCompareFolder::OnInitDialog()
 	combo->AddString(item.c_str());
 	item = _("Size");
 	combo->AddString(item.c_str());
+	item = _("Contents Hash");
+	combo->AddString(item.c_str());
 	combo->SetCurSel(m_compareMethod);
 
 	return TRUE;  // return TRUE unless you set the focus to a control
@@ -145,6 +151,7 @@ void PropCompareFolder::OnDefaults()
 	m_nQuickCompareLimit = GetOptionsMgr()->GetDefault<unsigned>(OPT_CMP_QUICK_LIMIT) / Mega;
 	m_nBinaryCompareLimit = GetOptionsMgr()->GetDefault<unsigned>(OPT_CMP_BINARY_LIMIT) / Mega;
 	m_nCompareThreads = GetOptionsMgr()->GetDefault<unsigned>(OPT_CMP_COMPARE_THREADS);
+	m_bCompareLargestFirst = GetOptionsMgr()->GetDefault<bool>(OPT_CMP_COMPARE_LARGEST_FIRST);
 	UpdateData(FALSE);
 }
 
@@ -168,5 +175,8 @@ void PropCompareFolder::UpdateControls()
 	CComboBox * pCombo = (CComboBox*)GetDlgItem(IDC_COMPAREMETHODCOMBO);
 	EnableDlgItem(IDC_COMPARE_STOPFIRST, pCombo->GetCurSel() == 1);
 	EnableDlgItem(IDC_EXPAND_SUBDIRS, IsDlgButtonChecked(IDC_RECURS_CHECK) == 1);
-	EnableDlgItem(IDC_COMPARE_THREAD_COUNT, pCombo->GetCurSel() <= 1 ? true : false); // true: fullcontent, quickcontent
+	// true: fullcontent, quickcontent, contents hash
+	const bool bComparedByWorkers = pCombo->GetCurSel() <= 1 || pCombo->GetCurSel() == 6;
+	EnableDlgItem(IDC_COMPARE_THREAD_COUNT, bComparedByWorkers);
+	EnableDlgItem(IDC_COMPARE_LARGEST_FIRST, bComparedByWorkers);
 }
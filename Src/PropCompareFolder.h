@@ -45,6 +45,7 @@ public:
 	unsigned m_nQuickCompareLimit;
 	unsigned m_nBinaryCompareLimit;
 	int     m_nCompareThreads;
+	bool    m_bCompareLargestFirst;
 	//}}AFX_DATA
 
 
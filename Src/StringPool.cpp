@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  StringPool.cpp
+ *
+ * @brief Implementation of StringPool class.
+ */
+
+#include "pch.h"
+#include "StringPool.h"
+#include "DebugNew.h"
+
+using Poco::FastMutex;
+
+const String PooledString::emptyString;
+
+StringPool::StringPool()
+{
+}
+
+StringPool::~StringPool()
+{
+}
+
+/**
+ * @brief Return the pool used for strings interned without a pool.
+ */
+StringPool& StringPool::Default()
+{
+	static StringPool pool;
+	return pool;
+}
+
+/**
+ * @brief Add string to pool if it is not there yet.
+ * @param [in] str String to add.
+ * @return Handle of the pooled copy of @p str.
+ */
+PooledString StringPool::Intern(const String& str)
+{
+	if (str.empty())
+		return PooledString();
+
+	Shard &shard = m_shards[std::hash<String>()(str) % SHARD_COUNT];
+	FastMutex::ScopedLock lock(shard.mutex);
+	auto it = shard.strings.find(&str);
+	if (it != shard.strings.end())
+		return PooledString(*it);
+
+	if (shard.nChunkUsed == CHUNK_SIZE)
+	{
+		shard.chunks.emplace_back(new String[CHUNK_SIZE]);
+		shard.nChunkUsed = 0;
+	}
+	String *pooled = &shard.chunks.back()[shard.nChunkUsed++];
+	*pooled = str;
+	shard.strings.insert(pooled);
+	return PooledString(pooled);
+}
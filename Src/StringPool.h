@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  StringPool.h
+ *
+ * @brief Declaration of StringPool and PooledString classes.
+ */
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_set>
+#include <Poco/Mutex.h>
+#include "UnicodeString.h"
+
+class PooledString;
+
+/**
+ * @brief Pool of interned strings.
+ *
+ * Every distinct string is stored once, and the same string always gets the
+ * same PooledString. The String objects are kept in chunks, which keeps them
+ * at fixed addresses for the handles, and live until the pool is destroyed.
+ * The characters of a string longer than the small string buffer are still
+ * allocated by the String itself and freed one by one. The pool is split
+ * into shards by the hash of the string, each with its own lock, so threads
+ * interning different strings rarely wait for each other.
+ *
+ * Each CDiffContext owns a pool for the names and paths of its items, and
+ * code setting them interns the strings there. Only PooledStrings
+ * constructed explicitly from a string use the pool returned by Default(),
+ * which is never freed.
+ */
+class StringPool
+{
+public:
+	StringPool();
+	~StringPool();
+	StringPool(const StringPool&) = delete;
+	StringPool& operator=(const StringPool&) = delete;
+	PooledString Intern(const String& str);
+	static StringPool& Default();
+
+private:
+	enum { SHARD_COUNT = 16, CHUNK_SIZE = 1024 };
+
+	struct Hash
+	{
+		size_t operator()(const String *str) const { return std::hash<String>()(*str); }
+	};
+	struct Equal
+	{
+		bool operator()(const String *str1, const String *str2) const { return *str1 == *str2; }
+	};
+
+	struct Shard
+	{
+		Poco::FastMutex mutex;
+		std::unordered_set<const String *, Hash, Equal> strings; /**< Index of the interned strings */
+		std::vector<std::unique_ptr<String[]>> chunks; /**< String objects, all chunks but the last are full */
+		size_t nChunkUsed; /**< Number of strings in the last chunk */
+		Shard() : nChunkUsed(CHUNK_SIZE) {}
+	};
+
+	Shard m_shards[SHARD_COUNT];
+};
+
+/**
+ * @brief Handle of a string interned in a StringPool.
+ * Used like a const String. Copying a handle copies only a pointer and
+ * equal strings of the same pool compare by pointer. A handle must not
+ * be used after its pool is destroyed.
+ */
+class PooledString
+{
+public:
+	PooledString() : m_p(&emptyString) {}
+	explicit PooledString(const String& str) : PooledString(StringPool::Default().Intern(str)) {}
+	explicit PooledString(const TCHAR *str) : PooledString(StringPool::Default().Intern(str)) {}
+	PooledString(const PooledString&) = default;
+	PooledString& operator=(const PooledString&) = default;
+
+	const String& get() const { return *m_p; }
+	operator const String&() const { return *m_p; }
+
+	bool operator==(const PooledString& other) const { return m_p == other.m_p || *m_p == *other.m_p; }
+	bool operator!=(const PooledString& other) const { return !(*this == other); }
+	bool operator==(const String& other) const { return *m_p == other; }
+	bool operator!=(const String& other) const { return *m_p != other; }
+	bool operator==(const TCHAR *other) const { return *m_p == other; }
+	bool operator!=(const TCHAR *other) const { return *m_p != other; }
+	bool operator<(const PooledString& other) const { return *m_p < *other.m_p; }
+
+private:
+	friend class StringPool;
+	explicit PooledString(const String *p) : m_p(p) {}
+
+	const String *m_p; /**< String in the pool */
+	static const String emptyString; /**< Empty string, not in any pool */
+};
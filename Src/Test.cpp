@@ -333,21 +333,21 @@ TEST(FolderCompare, IgnoreEOL)
 			{
 				if (dirs[i].find(L"/w/") != String::npos)
 				{
-					EXPECT_LT(0, di.diffFileInfo[i].m_textStats.ncrlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.nlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrs);
+					EXPECT_LT(0, di.diffFileInfo[i].GetDetails().m_textStats.ncrlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetDetails().m_textStats.nlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetDetails().m_textStats.ncrs);
 				}
 				else if (dirs[i].find(L"/u/") != String::npos)
 				{
-					EXPECT_LT(0, di.diffFileInfo[i].m_textStats.nlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrs);
+					EXPECT_LT(0, di.diffFileInfo[i].GetDetails().m_textStats.nlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetDetails().m_textStats.ncrlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetDetails().m_textStats.ncrs);
 				}
 				else if (dirs[i].find(L"/m/") != String::npos)
 				{
-					EXPECT_LT(0, di.diffFileInfo[i].m_textStats.ncrs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.nlfs);
-					EXPECT_EQ(0, di.diffFileInfo[i].m_textStats.ncrlfs);
+					EXPECT_LT(0, di.diffFileInfo[i].GetDetails().m_textStats.ncrs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetDetails().m_textStats.nlfs);
+					EXPECT_EQ(0, di.diffFileInfo[i].GetDetails().m_textStats.ncrlfs);
 				}
 			}
 		}
@@ -233,11 +233,28 @@ static unsigned GuessEncoding_from_bytes(const String& ext, const char *src, siz
  */
 FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncodingType, ptrdiff_t mapmaxlen)
 {
-	FileTextEncoding encoding;
 	CMarkdown::FileImage fi(filepath != _T("NUL") ? filepath.c_str() : nullptr, mapmaxlen);
+	return GuessCodepageEncoding(filepath, fi.pImage, fi.cbImage, guessEncodingType, mapmaxlen);
+}
+
+/**
+ * @brief Try to deduce encoding for a file already read to memory.
+ * @param [in] filepath Full path to the file, used for its extension.
+ * @param [in] data Contents of the file.
+ * @param [in] size Size of the contents.
+ * @param [in] bGuessEncoding Try to guess codepage (not just unicode encoding).
+ * @return Structure getting the encoding info.
+ */
+FileTextEncoding GuessCodepageEncoding(const String& filepath, const void *data, size_t size, int guessEncodingType, ptrdiff_t mapmaxlen)
+{
+	FileTextEncoding encoding;
+	unsigned bom = 0;
+	if (data != nullptr && size >= 4)
+		memcpy(&bom, data, sizeof(bom));
+	const int nByteOrder = CMarkdown::FileImage::GuessByteOrder(bom);
 	encoding.SetCodepage(ucr::getDefaultCodepage());
 	encoding.m_bom = false;
-	switch (fi.nByteOrder)
+	switch (nByteOrder)
 	{
 	case 8 + 2 + 0:
 		encoding.SetUnicoding(ucr::UCS2LE);
@@ -258,11 +275,11 @@ FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncoding
 		encoding.m_bom = false;
 		break;
 	}
-	if (fi.nByteOrder < 4 && guessEncodingType != 0)
+	if (nByteOrder < 4 && guessEncodingType != 0)
 	{
 		String ext = paths::FindExtension(filepath);
-		const char *src = (char *)fi.pImage;
-		size_t len = fi.cbImage;
+		const char *src = static_cast<const char *>(data);
+		size_t len = data != nullptr ? size : 0;
 		if (len == static_cast<size_t>(mapmaxlen))
 		{
 			for (size_t i = len; i--; )
@@ -12,3 +12,4 @@
 static const int BufSize = 65536;
 
 FileTextEncoding GuessCodepageEncoding(const String& filepath, int guessEncodingType, ptrdiff_t mapmaxlen = BufSize);
+FileTextEncoding GuessCodepageEncoding(const String& filepath, const void *data, size_t size, int guessEncodingType, ptrdiff_t mapmaxlen = BufSize);
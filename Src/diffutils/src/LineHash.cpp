@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  LineHash.cpp
+ *
+ * @brief Line splitting and hashing kernels used by find_and_hash_each_line().
+ *
+ * A line ends at LF or at a CR not followed by LF, so CR+LF ends a line at
+ * the LF. The line end is located first, 16 bytes at a time with SSE2, and
+ * the line is then hashed without checking for the end on every byte.
+ *
+ * Lines compared exactly are hashed 8 bytes at a time. With case or white
+ * space ignored the lines are hashed a byte at a time, giving the same hash
+ * values as the byte loops diffutils used before. The equivalence classes
+ * are found by walking hash bucket chains, and when white space is ignored
+ * lines_differ() is not transitive, so the chains must stay the same.
+ */
+
+#include "pch.h"
+#include "LineHash.h"
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define LINEHASH_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+/** @brief Add a character to a hash, HASH() of diffutils. */
+inline unsigned HashChar(unsigned h, unsigned char c)
+{
+	return c + (h << 7 | h >> (sizeof(unsigned) * 8 - 7));
+}
+
+inline bool IsWhitespace(unsigned char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+/** @brief Characters compared as they are. */
+struct NoFold
+{
+	explicit NoFold(const unsigned char *) {}
+	unsigned char operator()(unsigned char c) const { return c; }
+};
+
+/** @brief Characters compared ignoring case. */
+struct TableFold
+{
+	explicit TableFold(const unsigned char *table) : m_table(table) {}
+	unsigned char operator()(unsigned char c) const { return m_table[c]; }
+	const unsigned char *m_table;
+};
+
+#ifdef LINEHASH_SSE2
+/** @brief Index of the lowest set bit, @p mask must not be zero. */
+inline unsigned LowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+/** @brief Number of set bits in a 16-bit @p mask. */
+inline unsigned PopCount(unsigned mask)
+{
+	mask = mask - ((mask >> 1) & 0x5555);
+	mask = (mask & 0x3333) + ((mask >> 2) & 0x3333);
+	mask = (mask + (mask >> 4)) & 0x0F0F;
+	return (mask + (mask >> 8)) & 0x1F;
+}
+#endif
+
+/**
+ * @brief Hash a line compared exactly, 8 bytes at a time.
+ * The length is mixed into the last word, which always has a free byte.
+ */
+unsigned HashBytes(const unsigned char *p, const unsigned char *eol, const unsigned char *)
+{
+	const uint64_t Multiplier = 0x9E3779B97F4A7C15ULL;
+	size_t n = eol - p;
+	uint64_t h = 0;
+	uint64_t w;
+	for (; n >= sizeof(w); n -= sizeof(w), p += sizeof(w))
+	{
+		memcpy(&w, p, sizeof(w));
+		h = ((h << 23 | h >> 41) ^ w) * Multiplier;
+	}
+	w = 0;
+	memcpy(&w, p, n);
+	h = ((h << 23 | h >> 41) ^ w ^ (static_cast<uint64_t>(n) << 56)) * Multiplier;
+	return static_cast<unsigned>(h ^ (h >> 32));
+}
+
+/** @brief Hash a line ignoring case only. */
+unsigned HashFolded(const unsigned char *p, const unsigned char *eol, const unsigned char *fold)
+{
+	unsigned h = 0;
+	for (; p < eol; ++p)
+		h = HashChar(h, fold[*p]);
+	return h;
+}
+
+/** @brief Hash a line ignoring all white space. */
+template <typename Fold>
+unsigned HashIgnoreAllSpace(const unsigned char *p, const unsigned char *eol, const unsigned char *table)
+{
+	const Fold fold(table);
+	unsigned h = 0;
+	for (; p < eol; ++p)
+	{
+		if (!IsWhitespace(*p))
+			h = HashChar(h, fold(*p));
+	}
+	return h;
+}
+
+/**
+ * @brief Hash a line ignoring changes in the amount of white space.
+ * A run of white space is hashed as one space, except before the line end
+ * or a CR. A CR ending the line is hashed only after white space.
+ */
+template <typename Fold>
+unsigned HashIgnoreSpaceChange(const unsigned char *p, const unsigned char *eol, const unsigned char *table)
+{
+	const Fold fold(table);
+	unsigned h = 0;
+	while (p < eol)
+	{
+		unsigned char c = *p++;
+		if (IsWhitespace(c))
+		{
+			while (p < eol && IsWhitespace(*p))
+				++p;
+			c = *p++;
+			if (c == '\n')
+				break;
+			if (c != '\r')
+				h = HashChar(h, ' ');
+		}
+		h = HashChar(h, fold(c));
+	}
+	return h;
+}
+
+}
+
+/**
+ * @brief Find the end of the line starting at @p p.
+ * @param [in] p Start of the line.
+ * @param [in] end End of the buffer, the last line ends before it.
+ * @return Position of the LF or CR ending the line.
+ */
+extern "C" const unsigned char *FindLineEnd(const unsigned char *p, const unsigned char *end)
+{
+#ifdef LINEHASH_SSE2
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	for (; end - p >= 16; p += 16)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		const unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+		if (mask != 0)
+		{
+			p += LowestBit(mask);
+			break;
+		}
+	}
+#endif
+	for (; p < end; ++p)
+	{
+		if (*p == '\n')
+			return p;
+		if (*p == '\r')
+			return (p + 1 < end && p[1] == '\n') ? p + 1 : p;
+	}
+	return end;
+}
+
+/**
+ * @brief Count the lines in [p, end), ending the same as in FindLineEnd().
+ * @param [in] p Start of a line.
+ * @param [in] end Start of a line or end of the text, a CR before it
+ * ends a line.
+ * @return Number of LF and CR bytes, less the CR+LF pairs.
+ */
+extern "C" size_t CountLines(const unsigned char *p, const unsigned char *end)
+{
+	size_t count = 0;
+#ifdef LINEHASH_SSE2
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i lf = _mm_set1_epi8('\n');
+	unsigned crBefore = 0; // CR in the last byte of the previous block
+	for (; end - p >= 16; p += 16)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+		const unsigned crMask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, cr));
+		const unsigned lfMask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, lf));
+		// A LF after a CR ends the same line
+		const unsigned crlfMask = lfMask & (crMask << 1 | crBefore);
+		count += PopCount(crMask) + PopCount(lfMask) - PopCount(crlfMask);
+		crBefore = crMask >> 15;
+	}
+	// The CR in the last block already counted this LF
+	if (crBefore && p < end && *p == '\n')
+		++p;
+#endif
+	for (; p < end; ++p)
+	{
+		if (*p == '\n')
+			++count;
+		else if (*p == '\r')
+		{
+			++count;
+			if (p + 1 < end && p[1] == '\n')
+				++p;
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Choose the hash kernel for the compare options.
+ * @param [in] flags LINEHASH_* flags.
+ */
+extern "C" LineHashFunc GetLineHashFunc(int flags)
+{
+	const bool bIgnoreCase = (flags & LINEHASH_IGNORE_CASE) != 0;
+	if (flags & LINEHASH_IGNORE_ALL_SPACE)
+		return bIgnoreCase ? HashIgnoreAllSpace<TableFold> : HashIgnoreAllSpace<NoFold>;
+	if (flags & LINEHASH_IGNORE_SPACE_CHANGE)
+		return bIgnoreCase ? HashIgnoreSpaceChange<TableFold> : HashIgnoreSpaceChange<NoFold>;
+	return bIgnoreCase ? HashFolded : HashBytes;
+}
+
+/**
+ * @brief Make the table mapping upper case characters to lower case.
+ * The table is made with the current locale, like diffutils folded case
+ * before.
+ */
+extern "C" void MakeCaseFoldTable(unsigned char fold[256])
+{
+	for (int c = 0; c < 256; ++c)
+		fold[c] = static_cast<unsigned char>(isupper(c) ? tolower(c) : c);
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  LineHash.h
+ *
+ * @brief Declaration of the line splitting and hashing kernels of diffutils.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Options changing how lines are hashed, see GetLineHashFunc(). */
+enum
+{
+	LINEHASH_IGNORE_CASE = 1,         /**< ignore_case_flag */
+	LINEHASH_IGNORE_ALL_SPACE = 2,    /**< ignore_all_space_flag */
+	LINEHASH_IGNORE_SPACE_CHANGE = 4, /**< ignore_space_change_flag */
+};
+
+/**
+ * @brief Hash the line [p, eol), eol being the line end found by FindLineEnd().
+ * @p fold is the table made by MakeCaseFoldTable() when case is ignored.
+ */
+typedef unsigned (*LineHashFunc)(const unsigned char *p, const unsigned char *eol, const unsigned char *fold);
+
+const unsigned char *FindLineEnd(const unsigned char *p, const unsigned char *end);
+size_t CountLines(const unsigned char *p, const unsigned char *end);
+LineHashFunc GetLineHashFunc(int flags);
+void MakeCaseFoldTable(unsigned char fold[256]);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  LineOffsets.cpp
+ *
+ * @brief Line index used by find_identical_ends() and find_and_hash_each_line().
+ *
+ * Lines are indexed by their offsets in the buffer of their file instead of
+ * by pointers. The low 32 bits of an offset take half the memory of a
+ * pointer in 64-bit builds. Text over 4 GB keeps bits 32-39 of the offsets
+ * in a second array, a byte per line, so files up to 1 TB can be indexed.
+ */
+
+#include "pch.h"
+#include "LineOffsets.h"
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * @brief Check if the lines of a text can be indexed.
+ * @param [in] textsize Size of the text.
+ * @return Nonzero if the offsets of the text fit.
+ */
+int LineOffsetsFit(size_t textsize)
+{
+	return (textsize >> 16 >> 16) <= UCHAR_MAX;
+}
+
+/**
+ * @brief Allocate or resize the line index of a file.
+ * The offsets stored already are kept. The high bits of the offsets are
+ * allocated if the text is over 4 GB, or were allocated already. Offsets
+ * stored before the high bits are allocated are taken to be under 4 GB.
+ * @param [in,out] offsets Line index, both arrays NULL for a new index.
+ * @param [in] base Index of the first line, zero or negative.
+ * @param [in] count Number of lines from @p base to make room for.
+ * @param [in] textsize Size of the text the lines are in.
+ * @return Zero if out of memory.
+ */
+int ReallocLineOffsets(struct line_offsets *offsets, int base, size_t count, size_t textsize)
+{
+	if (count == 0)
+		count = 1;
+	line_offset *lo = static_cast<line_offset *>(
+		realloc(offsets->lo != nullptr ? offsets->lo + base : nullptr, count * sizeof(*lo)));
+	if (lo == nullptr)
+		return 0;
+	offsets->lo = lo - base;
+	if (offsets->hi != nullptr || textsize > UINT_MAX)
+	{
+		unsigned char *hi = static_cast<unsigned char *>(
+			realloc(offsets->hi != nullptr ? offsets->hi + base : nullptr, count));
+		if (hi == nullptr)
+			return 0;
+		if (offsets->hi == nullptr)
+			memset(hi, 0, count);
+		offsets->hi = hi - base;
+	}
+	return 1;
+}
+
+/**
+ * @brief Free the line index of a file.
+ * @param [in,out] offsets Line index, set to NULL.
+ * @param [in] base Index of the first line, as given to ReallocLineOffsets().
+ */
+void FreeLineOffsets(struct line_offsets *offsets, int base)
+{
+	if (offsets->lo != nullptr)
+		free(offsets->lo + base);
+	if (offsets->hi != nullptr)
+		free(offsets->hi + base);
+	offsets->lo = nullptr;
+	offsets->hi = nullptr;
+}
+
+/**
+ * @brief Store the offset of a line.
+ * @param [in,out] offsets Line index, with room for line @p i.
+ * @param [in] i Line number.
+ * @param [in] offset Offset of the line from the start of the buffer.
+ */
+void SetLineOffset(struct line_offsets *offsets, int i, size_t offset)
+{
+	offsets->lo[i] = static_cast<line_offset>(offset);
+	if (offsets->hi != nullptr)
+		offsets->hi[i] = static_cast<unsigned char>(offset >> 16 >> 16);
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  LineOffsets.h
+ *
+ * @brief Declaration of the line index of diffutils.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Low 32 bits of the offset of a line from the start of the buffer of its file. */
+typedef unsigned int line_offset;
+
+/**
+ * @brief Offsets of the lines of a file from the start of its buffer.
+ * The arrays may be indexed from a negative base, like the line buffers
+ * of diffutils. Bits 32-39 of the offsets are only kept for text over 4 GB.
+ */
+struct line_offsets
+{
+	line_offset *lo;   /**< Low 32 bits of the offsets */
+	unsigned char *hi; /**< Bits 32-39 of the offsets, NULL for text up to 4 GB */
+};
+
+/** @brief Offset of line @p i in struct line_offsets @p o. */
+#define LINE_OFFSET(o, i) \
+	((o).hi ? ((size_t) (o).hi[i] << 16 << 16) + (o).lo[i] : (size_t) (o).lo[i])
+
+int LineOffsetsFit(size_t textsize);
+int ReallocLineOffsets(struct line_offsets *offsets, int base, size_t count, size_t textsize);
+void FreeLineOffsets(struct line_offsets *offsets, int base);
+void SetLineOffset(struct line_offsets *offsets, int i, size_t offset);
+
+#ifdef __cplusplus
+}
+#endif
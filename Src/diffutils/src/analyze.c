@@ -43,7 +43,6 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #  include <io.h>
 #endif
 
-DECL_TLS int no_discards;
 DECL_TLS int need_free_buffers=0;
 
 static DECL_TLS int *xvec, *yvec;	/* Vectors being compared. */
@@ -1092,7 +1091,7 @@ struct change * diff_2_files (struct file_data filevec[], int depth, int * bin_s
 		//	free (filevec[i].equivs);
 		
 		//for (i = 0; i < 2; ++i)
-		//	free (filevec[i].linbuf + filevec[i].linbuf_base);
+		//	FreeLineOffsets (&filevec[i].linofs, filevec[i].linbuf_base);
 		
 		
 		/*cleanup the script
@@ -1130,9 +1129,9 @@ void cleanup_file_buffers(struct file_data fd[])
 		free (fd[i].equivs);
 	
 	for (i = 0; i < 2; ++i)
-		free ((void *)(fd[i].linbuf + fd[i].linbuf_base));
+		FreeLineOffsets (&fd[i].linofs, fd[i].linbuf_base);
 
 	if (fd[0].buffer != fd[1].buffer)
-		free (fd[0].buffer);
-	free (fd[1].buffer);
+		release_file_buffer (&fd[0]);
+	release_file_buffer (&fd[1]);
 }
@@ -184,7 +184,7 @@ pr_context_hunk (struct change *hunk)
 	       Otherwise it is "deleted".  */
 	    prefix = (next->inserted > 0 ? "!" : "-");
 
-	  print_1_line (prefix, &files[0].linbuf[i]);
+	  print_1_line (prefix, &files[0], i);
 	}
     }
 
@@ -213,7 +213,7 @@ pr_context_hunk (struct change *hunk)
 	       Otherwise it is "inserted".  */
 	    prefix = (next->deleted > 0 ? "!" : "+");
 
-	  print_1_line (prefix, &files[1].linbuf[i]);
+	  print_1_line (prefix, &files[1], i);
 	}
     }
 }
@@ -305,7 +305,7 @@ pr_unidiff_hunk (struct change *hunk)
       if (!next || i < next->line0)
 	{
 	  putc (tab_align_flag ? '\t' : ' ', out);
-	  print_1_line (0, &files[0].linbuf[i++]);
+	  print_1_line (0, &files[0], i++);
 	  j++;
 	}
       else
@@ -318,7 +318,7 @@ pr_unidiff_hunk (struct change *hunk)
 	      putc ('-', out);
 	      if (tab_align_flag)
 		putc ('\t', out);
-	      print_1_line (0, &files[0].linbuf[i++]);
+	      print_1_line (0, &files[0], i++);
 	    }
 
 	  /* Then output the inserted part. */
@@ -329,7 +329,7 @@ pr_unidiff_hunk (struct change *hunk)
 	      putc ('+', out);
 	      if (tab_align_flag)
 		putc ('\t', out);
-	      print_1_line (0, &files[1].linbuf[j++]);
+	      print_1_line (0, &files[1], j++);
 	    }
 
 	  /* We're done with this hunk, so on to the next! */
@@ -22,6 +22,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #include "system.h"
 #include <ctype.h>
 #include <stdio.h>
+#include "LineOffsets.h"
 
 #ifdef NOMINMAX
 #undef min
@@ -200,6 +201,10 @@ EXTERN char *	switch_string;
 /* Nonzero means use heuristics for better speed.  */
 EXTERN int	heuristic;
 
+/* Nonzero means don't discard lines with no match in the other file,
+   and find a minimal edit script.  */
+EXTERN int	no_discards;
+
 /* Name of program the user invoked (for error messages).  */
 EXTERN char *	program;
 
@@ -248,20 +253,21 @@ struct file_data {
     /* Number of valid characters now in the buffer. */
     FSIZE	    buffered_chars;
 
-    /* Array of pointers to lines in the file.  */
-    char const HUGE **linbuf;
+    /* WinMerge: Offsets of lines in the file from the start of buffer,
+       see LineOffsets.h.  */
+    struct line_offsets linofs;
 
     /* linbuf_base <= buffered_lines <= valid_lines <= alloc_lines.
-       linebuf[linbuf_base ... buffered_lines - 1] are possibly differing.
-       linebuf[linbuf_base ... valid_lines - 1] contain valid data.
-       linebuf[linbuf_base ... alloc_lines - 1] are allocated.  */
+       linofs[linbuf_base ... buffered_lines - 1] are possibly differing.
+       linofs[linbuf_base ... valid_lines - 1] contain valid data.
+       linofs[linbuf_base ... alloc_lines - 1] are allocated.  */
     int linbuf_base, buffered_lines, valid_lines, alloc_lines;
 
     /* Pointer to end of prefix of this file to ignore when hashing. */
     char const HUGE *prefix_end;
 
     /* Count of lines in the prefix.
-       There are this many lines in the file before linbuf[0].  */
+       There are this many lines in the file before linofs[0].  */
     int prefix_lines;
 
     /* Pointer to start of suffix of this file to ignore when hashing. */
@@ -297,8 +303,18 @@ struct file_data {
 
     /* text stats for WinMerge */
     int count_crlfs, count_crs, count_lfs, count_zeros;
+
+    /* WinMerge: 1 if the caller already read the whole file into buffer. */
+    int preloaded;
+
+    /* WinMerge: 1 if buffer is a read-only mapping of the whole file.
+       Nothing may be written into the buffer, not even sentinels. */
+    int mapped;
 };
 
+/* Start of line I of file F, a pointer to struct file_data.  */
+#define LINE_START(f, i) ((char const *) (f)->buffer + LINE_OFFSET ((f)->linofs, i))
+
 /* Describe the two files currently being compared.  */
 
 EXTERN struct file_data files[2];
@@ -336,6 +352,8 @@ void print_ifdef_script (struct change *);
 int read_files (struct file_data[], int, int *);
 int sip (struct file_data *, int);
 void slurp (struct file_data *);
+void release_file_buffer (struct file_data *);
+int unicode_signature_p (struct file_data *);
 
 /* normal.c */
 void print_normal_script (struct change *);
@@ -367,7 +385,7 @@ void message5 (char const *, char const *, char const *, char const *, char cons
 void output_1_line (char const HUGE *, char const HUGE *, char const *, char const *);
 void perror_with_name (char const *);
 void pfatal_with_name (char const *);
-void print_1_line (char const *, char const HUGE * const *);
+void print_1_line (char const *, struct file_data const *, int);
 void print_message_queue (void);
 void print_number_range (int, struct file_data *, int, int);
 void print_script (struct change *, struct change * (*) (struct change *), void (*) (struct change *));
@@ -375,6 +393,19 @@ void setup_output (char const *, char const *, int);
 void translate_range (struct file_data const *, int, int, int *, int *);
 void cleanup_file_buffers(struct file_data fd[]);
 
+/* mapfile.cpp */
+/* WinMerge: Smallest file mapped instead of read, smaller files are read
+   about as fast as they are mapped.  Only files diffutils and xdiff read
+   themselves are mapped.  Files the caller preloaded with
+   DiffFileData::ReadFiles() are never mapped, whatever their size: folder
+   compare preloads all files it compares by full contents, which are at
+   most the quick compare limit, so that they are read while the disk read
+   slot is held; file compare preloads them when the diff algorithm is
+   chosen automatically, to sample them.  */
+#define MAP_MIN_SIZE (1024 * 1024)
+char *map_file (int fd, size_t size);
+void unmap_file (char *p, size_t size);
+
 /* version.c */
 extern char const version_string[];
 
@@ -254,7 +254,6 @@ static void
 print_ifdef_lines (register FILE *out, char *format, struct group const *group)
 {
   struct file_data const *file = group->file;
-  char const HUGE * const *linbuf = file->linbuf;
   int from = group->from, upto = group->upto;
 
   if (!out)
@@ -265,15 +264,15 @@ print_ifdef_lines (register FILE *out, char *format, struct group const *group)
     {
       if (format[1] == 'l' && format[2] == '\n' && !format[3])
 	{
-	  fwrite (linbuf[from], sizeof (char),
-		  linbuf[upto] + (linbuf[upto][-1] != '\n') -  linbuf[from],
+	  fwrite (LINE_START (file, from), sizeof (char),
+		  LINE_START (file, upto) + (LINE_START (file, upto)[-1] != '\n') -  LINE_START (file, from),
 		  out);
 	  return;
 	}
       if (format[1] == 'L' && !format[2])
 	{
-	  fwrite (linbuf[from], sizeof (char),
-		  linbuf[upto] -  linbuf[from], out);
+	  fwrite (LINE_START (file, from), sizeof (char),
+		  LINE_START (file, upto) -  LINE_START (file, from), out);
 	  return;
 	}
     }
@@ -294,13 +293,13 @@ print_ifdef_lines (register FILE *out, char *format, struct group const *group)
 		  break;
 
 		case 'l':
-		  output_1_line (linbuf[from],
-				 linbuf[from + 1]
-				   - (linbuf[from + 1][-1] == '\n'), 0, 0);
+		  output_1_line (LINE_START (file, from),
+				 LINE_START (file, from + 1)
+				   - (LINE_START (file, from + 1)[-1] == '\n'), 0, 0);
 		  continue;
 
 		case 'L':
-		  output_1_line (linbuf[from], linbuf[from + 1], 0, 0);
+		  output_1_line (LINE_START (file, from), LINE_START (file, from + 1), 0, 0);
 		  continue;
 
 		default:
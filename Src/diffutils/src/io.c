@@ -18,23 +18,18 @@ along with GNU DIFF; see the file COPYING.  If not, write to
 the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 
 #include "diff.h"
+#include "FileTextStats.h"
+#include "LineHash.h"
 #include <io.h>
 #include <assert.h>
 
-/* Rotate a value n bits to the left. */
-#define UINT_BIT (sizeof (unsigned) * CHAR_BIT)
-#define ROL(v, n) ((v) << (n) | (v) >> (UINT_BIT - (n)))
-
-/* Given a hash value and a new character, return a new hash value. */
-#define HASH(h, c) ((c) + ROL (h, 7))
-
-/* Guess remaining number of lines from number N of lines so far,
-   size S so far, and total size T.  */
-#define GUESS_LINES(n,s,t) (((t) - (s)) / ((n) < 10 ? 32 : (s) / ((n)-1)) + 5)
-
 /* Type used for fast prefix comparison in find_identical_ends.  */
 typedef unsigned word;
 
+/* Character at P, or 0 at END.  Mapped buffers have no sentinel after
+   the text, and 0 doesn't end a line like the sentinels.  */
+#define CHAR_AT(p, end) ((p) != (end) ? *(p) : 0)
+
 /** @brief Known Unicode encodings. */
 enum UNICODESET
 {
@@ -76,6 +71,7 @@ static DECL_TLS int equivs_index;
 static DECL_TLS int equivs_alloc;
 
 static void find_and_hash_each_line (struct file_data *);
+static void alloc_line_offsets (struct line_offsets *, int, FSIZE, FSIZE);
 static void find_identical_ends (struct file_data[]);
 static char *prepare_text_end (struct file_data *, short);
 static enum UNICODESET get_unicode_signature(struct file_data *, int *pBomsize);
@@ -132,6 +128,60 @@ static enum UNICODESET get_unicode_signature(struct file_data *current, int *pBo
   return NONE;
 }
 
+/* WinMerge: Nonzero if the buffer of CURRENT starts with a Unicode
+   signature.  Such text is not binary even if it has zero bytes.  */
+int
+unicode_signature_p (struct file_data *current)
+{
+  return get_unicode_signature (current, NULL) != NONE;
+}
+
+/* WinMerge: Map a large text file instead of reading it, if the text can
+   be compared without changing it: not transcoded to UTF-8, no line endings
+   mapped for ignore_eol_diff, and a newline at the end.  Binary files are
+   read as before, the binary comparison reads them again into the buffer.
+   Return nonzero if the file was mapped.  */
+static int
+map_text_file (struct file_data *current)
+{
+  size_t size;
+  char *p;
+  enum UNICODESET sig;
+
+  if (ignore_eol_diff || current->stat.st_size < MAP_MIN_SIZE
+      || (unsigned __int64) current->stat.st_size > (size_t) -1)
+    return 0;
+  size = (size_t) current->stat.st_size;
+  if ((p = map_file (current->desc, size)) == NULL)
+    return 0;
+  current->buffer = p;
+  current->bufsize = current->buffered_chars = size;
+  current->mapped = 1;
+
+  sig = get_unicode_signature (current, NULL);
+  if ((sig != NONE && sig != UTF8)
+      || (p[size - 1] != '\n' && p[size - 1] != '\r')
+      || (sig == NONE && binary_file_p (p, min (size, (size_t) STAT_BLOCKSIZE (current->stat)))))
+    {
+      release_file_buffer (current);
+      current->bufsize = current->buffered_chars = 0;
+      return 0;
+    }
+  return 1;
+}
+
+/* WinMerge: Free or unmap the buffer of the current file.  */
+void
+release_file_buffer (struct file_data *current)
+{
+  if (current->mapped)
+    unmap_file (current->buffer, current->bufsize);
+  else
+    free (current->buffer);
+  current->buffer = NULL;
+  current->mapped = 0;
+}
+
 /* Get ready to read the current file.
    Return nonzero if SKIP_TEST is zero,
    and if it appears to be a binary file.  */
@@ -148,6 +198,17 @@ sip (struct file_data *current, int skip_test)
       current->bufsize = sizeof (word);
       current->buffered_chars = 0;
     }
+  else if (current->preloaded)
+    {
+      /* WinMerge: the whole file is already in the buffer,
+         check the first block of it like below.  */
+      if (!skip_test && !get_unicode_signature(current, NULL))
+        isbinary = binary_file_p(current->buffer,
+          min(current->buffered_chars, (FSIZE) STAT_BLOCKSIZE (current->stat)));
+    }
+  else if (!skip_test && map_text_file (current))
+    /* WinMerge: the whole text is in the mapped buffer.  */
+    ;
   else
     {
       current->bufsize = current->buffered_chars
@@ -196,7 +257,8 @@ slurp (struct file_data *current)
           ? ~0U	// yes, allocate extra room for transcoding
           : 0U;	// no, allocate no extra room for transcoding
 
-      for (;;)
+      /* WinMerge: nothing more to read if the caller read or mapped the whole file */
+      while (!current->preloaded && !current->mapped)
         {
           if (current->buffered_chars == current->bufsize)
             {
@@ -241,7 +303,7 @@ slurp (struct file_data *current)
          Allocate enough room for appended newline and sentinel. 
 		 But don't reallocate if the buffer is already big enough */
 	  FSIZE tmp_bufsize = current->buffered_chars + (alloc_extra & current->buffered_chars / 2) + sizeof (word) + 1;
-	  if (tmp_bufsize > current->bufsize) 
+	  if (tmp_bufsize > current->bufsize && !current->mapped)
 	    { 
 		  current->buffer = xrealloc (current->buffer, tmp_bufsize);
 		  current->bufsize = tmp_bufsize;
@@ -250,10 +312,13 @@ slurp (struct file_data *current)
     }
 }
 
-static int
-ISWSPACE (char ch)
+/* WinMerge: Make room for COUNT line offsets from index BASE in OFFSETS,
+   for a text of TEXTSIZE bytes.  */
+static void
+alloc_line_offsets (struct line_offsets *offsets, int base, FSIZE count, FSIZE textsize)
 {
-  return ch==' ' || ch=='\t';
+  if (! ReallocLineOffsets (offsets, base, count, textsize))
+    fatal ("virtual memory exhausted");
 }
 
 /* Split the file into lines, simultaneously computing the equivalence class for
@@ -263,12 +328,13 @@ find_and_hash_each_line (struct file_data *current)
 {
   unsigned h;
   unsigned char const HUGE *p = (unsigned char const HUGE *) current->prefix_end;
-  unsigned char c;
   int i, *bucket;
   size_t length;
+  FSIZE ofs;
 
   /* Cache often-used quantities in local variables to help the compiler.  */
-  char const HUGE **linbuf = current->linbuf;
+  struct line_offsets linofs = current->linofs;
+  char const HUGE *buffer = current->buffer;
   int alloc_lines = current->alloc_lines;
   int line = 0;
   int linbuf_base = current->linbuf_base;
@@ -282,102 +348,29 @@ find_and_hash_each_line (struct file_data *current)
     = current->missing_newline && ROBUST_OUTPUT_STYLE (output_style)
       ? bufend : (char const HUGE *) NULL;
   int varies = length_varies;
+  LineHashFunc hash_line
+    = GetLineHashFunc ((ignore_case_flag ? LINEHASH_IGNORE_CASE : 0)
+                       | (ignore_all_space_flag ? LINEHASH_IGNORE_ALL_SPACE : 0)
+                       | (ignore_space_change_flag ? LINEHASH_IGNORE_SPACE_CHANGE : 0));
+  unsigned char fold[256];
+
+  if (ignore_case_flag)
+    MakeCaseFoldTable (fold);
 
-  /* prepare_text_end put a zero word at the end of the buffer, 
-  so we're not in danger of overrunning the end of the file */
+  /* prepare_text_end made the text end with a newline,
+  so every line has an end before bufend */
 
   while ((char const HUGE *) p < suffix_begin)
     {
       char const HUGE *ip = (char const HUGE *) p;
 
-      /* Compute the equivalence class (hash) for this line.  */
-
-      h = 0;
-
-
-      /* loops advance pointer to eol (end of line)
-         respecting UNIX (\r), MS-DOS/Windows (\r\n), and MAC (\r) eols */
+      /* Compute the equivalence class (hash) for this line.
+         Lines end at UNIX (\n), MS-DOS/Windows (\r\n), and MAC (\r) eols */
 
-      /* Hash this line until we find a newline. */
-      if (ignore_case_flag)
-        {
-          if (ignore_all_space_flag)
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (! ISWSPACE (c))
-                  h = HASH (h, isupper (c) ? tolower (c) : c);
-              }
-          else if (ignore_space_change_flag)
-            /* Note that \r must be hashed (if !ignore_eol_diff) */
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ISWSPACE (c))
-                  {
-                    /* skip whitespace after whitespace */
-                    while (ISWSPACE (c = *p++))
-                      ;
-                    if (c == '\n')
-                      {
-                        goto hashing_done; /* never hash trailing \n */
-                      }
-                    else if (c != '\r')
-                      {
-                  /* runs of whitespace not ending line hashed as one space */
-                        h = HASH (h, ' ');
-                      }
-                  }
-                /* c is now the first non-space.  */
-                /* c can be a \r (CR) if !ignore_eol_diff */
-                h = HASH (h, isupper (c) ? tolower (c) : c);
-                if (c == '\r' && *p != '\n')
-                  goto hashing_done;
-              }
-          else
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                h = HASH (h, isupper (c) ? tolower (c) : c);
-              }
-        }
-      else
-        {
-          if (ignore_all_space_flag)
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (! ISWSPACE (c))
-                  h = HASH (h, c);
-              }
-          else if (ignore_space_change_flag)
-            /* Note that \r must be hashed (if !ignore_eol_diff) */
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                if (ISWSPACE (c))
-                  {
-                    /* skip whitespace after whitespace */
-                    while (ISWSPACE (c = *p++))
-                      ;
-                    if (c == '\n')
-                      {
-                        goto hashing_done; /* never hash trailing \n */
-                      }
-                    else if (c != '\r')
-                      {
-                  /* runs of whitespace not ending line hashed as one space */
-                        h = HASH (h, ' ');
-                      }
-                  }
-                /* c is now the first non-space.  */
-                /* c can be a \r (CR) if !ignore_eol_diff */
-                h = HASH (h, c);
-                if (c == '\r' && *p != '\n')
-                  goto hashing_done;
-              }
-          else
-            while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
-              {
-                h = HASH (h, c);
-              }
-        }
-hashing_done:;
+      unsigned char const HUGE *eol
+        = FindLineEnd (p, (unsigned char const HUGE *) bufend);
+      h = hash_line (p, eol, fold);
+      p = eol + 1;
 
       bucket = &buckets[h % nbuckets];
       length = (char const HUGE *) p - ip - ((char const HUGE *) p == incomplete_tail);
@@ -408,18 +401,17 @@ hashing_done:;
           /* Reuse existing equivalence class.  */
             break;
 
-      /* Maybe increase the size of the line table. */
+      /* Maybe increase the size of the line table.
+         WinMerge: find_identical_ends counted the lines, this is a safety net.  */
       if (line == alloc_lines)
         {
           /* Double (alloc_lines - linbuf_base) by adding to alloc_lines.  */
           alloc_lines = 2 * alloc_lines - linbuf_base;
           cureqs = (int *) xrealloc (cureqs, alloc_lines * sizeof (*cureqs));
-          linbuf = (char const HUGE **) xrealloc ((void *)(linbuf + linbuf_base),
-                     (alloc_lines - linbuf_base)
-                     * sizeof (*linbuf))
-             - linbuf_base;
+          alloc_line_offsets (&linofs, linbuf_base, alloc_lines - linbuf_base,
+                              current->buffered_chars);
         }
-      linbuf[line] = ip;
+      SetLineOffset (&linofs, line, ip - buffer);
       cureqs[line] = i;
       ++line;
     }
@@ -435,31 +427,28 @@ hashing_done:;
         {
           /* Double (alloc_lines - linbuf_base) by adding to alloc_lines.  */
           alloc_lines = 2 * alloc_lines - linbuf_base;
-          linbuf = (char const HUGE **) xrealloc ((void *)(linbuf + linbuf_base),
-                     (alloc_lines - linbuf_base)
-                     * sizeof (*linbuf))
-             - linbuf_base;
+          alloc_line_offsets (&linofs, linbuf_base, alloc_lines - linbuf_base,
+                              current->buffered_chars);
         }
-      linbuf[line] = (char const HUGE *) p;
+      ofs = (char const HUGE *) p - buffer;
     
      if ((char const HUGE *) p == bufend)
         {
-          linbuf[line]  -=  (char const HUGE *) p == incomplete_tail;
+          SetLineOffset (&linofs, line, ofs - ((char const HUGE *) p == incomplete_tail));
           break;
         }
+      SetLineOffset (&linofs, line, ofs);
 
       if (context <= i && no_diff_means_no_output)
         break;
 
       line++;
 
-      while (p[0] != '\n' && (p[0] != '\r' || p[1] == '\n'))
-         p++;
-      p++;
+      p = FindLineEnd (p, (unsigned char const HUGE *) bufend) + 1;
     }
 
   /* Done with cache in local variables.  */
-  current->linbuf = linbuf;
+  current->linofs = linofs;
   current->valid_lines = line;
   current->alloc_lines = alloc_lines;
   current->equivs = cureqs;
@@ -667,38 +656,39 @@ prepare_text_end (struct file_data *current, short side)
 
 	current->buffered_chars = buffered_chars;
 
-	/* Count line endings and map them to '\n' if ignore_eol_diff is set. */
-	t = q0 = p + buffered_chars;
-	while (q0 > r)
+	/* WinMerge: lines are indexed by their offsets in the buffer.  */
+	if (! LineOffsetsFit (buffered_chars))
+		fatal ("file too large to compare as text");
+
+	/* Count line endings and zero bytes. */
+	{
+		__int64 ncrs = 0, nlfs = 0, ncrlfs = 0, nzeros = 0;
+		if (ScanTextStats(r, p + buffered_chars - r, 0, &ncrs, &nlfs, &ncrlfs, &nzeros))
+			++ncrs; // CR at the end of file
+		current->count_crs += (int)ncrs;
+		current->count_lfs += (int)nlfs;
+		current->count_crlfs += (int)ncrlfs;
+		current->count_zeros += (int)nzeros;
+	}
+
+	/* Map line endings to '\n' if ignore_eol_diff is set. */
+	if (!ignore_eol_diff)
+		t = r;
+	else
 	{
-		switch (*--t = *--q0)
+		t = q0 = p + buffered_chars;
+		while (q0 > r)
 		{
-		case '\r':
-			++current->count_crs;
-			if (ignore_eol_diff)
+			if ((*--t = *--q0) == '\r')
 				*t = '\n';
-			break;
-		case '\n':
-			if (q0 > r && q0[-1] == '\r')
-			{
-				++current->count_crlfs;
-				--current->count_crs; // compensate for bogus increment
-				if (ignore_eol_diff)
-					++t;
-			}
-			else
-			{
-				++current->count_lfs;
-			}
-			break;
-		case '\0':
-			++current->count_zeros;
-			break;
+			else if (*t == '\n' && q0 > r && q0[-1] == '\r')
+				++t;
 		}
 	}
 
   /* Don't use uninitialized storage when planting or using sentinels.  */
-  bzero (p + buffered_chars, sizeof (word));
+  if (!current->mapped)
+    bzero (p + buffered_chars, sizeof (word));
   return t;
 }
 # pragma warning(pop)           // Restores the warning state.
@@ -712,13 +702,11 @@ find_identical_ends (struct file_data filevec[])
   word HUGE *w0, HUGE *w1;
   char HUGE *p0, HUGE *p1, HUGE *buffer0, HUGE *buffer1;
   char const HUGE *end0, HUGE *beg0;
-  char const HUGE **linbuf0, HUGE **linbuf1;
+  struct line_offsets linofs0, linofs1;
   int i, lines;
   FSIZE n0, n1;
-  FSIZE tem;
   FSIZE alloc_lines0, alloc_lines1;
   int buffered_prefix, prefix_count, prefix_mask;
-  int ttt;
 
   if (filevec[0].desc != filevec[1].desc)
     {
@@ -734,6 +722,7 @@ find_identical_ends (struct file_data filevec[])
       filevec[1].buffer = filevec[0].buffer;
       filevec[1].bufsize = filevec[0].bufsize;
       filevec[1].buffered_chars = filevec[0].buffered_chars;
+      filevec[1].mapped = filevec[0].mapped;
       buffer1 = buffer0;
     }
 
@@ -748,6 +737,21 @@ find_identical_ends (struct file_data filevec[])
   if (p0 == p1)
     /* The buffers are the same; sentinels won't work.  */
     p0 = p1 += n1;
+  else if (filevec[0].mapped || filevec[1].mapped)
+    {
+      /* WinMerge: mapped buffers can't have sentinels,
+         compare up to the end of the shorter text instead.
+         Mapped texts end with a newline, so none is missing.  */
+      FSIZE n = min (n0, n1);
+      FSIZE k = 0;
+
+      while (k + sizeof (word) <= n && *(word *) (p0 + k) == *(word *) (p1 + k))
+        k += sizeof (word);
+      while (k < n && p0[k] == p1[k])
+        k++;
+      p0 += k;
+      p1 += k;
+    }
   else
     {
       /* Insert end sentinels, in this case characters that are guaranteed
@@ -795,7 +799,7 @@ find_identical_ends (struct file_data filevec[])
       if (p0[-1] == '\n')
         linestart=1;
       /* only count \r if not followed by a \n on either side */
-      if (p0[-1] == '\r' && p0[0] != '\n' && p1[0] != '\n')
+      if (p0[-1] == '\r' && CHAR_AT (p0, buffer0 + n0) != '\n' && CHAR_AT (p1, buffer1 + n1) != '\n')
         linestart=1;
       if (linestart && !(i--))
         break;
@@ -836,11 +840,11 @@ find_identical_ends (struct file_data filevec[])
          this line to the main body.  Discard up to HORIZON_LINES lines from
          the identical suffix.  Also, discard one extra line,
          because shift_boundaries may need it.  */
-      i = horizon_lines + !((buffer0 == p0 || p0[-1] == '\n' || (p0[-1] == '\r' && p0[0] != '\n'))
+      i = horizon_lines + !((buffer0 == p0 || p0[-1] == '\n' || (p0[-1] == '\r' && CHAR_AT (p0, end0) != '\n'))
           &&
-          (buffer1 == p1 || p1[-1] == '\n' || (p1[-1] == '\r' && p1[0] != '\n')));
+          (buffer1 == p1 || p1[-1] == '\n' || (p1[-1] == '\r' && CHAR_AT (p1, buffer1 + n1) != '\n')));
       while (i-- && p0 != end0)
-        while (*p0++ != '\n' && (p0[-1] != '\r' || p0[0] == '\n'))
+        while (*p0++ != '\n' && (p0[-1] != '\r' || CHAR_AT (p0, end0) == '\n'))
           ;
 
       p1 += p0 - (char HUGE *)beg0;
@@ -861,29 +865,38 @@ find_identical_ends (struct file_data filevec[])
      Otherwise, prefix_count != 0.  Save just prefix_count lines at start
      of the line buffer; they'll be moved to the proper location later.
      Handle 1 more line than the context says (because we count 1 too many),
-     rounded up to the next power of 2 to speed index computation.  */
+     rounded up to the next power of 2 to speed index computation.
+
+     WinMerge: The lines are counted instead of guessed from the size,
+     so the line buffers are allocated once and not grown by doubling.
+     Leave room for the context after the lines and for the end of the
+     last line.  */
 
   if (no_diff_means_no_output)
     {
       for (prefix_count = 1;  prefix_count < context + 1;  prefix_count *= 2)
         ;
       prefix_mask = prefix_count - 1;
-	  assert((p0 - (char HUGE *)filevec[0].prefix_end) < INT_MAX);
-      ttt = (int)(p0 - (char HUGE *)filevec[0].prefix_end);
       alloc_lines0
         = prefix_count
-        + GUESS_LINES (0, 0, ttt)
-        + context;
+        + CountLines ((unsigned char const HUGE *) filevec[0].prefix_end,
+                      (unsigned char const HUGE *) p0)
+        + context + 1;
     }
   else
     {
       prefix_count = 0;
       prefix_mask = ~0;
-      alloc_lines0 = GUESS_LINES (0, 0, n0);
+      alloc_lines0
+        = CountLines ((unsigned char const HUGE *) buffer0,
+                      (unsigned char const HUGE *) buffer0 + n0)
+        + 1;
     }
 
   lines = 0;
-  linbuf0 = (char const HUGE **) xmalloc (alloc_lines0 * sizeof (*linbuf0));
+  linofs0.lo = NULL;
+  linofs0.hi = NULL;
+  alloc_line_offsets (&linofs0, 0, alloc_lines0, filevec[0].buffered_chars);
 
   /* If the prefix is needed, find the prefix lines.  */
   if (! (no_diff_means_no_output
@@ -896,9 +909,9 @@ find_identical_ends (struct file_data filevec[])
         {
           int l = lines++ & prefix_mask;
           if ((FSIZE)l == alloc_lines0)
-            linbuf0 = (char const HUGE **) xrealloc ((void *)linbuf0, (alloc_lines0 *= 2)
-               * sizeof(*linbuf0));
-          linbuf0[l] = p0;
+            alloc_line_offsets (&linofs0, 0, alloc_lines0 *= 2,
+                                filevec[0].buffered_chars);
+          SetLineOffset (&linofs0, l, p0 - filevec[0].buffer);
           /* Perry/WinMerge (2004-01-05) altered original diffutils loop "while (*p0++ != '\n') ;" for other EOLs */
           while (1)
             {
@@ -912,31 +925,40 @@ find_identical_ends (struct file_data filevec[])
   buffered_prefix = prefix_count && context < lines ? context : lines;
 
   /* Allocate line buffer 1.  */
-  tem = prefix_count ? filevec[1].suffix_begin - buffer1 : n1;
-  ttt = (int)(filevec[1].prefix_end - buffer1);
   alloc_lines1
     = (buffered_prefix
-       + GUESS_LINES (lines, ttt, tem)
-       + context);
-  linbuf1 = (char const HUGE **) xmalloc (alloc_lines1 * sizeof (*linbuf1));
+       + CountLines ((unsigned char const HUGE *) filevec[1].prefix_end,
+                     (unsigned char const HUGE *) (prefix_count
+                                                   ? filevec[1].suffix_begin
+                                                   : buffer1 + n1))
+       + context + 1);
+  /* Line buffer 1 holds offsets of file 0 while rotating.  */
+  linofs1.lo = NULL;
+  linofs1.hi = NULL;
+  alloc_line_offsets (&linofs1, 0, alloc_lines1,
+                      max (filevec[0].buffered_chars, filevec[1].buffered_chars));
 
   if (buffered_prefix != lines)
     {
       /* Rotate prefix lines to proper location.  */
       for (i = 0;  i < buffered_prefix;  i++)
-        linbuf1[i] = linbuf0[(lines - context + i) & prefix_mask];
+        SetLineOffset (&linofs1, i, LINE_OFFSET (linofs0, (lines - context + i) & prefix_mask));
       for (i = 0;  i < buffered_prefix;  i++)
-        linbuf0[i] = linbuf1[i];
+        SetLineOffset (&linofs0, i, LINE_OFFSET (linofs1, i));
     }
 
-  /* Initialize line buffer 1 from line buffer 0.  */
+  /* Initialize line buffer 1 from line buffer 0.  The prefix is at the
+     same distance from the start of the text in both files.  */
   for (i = 0; i < buffered_prefix; i++)
-    linbuf1[i] = linbuf0[i] - buffer0 + buffer1;
+    SetLineOffset (&linofs1, i, LINE_OFFSET (linofs0, i)
+                   - (buffer0 - filevec[0].buffer) + (buffer1 - filevec[1].buffer));
 
   /* Record the line buffer, adjusted so that
-     linbuf*[0] points at the first differing line.  */
-  filevec[0].linbuf = linbuf0 + buffered_prefix;
-  filevec[1].linbuf = linbuf1 + buffered_prefix;
+     linofs*[0] is the first differing line.  */
+  filevec[0].linofs.lo = linofs0.lo + buffered_prefix;
+  filevec[0].linofs.hi = linofs0.hi ? linofs0.hi + buffered_prefix : NULL;
+  filevec[1].linofs.lo = linofs1.lo + buffered_prefix;
+  filevec[1].linofs.hi = linofs1.hi ? linofs1.hi + buffered_prefix : NULL;
   filevec[0].linbuf_base = filevec[1].linbuf_base = - buffered_prefix;
   assert((alloc_lines0 - buffered_prefix) < INT_MAX);
   assert((alloc_lines1 - buffered_prefix) < INT_MAX);
@@ -1034,6 +1056,16 @@ read_files (struct file_data filevec[], int pretend_binary, int *bin_file)
 
 		const FSIZE tmax_reasonable = (1 << 19) -1;		// 2**19 bytes, about 524KB
 
+		// WinMerge: mapped text files are read again like the binary ones
+		for (i = 0; i < 2; i++)
+		  if (filevec[i].mapped)
+		    {
+			  release_file_buffer (&filevec[i]);
+			  filevec[i].buffer = xmalloc (sizeof (word));
+			  filevec[i].bufsize = sizeof (word);
+			  filevec[i].buffered_chars = 0;
+		    }
+
 		FSIZE tmax_bufsize = max ((size_t)filevec[0].stat.st_size, 
 								  (size_t)filevec[1].stat.st_size);
 		tmax_bufsize = min (tmax_bufsize, tmax_reasonable);
@@ -1061,6 +1093,7 @@ read_files (struct file_data filevec[], int pretend_binary, int *bin_file)
 		filevec[1].buffer = filevec[0].buffer;
 		filevec[1].bufsize = filevec[0].bufsize;
 		filevec[1].buffered_chars = filevec[0].buffered_chars;
+		filevec[1].mapped = filevec[0].mapped;
 	}
 	
   // Binary comparisons *must not* go past here;  line-break sentinel markers may 
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/**
+ * @file  mapfile.cpp
+ *
+ * @brief Read-only mapping of input files for diffutils.
+ */
+
+#include "pch.h"
+#include <cstddef>
+#ifdef _WIN32
+#include <io.h>
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/**
+ * @brief Map a whole file read-only.
+ * @param [in] fd Descriptor of the file.
+ * @param [in] size Size of the file, not zero.
+ * @return Start of the mapping, nullptr if the file can't be mapped.
+ */
+extern "C" char *map_file(int fd, size_t size)
+{
+#ifdef _WIN32
+	HANDLE hFile = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+	if (hFile == INVALID_HANDLE_VALUE)
+		return nullptr;
+	HANDLE hMap = CreateFileMapping(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (hMap == nullptr)
+		return nullptr;
+	// The view keeps the mapping object alive
+	void *p = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, size);
+	CloseHandle(hMap);
+	return static_cast<char *>(p);
+#else
+	void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+		return nullptr;
+	madvise(p, size, MADV_SEQUENTIAL);
+	return static_cast<char *>(p);
+#endif
+}
+
+/**
+ * @brief Unmap a file mapped by map_file().
+ * @param [in] p Start of the mapping.
+ * @param [in] size Size given to map_file().
+ */
+extern "C" void unmap_file(char *p, size_t size)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(p);
+#else
+	munmap(p, size);
+#endif
+}
@@ -21,9 +21,9 @@ and this notice must be preserved on all copies.  */
 
 #include "diff.h"
 
-static unsigned print_half_line (char const * const *, unsigned, unsigned);
+static unsigned print_half_line (char const HUGE *, char const HUGE *, unsigned, unsigned);
 static unsigned tab_from_to (unsigned, unsigned);
-static void print_1sdiff_line (char const * const *, int, char const * const *);
+static void print_1sdiff_line (struct file_data const *, int, int, struct file_data const *, int);
 static void print_sdiff_common_lines (int, int);
 static void print_sdiff_hunk (struct change *);
 
@@ -68,13 +68,10 @@ tab_from_to (unsigned from, unsigned to)
  * written (not the number of chars).
  */
 static unsigned
-print_half_line (char const * const *line, unsigned indent, unsigned out_bound)
+print_half_line (char const HUGE *text_pointer, char const HUGE *text_limit, unsigned indent, unsigned out_bound)
 {
   FILE *out = outfile;
   register unsigned in_position = 0, out_position = 0;
-  register char const
-	HUGE *text_pointer = line[0],
-	HUGE *text_limit = line[1];
 
   while (text_pointer < text_limit)
     {
@@ -155,13 +152,14 @@ print_half_line (char const * const *line, unsigned indent, unsigned out_bound)
 }
 
 /*
- * Print side by side lines with a separator in the middle.
- * 0 parameters are taken to indicate white space text.
+ * Print line I0 of LEFT and line I1 of RIGHT side by side
+ * with a separator in the middle.
+ * 0 files are taken to indicate white space text.
  * Blank lines that can easily be caught are reduced to a single newline.
  */
 
 static void
-print_1sdiff_line (char const HUGE * const *left, int sep, char const HUGE * const *right)
+print_1sdiff_line (struct file_data const *left, int i0, int sep, struct file_data const *right, int i1)
 {
   FILE *out = outfile;
   unsigned hw = sdiff_half_width, c2o = sdiff_column2_offset;
@@ -170,27 +168,29 @@ print_1sdiff_line (char const HUGE * const *left, int sep, char const HUGE * con
   
   if (left)
     {
-      if (left[1][-1] == '\n')
+      char const HUGE *limit = LINE_START (left, i0 + 1);
+      if (limit[-1] == '\n')
 	put_newline = 1;
-      col = print_half_line (left, 0, hw);
+      col = print_half_line (LINE_START (left, i0), limit, 0, hw);
     }
 
   if (sep != ' ')
     {
       col = tab_from_to (col, (hw + c2o - 1) / 2) + 1;
-      if (sep == '|' && put_newline != (right[1][-1] == '\n'))
+      if (sep == '|' && put_newline != (LINE_START (right, i1 + 1)[-1] == '\n'))
 	sep = put_newline ? '/' : '\\';
       putc (sep, out);
     }
 
   if (right)
     {
-      if (right[1][-1] == '\n')
+      char const HUGE *text = LINE_START (right, i1), HUGE *limit = LINE_START (right, i1 + 1);
+      if (limit[-1] == '\n')
 	put_newline = 1;
-      if (**right != '\n')
+      if (*text != '\n')
 	{
 	  col = tab_from_to (col, c2o);
-	  print_half_line (right, col, hw);
+	  print_half_line (text, limit, col, hw);
 	}
     }
 
@@ -212,12 +212,12 @@ print_sdiff_common_lines (int limit0, int limit1)
       if (! sdiff_left_only)
 	{
 	  while (i0 != limit0 && i1 != limit1)
-	    print_1sdiff_line (&files[0].linbuf[i0++], ' ', &files[1].linbuf[i1++]);
+	    print_1sdiff_line (&files[0], i0++, ' ', &files[1], i1++);
 	  while (i1 != limit1)
-	    print_1sdiff_line (0, ')', &files[1].linbuf[i1++]);
+	    print_1sdiff_line (0, 0, ')', &files[1], i1++);
 	}
       while (i0 != limit0)
-	print_1sdiff_line (&files[0].linbuf[i0++], '(', 0);
+	print_1sdiff_line (&files[0], i0++, '(', 0, 0);
     }
 
   next0 = limit0;
@@ -249,7 +249,7 @@ print_sdiff_hunk (struct change *hunk)
   if (inserts && deletes)
     {
       for (i = first0, j = first1;  i <= last0 && j <= last1; ++i, ++j)
-	print_1sdiff_line (&files[0].linbuf[i], '|', &files[1].linbuf[j]);
+	print_1sdiff_line (&files[0], i, '|', &files[1], j);
       deletes = i <= last0;
       inserts = j <= last1;
       next0 = first0 = i;
@@ -261,7 +261,7 @@ print_sdiff_hunk (struct change *hunk)
   if (inserts)
     {
       for (j = first1; j <= last1; ++j)
-	print_1sdiff_line (0, '>', &files[1].linbuf[j]);
+	print_1sdiff_line (0, 0, '>', &files[1], j);
       next1 = j;
     }
 
@@ -269,7 +269,7 @@ print_sdiff_hunk (struct change *hunk)
   if (deletes)
     {
       for (i = first0; i <= last0; ++i)
-	print_1sdiff_line (&files[0].linbuf[i], '<', 0);
+	print_1sdiff_line (&files[0], i, '<', 0, 0);
       next0 = i;
     }
 }
@@ -538,14 +538,14 @@ print_script (struct change *script,
     }
 }
 
-/* Print the text of a single line LINE,
+/* Print the text of line I of FILE,
    flagging it with the characters in LINE_FLAG (which say whether
    the line is inserted, deleted, changed, etc.).  */
 
 void
-print_1_line (char const *line_flag, char const * const *line)
+print_1_line (char const *line_flag, struct file_data const *file, int i)
 {
-  char const HUGE *text = line[0], HUGE *limit = line[1]; /* Help the compiler.  */
+  char const HUGE *text = LINE_START (file, i), HUGE *limit = LINE_START (file, i + 1); /* Help the compiler.  */
   FILE *out = outfile; /* Help the compiler some more.  */
   char const *flag_format = NULL;
 
@@ -775,15 +775,15 @@ analyze_hunk (struct change *hunk, int *first0, int *last0, int *first1, int *la
       show_to += next->inserted;
 
       for (i = next->line0; i <= l0 && trivial; i++)
-        if (!ignore_blank_lines_flag || (!iseolch(fd[0].linbuf[i][0]) &&
-            fd[0].linbuf[i][0] != 0))
+        if (!ignore_blank_lines_flag || (!iseolch(LINE_START (&fd[0], i)[0]) &&
+            LINE_START (&fd[0], i)[0] != 0))
           {
             trivial = 0;
           }
 
       for (i = next->line1; i <= l1 && trivial; i++)
-        if (!ignore_blank_lines_flag || (!iseolch(fd[1].linbuf[i][0]) &&
-            fd[1].linbuf[i][0] != 0))
+        if (!ignore_blank_lines_flag || (!iseolch(LINE_START (&fd[1], i)[0]) &&
+            LINE_START (&fd[1], i)[0] != 0))
           {
             trivial = 0;
           }
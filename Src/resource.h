@@ -549,6 +549,7 @@
 #define IDC_INDENT_HEURISTIC            8829
 #define IDC_LIST_FILE                   8830
 #define IDC_FLDCONFIRM_DONTASKAGAIN     8831
+#define IDC_COMPARE_LARGEST_FIRST       8832
 #define IDS_SPLASH_DEVELOPERS           8976
 #define IDS_SPLASH_GPLTEXT              8977
 #define IDS_MESSAGEBOX_OK               9001
@@ -612,6 +613,7 @@
 #define ID_COMPMETHOD_MODDATE           16435
 #define ID_COMPMETHOD_DATESIZE          16436
 #define ID_COMPMETHOD_SIZE              16437
+#define ID_COMPMETHOD_HASH              16438
 #define IDS_FILTERFILE_NAMETITLE        16448
 #define IDS_FILTERFILE_PATHTITLE        16449
 #define IDS_FILTER_TITLE                16450
@@ -807,6 +809,7 @@
 #define IDS_COLHDR_NIDIFFS              17814
 #define IDS_COLHDR_NSDIFFS              17815
 #define IDS_COLHDR_BINARY               17816
+#define IDS_COLHDR_ALGORITHM            17817
 #define IDS_CANT_COMPARE_FILES          17831
 #define IDS_ABORTED_ITEM                17832
 #define IDS_FILE_SKIPPED                17833
@@ -871,6 +874,7 @@
 #define IDS_COLDESC_NIDIFFS             17944
 #define IDS_COLDESC_NSDIFFS             17945
 #define IDS_COLDESC_BINARY              17946
+#define IDS_COLDESC_ALGORITHM           17947
 #define IDS_DIRECTORY_REPORT_TITLE      17962
 #define IDS_REPORT_COMMALIST            17963
 #define IDS_REPORT_TABLIST              17964
@@ -1251,6 +1255,7 @@
 #define IDS_COMPMETHOD_MODDATE          33493
 #define IDS_COMPMETHOD_DATESIZE         33494
 #define IDS_COMPMETHOD_SIZE             33495
+#define IDS_COMPMETHOD_HASH             33496
 #define IDS_UNPACK_AUTO                 33497
 #define IDS_NO_PREDIFFER                33501
 #define IDS_SUGGESTED_PLUGINS           33502
@@ -1279,6 +1284,7 @@
 #define IDS_DIFF_ALGORITHM_MINIMAL      33701
 #define IDS_DIFF_ALGORITHM_PATIENCE     33702
 #define IDS_DIFF_ALGORITHM_HISTOGRAM    33703
+#define IDS_DIFF_ALGORITHM_AUTO         33704
 #define IDS_RENDERING_MODE_GDI          33710
 #define IDS_RENDERING_MODE_DIRECTWRITE_DEFAULT 33711
 #define IDS_RENDERING_MODE_DIRECTWRITE_ALIASED 33712
@@ -1335,7 +1341,7 @@
 #define _APS_3D_CONTROLS                     1
 #define _APS_NEXT_RESOURCE_VALUE        253
 #define _APS_NEXT_COMMAND_VALUE         34164
-#define _APS_NEXT_CONTROL_VALUE         8832
+#define _APS_NEXT_CONTROL_VALUE         8833
 #define _APS_NEXT_SYMED_VALUE           117
 #endif
 #endif
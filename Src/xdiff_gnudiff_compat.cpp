@@ -2,30 +2,77 @@
 #include <io.h>
 #include <sys/stat.h>
 #include "CompareOptions.h"
+#include "FileTextStats.h"
 extern "C" {
 #include "../Externals/xdiff/xinclude.h"
 }
 
-static bool read_mmfile(int fd, mmfile_t& mmfile)
+/**
+ * @brief Read the whole file into the buffer of @p inf, unless the caller
+ * already did. Large files are mapped, xdiff doesn't write into the buffer.
+ * Nonexistent files and devices are read as empty.
+ */
+static void read_file_data(file_data& inf)
 {
-	struct _stat64 st;
-	if (myfstat(fd, &st) == -1)
-		return false;
-	if (st.st_size < 0 || st.st_size > INT32_MAX)
-		return false;
-	size_t sz = static_cast<size_t>(st.st_size);
-	mmfile.ptr = static_cast<char *>(malloc(sz ? sz : 1));
-	if (sz && _read(fd, mmfile.ptr, static_cast<unsigned>(sz)) == -1) {
-		return false;
+	if (inf.preloaded)
+		return;
+	if (inf.desc < 0 || !S_ISREG(inf.stat.st_mode))
+	{
+		inf.buffer = static_cast<char *>(xmalloc(1));
+		inf.bufsize = 1;
+		inf.buffered_chars = 0;
+		return;
+	}
+	// xdiff keeps sizes in longs
+	if (inf.stat.st_size < 0 || inf.stat.st_size > INT32_MAX)
+		fatal("file too large to compare as text");
+	const size_t size = static_cast<size_t>(inf.stat.st_size);
+	if (size >= MAP_MIN_SIZE && (inf.buffer = map_file(inf.desc, size)) != nullptr)
+	{
+		inf.bufsize = inf.buffered_chars = size;
+		inf.mapped = 1;
+		return;
+	}
+	inf.buffer = static_cast<char *>(xmalloc(size ? size : 1));
+	inf.bufsize = size;
+	inf.buffered_chars = 0;
+	while (inf.buffered_chars < size)
+	{
+		const int cc = _read(inf.desc, inf.buffer + inf.buffered_chars, static_cast<unsigned>(size - inf.buffered_chars));
+		if (cc < 0)
+			pfatal_with_name(inf.name);
+		if (cc == 0)
+			break;
+		inf.buffered_chars += cc;
 	}
-	mmfile.size = static_cast<long>(sz);
-	return true;
 }
 
-unsigned long make_xdl_flags(const DiffutilsOptions& options)
+/**
+ * @brief Count the line endings and zero bytes of the buffer, and check if
+ * the file appears binary, in one pass.
+ * Like diffutils, only the first block is checked for zero bytes.
+ * @return true if the file appears binary.
+ */
+static bool scan_file_data(file_data& inf)
+{
+	__int64 ncrs = 0, nlfs = 0, ncrlfs = 0, nzeros = 0;
+	const size_t size = inf.buffered_chars;
+	const size_t first = (std::min)(size, static_cast<size_t>(STAT_BLOCKSIZE(inf.stat)));
+	const int pendingCR = ScanTextStats(inf.buffer, first, 0, &ncrs, &nlfs, &ncrlfs, &nzeros);
+	const bool binary = nzeros != 0 && !unicode_signature_p(&inf);
+	if (ScanTextStats(inf.buffer + first, size - first, pendingCR, &ncrs, &nlfs, &ncrlfs, &nzeros))
+		++ncrs; // CR at the end of file
+	inf.count_crs = static_cast<int>(ncrs);
+	inf.count_lfs = static_cast<int>(nlfs);
+	inf.count_crlfs = static_cast<int>(ncrlfs);
+	inf.count_zeros = static_cast<int>(nzeros);
+	return binary;
+}
+
+unsigned long make_xdl_flags(const DiffutilsOptions& options, DiffAlgorithm algorithm)
 {
 	unsigned long xdl_flags = 0;
-	switch (options.m_diffAlgorithm)
+	switch (algorithm)
 	{
 	case DIFF_ALGORITHM_MINIMAL:
 		xdl_flags |= XDF_NEED_MINIMAL;
@@ -66,60 +113,95 @@ static int hunk_func(long start_a, long count_a, long start_b, long count_b, voi
 	return 0;
 }
 
-static void append_equivs(const xdfile_t& xdf, struct file_data& filevec, std::vector<xrecord_t *>& equivs, unsigned xdl_flags)
+/**
+ * @brief Record the line starts of a file as offsets in its buffer.
+ */
+static void set_line_offsets(const xdfile_t& xdf, file_data& filevec)
 {
-	std::unordered_map<unsigned long, std::vector<int>> equivs_map;
-	for (int i = 0; i < static_cast<int>(equivs.size()); ++i)
-	{
-		unsigned long ha = equivs[i]->ha;
-		if (equivs_map.find(ha) != equivs_map.end())
-			equivs_map[ha].push_back(i);
-		else
-			equivs_map.emplace(ha, std::vector<int>{i});
-	}
+	filevec.linofs.lo = nullptr;
+	filevec.linofs.hi = nullptr;
+	if (!ReallocLineOffsets(&filevec.linofs, 0, xdf.nrec + 1, filevec.buffered_chars))
+		fatal("virtual memory exhausted");
+	for (long i = 0; i < xdf.nrec; ++i)
+		SetLineOffset(&filevec.linofs, i, xdf.recs[i]->ptr - filevec.buffer);
+	SetLineOffset(&filevec.linofs, xdf.nrec, xdf.nrec > 0
+		? xdf.recs[xdf.nrec - 1]->ptr + xdf.recs[xdf.nrec - 1]->size - filevec.buffer
+		: 0);
+}
 
-	for (int i = 0; i < xdf.nrec; ++i)
+/**
+ * @brief Number the classes of equal lines of both files for the moved
+ * block detection.
+ * Except for the histogram algorithm, xdl_prepare_env() already replaced
+ * the hash of each record by the number of its class. The histogram
+ * algorithm leaves the hashes, and records with the same hash are compared
+ * here the same way the classifier of xdiff does.
+ */
+static void set_equivs(const xdfenv_t& xe, struct file_data filevec[], unsigned xdl_flags)
+{
+	const xdfile_t *xdfs[2] = { &xe.xdf1, &xe.xdf2 };
+	const bool bClassified = XDF_DIFF_ALG(xdl_flags) != XDF_HISTOGRAM_DIFF;
+	const unsigned hbits = xdl_hashbits(static_cast<unsigned>(xe.xdf1.nrec + xe.xdf2.nrec));
+	std::vector<int> buckets(bClassified ? 0 : static_cast<size_t>(1) << hbits, -1);
+	std::vector<int> next; // next class in the same bucket
+	std::vector<const xrecord_t *> classes; // first record of each class
+	for (int side = 0; side < 2; ++side)
 	{
-		unsigned long ha = xdf.recs[i]->ha;
-		if (equivs_map.find(ha) != equivs_map.end())
+		const xdfile_t& xdf = *xdfs[side];
+		filevec[side].equivs = static_cast<int *>(xmalloc(sizeof(int) * (xdf.nrec + 1)));
+		for (long i = 0; i < xdf.nrec; ++i)
 		{
-			bool found = false;
-			for (auto j: equivs_map[ha])
+			const xrecord_t *rec = xdf.recs[i];
+			if (bClassified)
+			{
+				filevec[side].equivs[i] = static_cast<int>(rec->ha);
+				continue;
+			}
+			int& bucket = buckets[XDL_HASHLONG(rec->ha, hbits)];
+			int c;
+			for (c = bucket; c >= 0; c = next[c])
 			{
-				if (xdl_recmatch(equivs[j]->ptr, equivs[j]->size, xdf.recs[i]->ptr, xdf.recs[i]->size, xdl_flags))
-				{
-					found = true;
-					filevec.equivs[i] = j;
-					equivs_map.emplace(ha, std::vector<int>{j});
+				if (classes[c]->ha == rec->ha &&
+					xdl_recmatch(classes[c]->ptr, classes[c]->size, rec->ptr, rec->size, xdl_flags))
 					break;
-				}
 			}
-			if (!found)
+			if (c < 0)
 			{
-				filevec.equivs[i] = static_cast<int>(equivs.size());
-				equivs_map[ha].push_back(filevec.equivs[i]);
-				equivs.push_back(xdf.recs[i]);
+				c = static_cast<int>(classes.size());
+				classes.push_back(rec);
+				next.push_back(bucket);
+				bucket = c;
 			}
-		}
-		else
-		{
-			filevec.equivs[i] = static_cast<int>(equivs.size());
-			equivs_map.emplace(ha, std::vector<int>{filevec.equivs[i]});
-			equivs.push_back(xdf.recs[i]);
+			filevec[side].equivs[i] = c;
 		}
 	}
 }
 
-static int is_missing_newline(const mmfile_t& mmfile)
+static int is_missing_newline(const file_data& inf)
 {
-	if (mmfile.size == 0 || mmfile.ptr[mmfile.size - 1] == '\r' || mmfile.ptr[mmfile.size - 1] == '\n')
+	if (inf.buffered_chars == 0 || inf.buffer[inf.buffered_chars - 1] == '\r' || inf.buffer[inf.buffered_chars - 1] == '\n')
 		return 0;
 	return 1;
 }
 
-struct change * diff_2_files_xdiff (struct file_data filevec[], int bMoved_blocks_flag, unsigned xdl_flags)
+/**
+ * @brief Compare two files with the xdiff algorithms.
+ * Each file is read once into the buffer of its file_data, or the buffer
+ * filled by the caller is used. xdiff splits and classifies the lines in
+ * that buffer, and the result is given in the form diff_2_files() gives it.
+ * @param [in,out] filevec Opened files, they get the buffers, lines and text
+ * statistics.
+ * @param [out] bin_status Set to -1 for different binary files, +1 for same
+ * binary files, not changed for text files.
+ * @param [in] bMoved_blocks_flag Nonzero if moved blocks are detected.
+ * @param [out] bin_file Bitmap of the files appearing binary, can be nullptr.
+ * @param [in] xdl_flags Options for xdiff, see make_xdl_flags().
+ * @return Script of the changes, nullptr if there are none or the files are
+ * binary.
+ */
+struct change * diff_2_files_xdiff (struct file_data filevec[], int * bin_status, int bMoved_blocks_flag, int * bin_file, unsigned xdl_flags)
 {
-	mmfile_t mmfile1 = { 0 }, mmfile2 = { 0 };
+	const bool bSameFile = filevec[0].desc == filevec[1].desc;
 	change *script = nullptr;
 	xdfenv_t xe;
 	xdchange_t *xscr;
@@ -127,92 +209,80 @@ struct change * diff_2_files_xdiff (struct file_data filevec[], int bMoved_block
 	xdemitconf_t xecfg = { 0 };
 	xdemitcb_t ecb = { 0 };
 
-	if (!read_mmfile(filevec[0].desc, mmfile1))
-		goto abort;
-	if (!read_mmfile(filevec[1].desc, mmfile2))
-		goto abort;
+	read_file_data(filevec[0]);
+	const bool bBinary0 = scan_file_data(filevec[0]);
+	if (bSameFile)
+	{
+		filevec[1].buffer = filevec[0].buffer;
+		filevec[1].bufsize = filevec[0].bufsize;
+		filevec[1].buffered_chars = filevec[0].buffered_chars;
+		filevec[1].mapped = filevec[0].mapped;
+		filevec[1].count_crs = filevec[0].count_crs;
+		filevec[1].count_lfs = filevec[0].count_lfs;
+		filevec[1].count_crlfs = filevec[0].count_crlfs;
+		filevec[1].count_zeros = filevec[0].count_zeros;
+	}
+	else
+		read_file_data(filevec[1]);
+	const bool bBinary1 = bSameFile ? bBinary0 : scan_file_data(filevec[1]);
 
+	if (bin_file != nullptr)
+		*bin_file = (bBinary0 ? 1 : 0) | (bBinary1 ? 2 : 0);
+	if (bBinary0 || bBinary1)
+	{
+		// The whole files are in the buffers, compare them as diff_2_files() does
+		const bool bChanges = !bSameFile &&
+			(filevec[0].buffered_chars != filevec[1].buffered_chars ||
+			 memcmp(filevec[0].buffer, filevec[1].buffer, filevec[0].buffered_chars) != 0);
+		if (bin_status != nullptr)
+			*bin_status = bChanges ? -1 : 1;
+		return nullptr;
+	}
+
+	mmfile_t mmfile1 = { filevec[0].buffer, static_cast<long>(filevec[0].buffered_chars) };
+	mmfile_t mmfile2 = { filevec[1].buffer, static_cast<long>(filevec[1].buffered_chars) };
 	xpp.flags = xdl_flags;
 	xecfg.hunk_func = hunk_func;
-	if (xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr) == 0)
-	{
-		filevec[0].buffer = mmfile1.ptr;
-		filevec[1].buffer = mmfile2.ptr;
-		filevec[0].bufsize = mmfile1.size;
-		filevec[1].bufsize = mmfile2.size;
-		filevec[0].buffered_chars = mmfile1.size;
-		filevec[1].buffered_chars = mmfile2.size;
-		filevec[0].linbuf_base = 0;
-		filevec[1].linbuf_base = 0;
-		filevec[0].valid_lines = xe.xdf1.nrec;
-		filevec[1].valid_lines = xe.xdf2.nrec;
-		filevec[0].linbuf = static_cast<const char **>(malloc(sizeof(char *) * (xe.xdf1.nrec + 1)));
-		if (!filevec[0].linbuf)
-			goto abort;
-		filevec[1].linbuf = static_cast<const char **>(malloc(sizeof(char *) * (xe.xdf2.nrec + 1)));
-		if (!filevec[1].linbuf)
-			goto abort;
-		filevec[0].equivs = static_cast<int *>(malloc(sizeof(int) * xe.xdf1.nrec));
-		if (!filevec[0].equivs)
-			goto abort;
-		filevec[1].equivs = static_cast<int *>(malloc(sizeof(int) * xe.xdf2.nrec));
-		if (!filevec[1].equivs)
-			goto abort;
-		for (int i = 0; i < xe.xdf1.nrec; ++i)
-		{
-			filevec[0].linbuf[i] = xe.xdf1.recs[i]->ptr;
-			filevec[0].equivs[i] = -1;
-		}
-		if (xe.xdf1.nrec > 0)
-			filevec[0].linbuf[xe.xdf1.nrec] = xe.xdf1.recs[xe.xdf1.nrec - 1]->ptr + xe.xdf1.recs[xe.xdf1.nrec - 1]->size;
-		for (int i = 0; i < xe.xdf2.nrec; ++i)
-		{
-			filevec[1].linbuf[i] = xe.xdf2.recs[i]->ptr;
-			filevec[1].equivs[i] = -1;
-		}
-		if (xe.xdf2.nrec > 0)
-			filevec[1].linbuf[xe.xdf2.nrec] = xe.xdf2.recs[xe.xdf2.nrec - 1]->ptr + xe.xdf2.recs[xe.xdf2.nrec - 1]->size;
-		filevec[0].missing_newline = is_missing_newline(mmfile1);
-		filevec[1].missing_newline = is_missing_newline(mmfile2);
+	if (xdl_diff_modified(&mmfile1, &mmfile2, &xpp, &xecfg, &ecb, &xe, &xscr) != 0)
+		fatal("memory exhausted");
 
-		change *prev = nullptr;
-		for (xdchange_t* xcur = xscr; xcur; xcur = xcur->next)
-		{
-			change* e = static_cast<change*>(malloc(sizeof(change)));
-			if (!e)
-				goto abort;
-			if (!script)
-				script = e;
-			e->line0 = xcur->i1;
-			e->line1 = xcur->i2;
-			e->deleted = xcur->chg1;
-			e->inserted = xcur->chg2;
-			e->match0 = -1;
-			e->match1 = -1;
-			e->trivial = static_cast<char>(xcur->ignore);
-			e->link = nullptr;
-			e->ignore = 0;
-			if (prev)
-				prev->link = e;
-			prev = e;
-		}
+	filevec[0].linbuf_base = 0;
+	filevec[1].linbuf_base = 0;
+	filevec[0].valid_lines = xe.xdf1.nrec;
+	filevec[1].valid_lines = xe.xdf2.nrec;
+	set_line_offsets(xe.xdf1, filevec[0]);
+	set_line_offsets(xe.xdf2, filevec[1]);
+	filevec[0].missing_newline = is_missing_newline(filevec[0]);
+	filevec[1].missing_newline = is_missing_newline(filevec[1]);
 
-		if (bMoved_blocks_flag)
-		{
-			std::vector<xrecord_t *> equivs;
-			append_equivs(xe.xdf1, filevec[0], equivs, xdl_flags);
-			append_equivs(xe.xdf2, filevec[1], equivs, xdl_flags);
-			moved_block_analysis(&script, filevec);
-		}
+	change *prev = nullptr;
+	for (xdchange_t* xcur = xscr; xcur; xcur = xcur->next)
+	{
+		change* e = static_cast<change*>(xmalloc(sizeof(change)));
+		if (!script)
+			script = e;
+		e->line0 = xcur->i1;
+		e->line1 = xcur->i2;
+		e->deleted = xcur->chg1;
+		e->inserted = xcur->chg2;
+		e->match0 = -1;
+		e->match1 = -1;
+		e->trivial = static_cast<char>(xcur->ignore);
+		e->link = nullptr;
+		e->ignore = 0;
+		if (prev)
+			prev->link = e;
+		prev = e;
+	}
 
-		xdl_free_script(xscr);
-		xdl_free_env(&xe);
+	if (bMoved_blocks_flag)
+	{
+		set_equivs(xe, filevec, xdl_flags);
+		moved_block_analysis(&script, filevec);
 	}
 
-	return script;
+	xdl_free_script(xscr);
+	xdl_free_env(&xe);
 
-abort:
-	free(mmfile1.ptr);
-	free(mmfile2.ptr);
-	return nullptr;
+	return script;
 }
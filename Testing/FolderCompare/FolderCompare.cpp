@@ -1,81 +1,232 @@
 #include "pch.h"
 #include "DiffContext.h"
 #include "CompareStats.h"
+#include "CompareOptions.h"
 #include "DiffThread.h"
 #include "DiffWrapper.h"
+#include "DiffItem.h"
+#include "BinaryCompare.h"
+#include "DirScan.h"
 #include "FileFilterHelper.h"
-#include "FolderCmp.h"
+#include "Environment.h"
+#include "OptionsDef.h"
+#include "OptionsMgr.h"
+#include "paths.h"
+#include "TFile.h"
 #include <iostream>
 #include <Poco/Thread.h>
+#include <Poco/FileStream.h>
+#include <Poco/Stopwatch.h>
 #ifdef _MSC_VER
 #include <crtdbg.h>
 #endif
 
-int main()
+/**
+ * @brief Create a synthetic folder tree of small identical files.
+ * @param [in] root Folder to create the tree under.
+ * @param [in] nFiles Number of files to create.
+ * @param [in] nFilesPerDir Number of files in one subfolder.
+ */
+static void CreateSyntheticTree(const String& root, int nFiles, int nFilesPerDir)
 {
-#ifdef _MSC_VER
-	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
-#endif
-	CompareStats cmpstats(2);
+	const std::string content = "The quick brown fox jumps over the lazy dog.\r\n";
+	for (int i = 0; i < nFiles; ++i)
+	{
+		String dir = paths::ConcatPath(root, strutils::format(_T("dir%05d"), i / nFilesPerDir));
+		if (i % nFilesPerDir == 0)
+			TFile(dir).createDirectories();
+		String path = paths::ConcatPath(dir, strutils::format(_T("file%05d.txt"), i));
+		Poco::FileOutputStream ofs(ucr::toUTF8(path), std::ios::binary);
+		ofs << content;
+	}
+}
+
+/**
+ * @brief Create big files in a subfolder sorted after the synthetic tree.
+ * @param [in] root Folder to create the files under.
+ * @param [in] nFiles Number of files to create.
+ * @param [in] nSizeMB Size of one file in megabytes.
+ */
+static void CreateLargeFiles(const String& root, int nFiles, int nSizeMB)
+{
+	String dir = paths::ConcatPath(root, _T("zzlarge"));
+	TFile(dir).createDirectories();
+	const std::string block(1024 * 1024, 'x');
+	for (int i = 0; i < nFiles; ++i)
+	{
+		String path = paths::ConcatPath(dir, strutils::format(_T("large%02d.bin"), i));
+		Poco::FileOutputStream ofs(ucr::toUTF8(path), std::ios::binary);
+		for (int j = 0; j < nSizeMB; ++j)
+			ofs << block;
+	}
+}
+
+/**
+ * @brief Benchmark BinaryCompare on identical and nearly identical big files.
+ * The nearly identical file differs only in its last byte, so both files
+ * are read completely in both cases.
+ * @param [in] root Folder to create the files under.
+ * @param [in] nSizeMB Size of the files in megabytes.
+ */
+static void BenchmarkBinaryCompare(const String& root, int nSizeMB)
+{
+	String dir = paths::ConcatPath(root, _T("binary"));
+	TFile(dir).createDirectories();
+	String names[3] = { _T("a.bin"), _T("b.bin"), _T("c.bin") };
+	const std::string block(1024 * 1024, 'x');
+	for (int i = 0; i < 3; ++i)
+	{
+		names[i] = paths::ConcatPath(dir, names[i]);
+		Poco::FileOutputStream ofs(ucr::toUTF8(names[i]), std::ios::binary);
+		for (int j = 0; j < nSizeMB - 1; ++j)
+			ofs << block;
+		std::string last = block;
+		if (i == 2)
+			last[last.size() - 1] = 'y';
+		ofs << last;
+	}
+
+	CompareEngines::BinaryCompare bc;
+	DIFFITEM di;
+	for (int i = 0; i < 2; ++i)
+		di.diffFileInfo[i].size = static_cast<int64_t>(nSizeMB) * 1024 * 1024;
+	static const struct { int file; const char *name; } tests[] = {
+		{ 1, "Binary compare, identical: " },
+		{ 2, "Binary compare, last byte differs: " },
+	};
+	for (const auto& test : tests)
+	{
+		Poco::Stopwatch stopwatch;
+		stopwatch.start();
+		int code = bc.CompareFiles(PathContext(names[0], names[test.file]), di);
+		stopwatch.stop();
+		double seconds = stopwatch.elapsed() / 1000000.0;
+		std::cout << test.name << (code == DIFFCODE::SAME ? "same" : "different");
+		if (di.firstDiffOffset >= 0)
+			std::cout << " at " << di.firstDiffOffset;
+		std::cout << " in " << seconds << " s";
+		if (seconds > 0)
+			std::cout << ", " << static_cast<int>(2 * nSizeMB / seconds) << " MB/s";
+		std::cout << std::endl;
+	}
+}
+
+/**
+ * @brief Run a full folder compare (collect + compare) and return items/second.
+ * @param [out] pSeconds Wall-clock time of the compare, if not nullptr.
+ */
+static double RunFolderCompare(const PathContext& paths, int compareMethod, int nThreads,
+	bool bLargestFirst = false, double *pSeconds = nullptr)
+{
+	CompareStats cmpstats(paths.GetSize());
 
 	FileFilterHelper filter;
 	filter.UseMask(true);
-//	filter.SetMask(_T("*.cpp;*.c;*.h;*.vcproj;*.vcxproj"));
 	filter.SetMask(_T("*.*"));
 
-	CDiffContext ctx(
-		PathContext(_T("c:/windows"), _T("c:/windows")),
-		CMP_CONTENT);
+	CDiffContext ctx(paths, compareMethod);
 
 	DIFFOPTIONS options = {0};
-	options.nIgnoreWhitespace = false;
-	options.bIgnoreBlankLines = false;
-	options.bFilterCommentsLines = false;
-	options.bIgnoreCase = false;
-	options.bIgnoreEol = false;
-
 	ctx.InitDiffItemList();
-	//ctx.CreateCompareOptions(CMP_CONTENT, options);
-	ctx.CreateCompareOptions(CMP_DATE, options);
+	ctx.CreateCompareOptions(compareMethod, options);
 
-	ctx.m_iGuessEncodingType = 0;//(50001 << 16) + 2;
+	ctx.m_iGuessEncodingType = 0;
 	ctx.m_bIgnoreSmallTimeDiff = true;
 	ctx.m_bStopAfterFirstDiff = false;
 	ctx.m_nQuickCompareLimit = 4 * 1024 * 1024;
+	ctx.m_nBinaryCompareLimit = 64 * 1024 * 1024;
 	ctx.m_bPluginsEnabled = false;
+	ctx.m_piPluginInfos = nullptr;
 	ctx.m_bWalkUniques = true;
 	ctx.m_pCompareStats = &cmpstats;
 	ctx.m_bRecursive = true;
 	ctx.m_piFilterGlobal = &filter;
 
-	// Folder names to compare are in the compare context
+	GetOptionsMgr()->InitOption(OPT_CMP_COMPARE_THREADS, -1);
+	GetOptionsMgr()->SaveOption(OPT_CMP_COMPARE_THREADS, nThreads);
+	GetOptionsMgr()->InitOption(OPT_CMP_COMPARE_LARGEST_FIRST, false);
+	GetOptionsMgr()->SaveOption(OPT_CMP_COMPARE_LARGEST_FIRST, bLargestFirst);
+
+	Poco::Stopwatch stopwatch;
+	stopwatch.start();
+
 	CDiffThread diffThread;
 	diffThread.SetContext(&ctx);
-	diffThread.SetCompareSelected(false);
+	diffThread.SetCollectFunction([](DiffFuncStruct* myStruct) {
+		PathContext paths = myStruct->context->GetNormalizedPaths();
+		String subdir[3] = {_T(""), _T(""), _T("")};
+		DirScan_GetItems(paths, subdir, myStruct, false, -1, nullptr, myStruct->context->m_bWalkUniques);
+	});
+	diffThread.SetCompareFunction([](DiffFuncStruct* myStruct) {
+		DirScan_CompareItems(myStruct, nullptr);
+	});
 	diffThread.CompareDirectories();
 
 	while (diffThread.GetThreadState() != CDiffThread::THREAD_COMPLETED)
+		Poco::Thread::sleep(10);
+
+	stopwatch.stop();
+	int nItems = cmpstats.GetComparedItems();
+	double seconds = stopwatch.elapsed() / 1000000.0;
+	std::cout << nItems << " items in " << seconds << " s" << std::endl;
+	if (pSeconds != nullptr)
+		*pSeconds = seconds;
+	return seconds > 0 ? nItems / seconds : 0;
+}
+
+/**
+ * @brief Benchmark folder compare throughput on a tree of small identical files.
+ * Then some big files are added to the end of the tree to compare the
+ * makespan of tree order and largest-first scheduling.
+ * Finally BinaryCompare is run on a pair of multi-GB files.
+ * Usage: FolderCompare [files] [threads] [big file size in MB] [binary compare file size in MB]
+ */
+int main(int argc, char *argv[])
+{
+#ifdef _MSC_VER
+	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+	int nFiles = argc > 1 ? atoi(argv[1]) : 20000;
+	int nThreads = argc > 2 ? atoi(argv[2]) : -1;
+	int nLargeSizeMB = argc > 3 ? atoi(argv[3]) : 48;
+	int nBinarySizeMB = argc > 4 ? atoi(argv[4]) : 2048;
+
+	String root = paths::ConcatPath(env::GetTemporaryPath(), _T("FolderCompareBench"));
+	String left = paths::ConcatPath(root, _T("left"));
+	String right = paths::ConcatPath(root, _T("right"));
+	CreateSyntheticTree(left, nFiles, 100);
+	CreateSyntheticTree(right, nFiles, 100);
+
+	static const struct { int method; const char *name; } methods[] = {
+		{ CMP_CONTENT, "Full contents" },
+		{ CMP_QUICK_CONTENT, "Quick contents" },
+		{ CMP_BINARY_CONTENT, "Binary contents" },
+		{ CMP_HASH, "Contents hash" },
+		{ CMP_DATE_SIZE, "Modified date and size" },
+	};
+	for (const auto& m : methods)
 	{
-		Poco::Thread::sleep(200);
-		std::cout << cmpstats.GetComparedItems() << std::endl;
+		std::cout << m.name << ": ";
+		double rate = RunFolderCompare(PathContext(left, right), m.method, nThreads);
+		std::cout << "  " << static_cast<int>(rate) << " items/s" << std::endl;
 	}
 
-	DIFFITEM *pos = ctx.GetFirstDiffPosition();
-	while (pos)
+	// A few big files found last keep one worker busy after the small
+	// files are done unless they are started first
+	CreateLargeFiles(left, 4, nLargeSizeMB);
+	CreateLargeFiles(right, 4, nLargeSizeMB);
+	double seconds[2] = {};
+	for (int i = 0; i < 2; ++i)
 	{
-		DIFFITEM& di = ctx.GetNextDiffRefPosition(pos);
-		if (ctx.m_piFilterGlobal->includeFile(di.diffFileInfo[0].filename, di.diffFileInfo[1].filename))
-		{
-			FolderCmp folderCmp;
-			folderCmp.prepAndCompareFiles(&ctx, di);
-#ifdef _UNICODE
-//		std::wcout << di.diffFileInfo[0].filename << ":" << di.diffcode.isResultDiff() << std::endl;
-#else
-//		std::cout << di.diffFileInfo[0].filename << ":" << di.diffcode.isResultDiff() << std::endl;
-#endif
-		}
-
+		std::cout << (i == 0 ? "Tree order: " : "Largest first: ");
+		RunFolderCompare(PathContext(left, right), CMP_CONTENT, nThreads, i == 1, &seconds[i]);
 	}
+	if (seconds[1] > 0)
+		std::cout << "  largest first speedup: " << seconds[0] / seconds[1] << "x" << std::endl;
+
+	if (nBinarySizeMB > 0)
+		BenchmarkBinaryCompare(root, nBinarySizeMB);
 
+	TFile(root).remove(true);
 	return 0;
 }
@@ -200,6 +200,49 @@ namespace
 		EXPECT_EQ(DIFFCODE::DIFF | DIFFCODE::DIFF1STONLY, bc.CompareFiles(files, di));
 	}
 
+	TEST_F(BinaryCompareTest, FirstDiffOffset)
+	{
+		CompareEngines::BinaryCompare bc;
+		PathContext files;
+		DIFFITEM di;
+		std::string data(1024 * 1024 + 7, 'x');
+
+		files.SetLeft(_T("A"));
+		files.SetRight(_T("B"));
+		di.diffFileInfo[0].size = data.size();
+		di.diffFileInfo[1].size = data.size();
+		{
+			TempFile l1("A", data.c_str(), data.size());
+			TempFile r1("B", data.c_str(), data.size());
+			EXPECT_EQ(DIFFCODE::SAME, bc.CompareFiles(files, di));
+			EXPECT_EQ(-1, di.firstDiffOffset);
+		}
+		{
+			std::string data2 = data;
+			data2[300001] = 'y';
+			data2[data2.size() - 1] = 'y';
+			TempFile l1("A", data.c_str(), data.size());
+			TempFile r1("B", data2.c_str(), data2.size());
+			EXPECT_EQ(DIFFCODE::DIFF, bc.CompareFiles(files, di));
+			EXPECT_EQ(300001, di.firstDiffOffset);
+		}
+
+		files.SetLeft(_T("A"));
+		files.SetMiddle(_T("B"));
+		files.SetRight(_T("C"));
+		di.diffFileInfo[2].size = data.size();
+		{
+			std::string data1 = data, data2 = data;
+			data1[5000] = 'y';
+			data2[70] = 'y';
+			TempFile l1("A", data1.c_str(), data1.size());
+			TempFile m1("B", data.c_str(), data.size());
+			TempFile r1("C", data2.c_str(), data2.size());
+			EXPECT_EQ(DIFFCODE::DIFF, bc.CompareFiles(files, di));
+			EXPECT_EQ(70, di.firstDiffOffset);
+		}
+	}
+
 	TEST_F(BinaryCompareTest, Error)
 	{
 		CompareEngines::BinaryCompare bc;
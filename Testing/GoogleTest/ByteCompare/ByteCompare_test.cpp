@@ -43,7 +43,7 @@ namespace
 		}
 
 		FileLocation location[2];
-		file_data filedata[2];
+		file_data filedata[2] = {};
 	};
 
 	// The fixture for testing paths functions.
@@ -463,6 +463,53 @@ namespace
 		}
 	}
 
+	TEST_F(ByteCompareTest, AllOptionCombinations)
+	{
+		// Long identical runs are skipped by the vectorized fast path, the
+		// differing byte is in the middle of a block
+		std::string filename_left  = "_tmp_.txt";
+		std::string filename_right = "_tmp_2.txt";
+		std::string text;
+		for (int i = 0; i < 2000; i++)
+			text += "testdata_" + std::to_string(i) + "\t01234567890123456789 0123456789012345678901234567890123456789\r\n";
+		std::string text2 = text;
+		text2[text2.size() - 37] = 'x';
+
+		for (int ws = WHITESPACE_COMPARE_ALL; ws <= WHITESPACE_IGNORE_ALL; ++ws)
+		{
+			for (int flags = 0; flags < 8; ++flags)
+			{
+				CompareEngines::ByteCompare bc;
+				QuickCompareOptions option;
+				option.m_ignoreWhitespace = static_cast<WhitespaceIgnoreChoices>(ws);
+				option.m_bIgnoreBlankLines = (flags & 1) != 0;
+				option.m_bIgnoreCase = (flags & 2) != 0;
+				option.m_bIgnoreEOLDifference = (flags & 4) != 0;
+				bc.SetCompareOptions(option);
+
+				{// same
+					TempFile file_left (filename_left,  text.c_str(), text.size());
+					TempFile file_right(filename_right, text.c_str(), text.size());
+
+					FilePair pair(filename_left, filename_right);
+					bc.SetFileData(2, pair.filedata);
+
+					EXPECT_EQ(DIFFCODE::TEXT|DIFFCODE::SAME, bc.CompareFiles(pair.location));
+				}
+
+				{// diff
+					TempFile file_left (filename_left,  text.c_str(), text.size());
+					TempFile file_right(filename_right, text2.c_str(), text2.size());
+
+					FilePair pair(filename_left, filename_right);
+					bc.SetFileData(2, pair.filedata);
+
+					EXPECT_EQ(DIFFCODE::TEXT|DIFFCODE::DIFF, bc.CompareFiles(pair.location));
+				}
+			}
+		}
+	}
+
 	TEST_F(ByteCompareTest, CompareAppendedFile)
 	{
 		CompareEngines::ByteCompare bc;
@@ -539,4 +586,53 @@ namespace
 
 	}
 
+	TEST_F(ByteCompareTest, PreloadedFiles)
+	{
+		// Files already read to the diffutils buffers give the same results
+		CompareEngines::ByteCompare bc;
+		QuickCompareOptions option;
+		option.m_bIgnoreEOLDifference = true;
+		bc.SetCompareOptions(option);
+		std::string filename_left  = "_tmp_.txt";
+		std::string filename_right = "_tmp_2.txt";
+		std::string data_left(WMCMPBUFF * 3 + 1, 'A');
+		for (size_t i = 0; i < data_left.size(); i += 77)
+			data_left[i] = (i % 2) ? '\n' : '\r';
+		std::string data_right(data_left);
+		data_right[WMCMPBUFF * 2 + 5] = 'B';
+
+		for (int i = 0; i < 2; ++i)
+		{
+			TempFile file_left (filename_left,  data_left.c_str(),  data_left.size());
+			TempFile file_right(filename_right, data_right.c_str(), data_right.size() - i);
+			FilePair pair(filename_left, filename_right);
+			bc.SetFileData(2, pair.filedata);
+			const int code = bc.CompareFiles(pair.location);
+			FileTextStats stats[2];
+			bc.GetTextStats(0, &stats[0]);
+			bc.GetTextStats(1, &stats[1]);
+
+			file_data filedata[2] = {};
+			filedata[0].buffer = const_cast<char *>(data_left.c_str());
+			filedata[0].buffered_chars = data_left.size();
+			filedata[1].buffer = const_cast<char *>(data_right.c_str());
+			filedata[1].buffered_chars = data_right.size() - i;
+			filedata[0].preloaded = filedata[1].preloaded = 1;
+			// Not read from, but must differ like for different files
+			filedata[0].desc = pair.filedata[0].desc;
+			filedata[1].desc = pair.filedata[1].desc;
+			bc.SetFileData(2, filedata);
+			EXPECT_EQ(code, bc.CompareFiles(pair.location));
+			FileTextStats preloadedStats[2];
+			bc.GetTextStats(0, &preloadedStats[0]);
+			bc.GetTextStats(1, &preloadedStats[1]);
+			for (int j = 0; j < 2; ++j)
+			{
+				EXPECT_EQ(stats[j].ncrs, preloadedStats[j].ncrs);
+				EXPECT_EQ(stats[j].nlfs, preloadedStats[j].nlfs);
+				EXPECT_EQ(stats[j].ncrlfs, preloadedStats[j].ncrlfs);
+			}
+		}
+	}
+
 }  // namespace
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "DeviceIoLimiter.h"
+#include "PathContext.h"
+#include "DiffItem.h"
+
+namespace
+{
+	TEST(DeviceIoLimiter, SameFolderIsOneDevice)
+	{
+		PathContext paths(_T("."), _T("."), _T("."));
+		DeviceIoLimiter limiter(paths, 1);
+		EXPECT_EQ(1, limiter.GetDeviceCount());
+		EXPECT_EQ(0, limiter.GetDeviceIndex(1));
+		EXPECT_EQ(0, limiter.GetDeviceIndex(2));
+		EXPECT_TRUE(limiter.IsLimited(0));
+	}
+
+	TEST(DeviceIoLimiter, AcquireFiles)
+	{
+		PathContext paths(_T("."), _T("."));
+		DeviceIoLimiter limiter(paths, 2);
+		DIFFITEM di;
+		di.diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH;
+		// Both sides are on the same device, one slot is taken per item
+		unsigned devices1 = limiter.Acquire(di);
+		unsigned devices2 = limiter.Acquire(di);
+		EXPECT_EQ(1u, devices1);
+		EXPECT_EQ(1u, devices2);
+		limiter.Release(devices1);
+		limiter.Release(devices2);
+	}
+
+	TEST(DeviceIoLimiter, DirectoriesAreNotLimited)
+	{
+		PathContext paths(_T("."), _T("."));
+		DeviceIoLimiter limiter(paths, 1);
+		DIFFITEM di;
+		di.diffcode.diffcode = DIFFCODE::DIR | DIFFCODE::BOTH;
+		EXPECT_EQ(0u, limiter.Acquire(di));
+	}
+
+	TEST(DeviceIoLimiter, NoLimit)
+	{
+		PathContext paths(_T("."), _T("."));
+		DeviceIoLimiter limiter(paths, -1);
+		EXPECT_FALSE(limiter.IsLimited(0));
+		DIFFITEM di;
+		di.diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH;
+		EXPECT_EQ(0u, limiter.Acquire(di));
+	}
+
+	TEST(DeviceIoLimiter, SlotsAreGivenBack)
+	{
+		PathContext paths(_T("."), _T("."));
+		DeviceIoLimiter limiter(paths, 1);
+		DIFFITEM di;
+		di.diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH;
+		{
+			DeviceIoSlots slots(&limiter, di);
+			slots.Acquire();
+			// Held already, the only slot is not waited for again
+			slots.Acquire();
+			EXPECT_TRUE(slots.IsHeld());
+			slots.Release();
+			EXPECT_FALSE(slots.IsHeld());
+			slots.Acquire();
+		}
+		// The slot was given back when going out of scope
+		unsigned devices = limiter.Acquire(di);
+		EXPECT_EQ(1u, devices);
+		limiter.Release(devices);
+	}
+
+	TEST(DeviceIoLimiter, SlotsWithoutLimiter)
+	{
+		DIFFITEM di;
+		di.diffcode.diffcode = DIFFCODE::FILE | DIFFCODE::BOTH;
+		DeviceIoSlots slots(nullptr, di);
+		slots.Acquire();
+		EXPECT_TRUE(slots.IsHeld());
+		slots.Release();
+		EXPECT_FALSE(slots.IsHeld());
+	}
+}
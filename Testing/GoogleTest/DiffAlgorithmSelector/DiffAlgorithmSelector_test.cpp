@@ -0,0 +1,98 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "diff.h"
+#include "DiffAlgorithmSelector.h"
+#include <cstring>
+#include <string>
+
+namespace
+{
+	using namespace DiffAlgorithmSelector;
+
+	InputShape MakeShape(int64_t lines, size_t sampledLines, size_t uniqueLines)
+	{
+		InputShape shape = {};
+		shape.lines[0] = shape.lines[1] = lines / 2;
+		shape.size[0] = shape.size[1] = lines / 2 * 40;
+		shape.sampledLines = sampledLines;
+		shape.uniqueLines = uniqueLines;
+		return shape;
+	}
+
+	/** @brief A file already read into @p text. */
+	file_data MakeFileData(int desc, std::string &text)
+	{
+		file_data inf;
+		memset(&inf, 0, sizeof(inf));
+		inf.desc = desc;
+		inf.stat.st_mode = S_IFREG;
+		inf.stat.st_size = text.length();
+		inf.buffer = &text[0];
+		inf.buffered_chars = text.length();
+		return inf;
+	}
+
+	TEST(DiffAlgorithmSelector, SmallFilesAreComparedExactly)
+	{
+		const Choice choice = Choose(MakeShape(1000, 1000, 10));
+		EXPECT_EQ(DIFF_ALGORITHM_DEFAULT, choice.algorithm);
+		EXPECT_TRUE(choice.bMinimal);
+		EXPECT_GT(choice.nHorizonLines, 0);
+	}
+
+	TEST(DiffAlgorithmSelector, LargeRepetitiveFilesUseHistogram)
+	{
+		const Choice choice = Choose(MakeShape(100000, 20000, 500));
+		EXPECT_EQ(DIFF_ALGORITHM_HISTOGRAM, choice.algorithm);
+		EXPECT_FALSE(choice.bMinimal);
+	}
+
+	TEST(DiffAlgorithmSelector, LargeUniqueFilesUseDiffutils)
+	{
+		const Choice choice = Choose(MakeShape(100000, 20000, 19000));
+		EXPECT_EQ(DIFF_ALGORITHM_DEFAULT, choice.algorithm);
+		EXPECT_FALSE(choice.bMinimal);
+		EXPECT_EQ(0, choice.nHorizonLines);
+	}
+
+	TEST(DiffAlgorithmSelector, FilesOver2GBUseDiffutils)
+	{
+		InputShape shape = MakeShape(100000000, 20000, 500);
+		shape.size[1] = 3LL * 1024 * 1024 * 1024;
+		EXPECT_EQ(DIFF_ALGORITHM_DEFAULT, Choose(shape).algorithm);
+	}
+
+	TEST(DiffAlgorithmSelector, SampleBuffers)
+	{
+		std::string text0, text1;
+		for (int i = 0; i < 100; ++i)
+		{
+			text0 += "same line\r\n";
+			text1 += "line " + std::to_string(i) + "\n";
+		}
+		file_data filevec[2] = { MakeFileData(3, text0), MakeFileData(4, text1) };
+		const InputShape shape = Sample(filevec);
+		EXPECT_EQ(static_cast<int64_t>(text0.length()), shape.size[0]);
+		EXPECT_EQ(100, shape.lines[0]);
+		EXPECT_EQ(100, shape.lines[1]);
+		EXPECT_EQ(200u, shape.sampledLines);
+		EXPECT_EQ(101u, shape.uniqueLines);
+	}
+
+	TEST(DiffAlgorithmSelector, SampleSameFile)
+	{
+		std::string text = "a\nb\na\n";
+		file_data filevec[2] = { MakeFileData(3, text), MakeFileData(3, text) };
+		const InputShape shape = Sample(filevec);
+		EXPECT_EQ(3, shape.lines[0]);
+		EXPECT_EQ(3, shape.lines[1]);
+		EXPECT_EQ(2u, shape.uniqueLines);
+	}
+
+	TEST(DiffAlgorithmSelector, GetName)
+	{
+		EXPECT_STREQ("default", GetName(DIFF_ALGORITHM_DEFAULT));
+		EXPECT_STREQ("histogram", GetName(DIFF_ALGORITHM_HISTOGRAM));
+		EXPECT_STREQ("auto", GetName(DIFF_ALGORITHM_AUTO));
+	}
+}
@@ -0,0 +1,106 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include "DiffItemList.h"
+
+namespace
+{
+	class DiffItemListTest : public testing::Test
+	{
+	protected:
+		static int CountItems(const DiffItemList& list)
+		{
+			int count = 0;
+			for (DIFFITEM *pos = list.GetFirstDiffPosition(); pos != nullptr; )
+			{
+				list.GetNextDiffPosition(pos);
+				++count;
+			}
+			return count;
+		}
+	};
+
+	TEST_F(DiffItemListTest, AddAndIterate)
+	{
+		DiffItemList list;
+		list.InitDiffItemList();
+		EXPECT_EQ(nullptr, list.GetFirstDiffPosition());
+
+		DIFFITEM *folder = list.AddNewDiff(nullptr);
+		DIFFITEM *file1 = list.AddNewDiff(folder);
+		DIFFITEM *file2 = list.AddNewDiff(folder);
+		DIFFITEM *file3 = list.AddNewDiff(nullptr);
+		EXPECT_EQ(-1, file1->nsdiffs);
+		EXPECT_EQ(nullptr, file1->GetFirstChild());
+
+		// Depth-first order
+		DIFFITEM *pos = list.GetFirstDiffPosition();
+		EXPECT_EQ(folder, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(file1, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(file2, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(file3, &list.GetNextDiffRefPosition(pos));
+		EXPECT_EQ(nullptr, pos);
+
+		// Siblings added one after another are next to each other
+		EXPECT_EQ(file1 + 1, file2);
+	}
+
+	TEST_F(DiffItemListTest, RemoveDiff)
+	{
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *folder = list.AddNewDiff(nullptr);
+		list.AddNewDiff(list.AddNewDiff(folder));
+		list.AddNewDiff(folder);
+		DIFFITEM *file = list.AddNewDiff(nullptr);
+		EXPECT_EQ(5, CountItems(list));
+
+		list.RemoveDiff(folder);
+		EXPECT_EQ(1, CountItems(list));
+		EXPECT_EQ(file, list.GetFirstDiffPosition());
+
+		// Removed items are reused as empty items
+		DIFFITEM *reused = list.AddNewDiff(file);
+		EXPECT_EQ(-1, reused->nsdiffs);
+		EXPECT_EQ(nullptr, reused->GetFirstChild());
+		EXPECT_EQ(file, reused->GetParentLink());
+		EXPECT_EQ(2, CountItems(list));
+	}
+
+	TEST_F(DiffItemListTest, RemoveChildren)
+	{
+		DiffItemList list;
+		list.InitDiffItemList();
+		DIFFITEM *folder = list.AddNewDiff(nullptr);
+		for (int i = 0; i < 3; ++i)
+			list.AddNewDiff(folder)->diffFileInfo[0].filename = PooledString(_T("file"));
+		list.RemoveChildren(folder);
+		EXPECT_FALSE(folder->HasChildren());
+		EXPECT_EQ(1, CountItems(list));
+		list.RemoveChildren(folder);
+		EXPECT_EQ(1, CountItems(list));
+	}
+
+	TEST_F(DiffItemListTest, ManySlabs)
+	{
+		DiffItemList list;
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			list.InitDiffItemList();
+			std::vector<DIFFITEM *> folders;
+			for (int i = 0; i < 100; ++i)
+			{
+				DIFFITEM *folder = list.AddNewDiff(nullptr);
+				folder->diffFileInfo[0].path = PooledString(_T("folder"));
+				folders.push_back(folder);
+				for (int j = 0; j < 50; ++j)
+					list.AddNewDiff(folder)->diffFileInfo[0].filename = PooledString(_T("a file name long enough to be allocated"));
+			}
+			EXPECT_EQ(100 * 51, CountItems(list));
+			for (size_t i = 0; i < folders.size(); i += 2)
+				list.RemoveDiff(folders[i]);
+			EXPECT_EQ(50 * 51, CountItems(list));
+			list.RemoveAll();
+		}
+	}
+}
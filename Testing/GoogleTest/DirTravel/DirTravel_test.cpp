@@ -0,0 +1,54 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <random>
+#include "DirTravel.h"
+
+namespace
+{
+	int sign(int value)
+	{
+		return (value > 0) - (value < 0);
+	}
+
+	DirListItem MakeItem(const String& name, bool casesensitive)
+	{
+		DirListItem ent;
+		ent.filename = PooledString(name);
+		ent.collationKey = MakeCollationKey(name, casesensitive);
+		return ent;
+	}
+
+	TEST(DirTravel, CollationKey)
+	{
+		EXPECT_EQ(String(_T("abc_[]z")), MakeCollationKey(_T("AbC_[]Z"), false));
+		EXPECT_EQ(String(_T("AbC_[]Z")), MakeCollationKey(_T("AbC_[]Z"), true));
+	}
+
+	TEST(DirTravel, CollationKeyOrderSameAsCollstr)
+	{
+		// Letters, characters between the upper and lower case ASCII
+		// letters and some non-ASCII letters
+		static const TCHAR chars[] = _T("aAbBzZ09_[^`{~. -")
+#ifdef _UNICODE
+			_T("äÄéÉıİ")
+#endif
+			;
+		std::mt19937 rng(1);
+		std::uniform_int_distribution<int> len(0, 4);
+		std::uniform_int_distribution<int> ch(0, static_cast<int>(sizeof(chars) / sizeof(chars[0])) - 2);
+		for (int i = 0; i < 20000; ++i)
+		{
+			String name1, name2;
+			for (int n = len(rng); n > 0; --n)
+				name1 += chars[ch(rng)];
+			for (int n = len(rng); n > 0; --n)
+				name2 += chars[ch(rng)];
+			for (bool casesensitive : { false, true })
+			{
+				ASSERT_EQ(sign(collstr(name1, name2, casesensitive)),
+					sign(collkey(MakeItem(name1, casesensitive), MakeItem(name2, casesensitive))))
+					<< "casesensitive=" << casesensitive;
+			}
+		}
+	}
+}
@@ -2,6 +2,8 @@
 #include <gtest/gtest.h>
 #include "codepage_detect.h"
 #include "charsets.h"
+#include <fstream>
+#include <iterator>
 
 namespace
 {
@@ -92,5 +94,50 @@ namespace
 		EXPECT_EQ(ucr::UTF8, enc.m_unicoding);
 	}
 
+	TEST_F(CodepageDetectTest, GuessCodepageEncodingFromBuffer)
+	{
+		// Same results as guessing from the file
+		static const TCHAR *files[] = {
+			_T("../../Data/Unicode/UCS-2LE/DiffItem.h"),
+			_T("../../Data/Unicode/UCS-2BE/DiffItem.h"),
+			_T("../../Data/Unicode/UTF-8/DiffItem.h"),
+			_T("../../Data/Unicode/UTF-8-NOBOM/DiffItem.h"),
+			_T("../../../Docs/Developers/readme-developers.html"),
+		};
+		for (const TCHAR *file : files)
+		{
+			std::ifstream istr(file, std::ios::in | std::ios::binary);
+			std::string data((std::istreambuf_iterator<char>(istr)), std::istreambuf_iterator<char>());
+			for (int guessEncodingType = 0; guessEncodingType < 2; ++guessEncodingType)
+			{
+				FileTextEncoding enc = GuessCodepageEncoding(file, guessEncodingType);
+				FileTextEncoding enc2 = GuessCodepageEncoding(file, data.c_str(), data.size(), guessEncodingType);
+				EXPECT_EQ(enc.m_codepage, enc2.m_codepage);
+				EXPECT_EQ(enc.m_bom, enc2.m_bom);
+				EXPECT_EQ(enc.m_unicoding, enc2.m_unicoding);
+			}
+		}
+	}
+
+	TEST_F(CodepageDetectTest, GuessCodepageEncodingLargeAsciiPrefix)
+	{
+		// UTF-8 found only after more than BufSize bytes of ASCII
+		std::string data;
+		while (data.size() <= static_cast<size_t>(2 * BufSize))
+			data += "ASCII only line\n";
+		data += "\xc3\xa4\n";
+		const String file = _T("large_ascii_prefix.txt");
+		{
+			std::ofstream ostr(file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			ostr.write(data.c_str(), data.size());
+		}
+		FileTextEncoding enc = GuessCodepageEncoding(file, 1);
+		EXPECT_EQ(65001, enc.m_codepage);
+		EXPECT_EQ(ucr::UTF8, enc.m_unicoding);
+		FileTextEncoding enc2 = GuessCodepageEncoding(file, data.c_str(), data.size(), 1);
+		EXPECT_EQ(65001, enc2.m_codepage);
+		EXPECT_EQ(ucr::UTF8, enc2.m_unicoding);
+		_tremove(file.c_str());
+	}
 
 }  // namespace
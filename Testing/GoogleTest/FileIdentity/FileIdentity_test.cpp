@@ -0,0 +1,80 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "FileIdentity.h"
+#include <fstream>
+#include <cstdio>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#define _open open
+#define _close close
+#define _O_RDONLY O_RDONLY
+#endif
+
+namespace
+{
+	struct TempFile
+	{
+		TempFile(const std::string& filename, const char *data, size_t len) : m_filename(filename)
+		{
+			std::ofstream ostr(filename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+			ostr.write(data, len);
+		}
+		~TempFile()
+		{
+			remove(m_filename.c_str());
+		}
+		std::string m_filename;
+	};
+
+	TEST(FileIdentity, SameFile)
+	{
+		TempFile a("FileIdentityA", "abc", 3);
+		EXPECT_EQ(FileIdentity::SAME_FILE, FileIdentity::Compare(_T("FileIdentityA"), _T("FileIdentityA")));
+	}
+
+	TEST(FileIdentity, HardLink)
+	{
+		TempFile a("FileIdentityA", "abc", 3);
+#ifdef _WIN32
+		ASSERT_TRUE(CreateHardLinkA("FileIdentityB", "FileIdentityA", nullptr));
+#else
+		ASSERT_EQ(0, link("FileIdentityA", "FileIdentityB"));
+#endif
+		EXPECT_EQ(FileIdentity::SAME_FILE, FileIdentity::Compare(_T("FileIdentityA"), _T("FileIdentityB")));
+		remove("FileIdentityB");
+	}
+
+	TEST(FileIdentity, CopiedFile)
+	{
+		// Copies with the same contents must still be read to compare them
+		TempFile a("FileIdentityA", "abc", 3);
+		TempFile b("FileIdentityB", "abc", 3);
+		EXPECT_EQ(FileIdentity::UNKNOWN, FileIdentity::Compare(_T("FileIdentityA"), _T("FileIdentityB")));
+	}
+
+	TEST(FileIdentity, OpenedFiles)
+	{
+		TempFile a("FileIdentityA", "abc", 3);
+		TempFile b("FileIdentityB", "abc", 3);
+		int fd1 = _open("FileIdentityA", _O_RDONLY);
+		int fd2 = _open("FileIdentityA", _O_RDONLY);
+		int fd3 = _open("FileIdentityB", _O_RDONLY);
+		EXPECT_EQ(FileIdentity::SAME_FILE, FileIdentity::Compare(fd1, fd2));
+		EXPECT_EQ(FileIdentity::UNKNOWN, FileIdentity::Compare(fd1, fd3));
+		EXPECT_EQ(FileIdentity::UNKNOWN, FileIdentity::Compare(fd1, -1));
+		_close(fd1);
+		_close(fd2);
+		_close(fd3);
+	}
+
+	TEST(FileIdentity, MissingFile)
+	{
+		TempFile a("FileIdentityA", "abc", 3);
+		EXPECT_EQ(FileIdentity::UNKNOWN, FileIdentity::Compare(_T("FileIdentityA"), _T("FileIdentityMissing")));
+		EXPECT_EQ(FileIdentity::UNKNOWN, FileIdentity::Compare(_T("FileIdentityMissing"), _T("FileIdentityMissing")));
+	}
+}
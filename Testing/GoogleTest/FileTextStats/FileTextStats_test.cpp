@@ -0,0 +1,116 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "FileTextStats.h"
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace
+{
+	/**
+	 * @brief The byte-by-byte counting the vectorized scan replaced.
+	 */
+	bool ReferenceScan(const char *data, size_t size, bool bPendingCR, FileTextStats &stats)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			const char c = data[i];
+			if (bPendingCR)
+			{
+				bPendingCR = false;
+				if (c == '\n')
+				{
+					++stats.ncrlfs;
+					continue;
+				}
+				++stats.ncrs;
+			}
+			if (c == '\r')
+				bPendingCR = true;
+			else if (c == '\n')
+				++stats.nlfs;
+			else if (c == 0)
+				++stats.nzeros;
+		}
+		return bPendingCR;
+	}
+
+	void ExpectEqualStats(const FileTextStats &expected, const FileTextStats &actual)
+	{
+		EXPECT_EQ(expected.ncrs, actual.ncrs);
+		EXPECT_EQ(expected.nlfs, actual.nlfs);
+		EXPECT_EQ(expected.ncrlfs, actual.ncrlfs);
+		EXPECT_EQ(expected.nzeros, actual.nzeros);
+	}
+
+	TEST(FileTextStats, Simple)
+	{
+		const char data[] = "a\r\nb\nc\rd\0e\r\n\n\r\r";
+		FileTextStats stats;
+		EXPECT_TRUE(stats.Scan(data, sizeof(data) - 1, false));
+		EXPECT_EQ(2, stats.ncrs);
+		EXPECT_EQ(2, stats.nlfs);
+		EXPECT_EQ(2, stats.ncrlfs);
+		EXPECT_EQ(1, stats.nzeros);
+	}
+
+	TEST(FileTextStats, CRLFSplitAcrossBuffers)
+	{
+		// CR+LF split at every offset, also inside and at the end of vector blocks
+		for (size_t pos = 0; pos < 100; ++pos)
+		{
+			std::string data(150, 'x');
+			data[pos] = '\r';
+			data[pos + 1] = '\n';
+			FileTextStats stats;
+			bool bPendingCR = stats.Scan(data.c_str(), pos + 1, false);
+			EXPECT_TRUE(bPendingCR);
+			EXPECT_FALSE(stats.Scan(data.c_str() + pos + 1, data.size() - pos - 1, bPendingCR));
+			EXPECT_EQ(0, stats.ncrs);
+			EXPECT_EQ(0, stats.nlfs);
+			EXPECT_EQ(1, stats.ncrlfs);
+		}
+	}
+
+	TEST(FileTextStats, PendingCR)
+	{
+		FileTextStats stats;
+		// CR followed by an empty buffer is still pending
+		EXPECT_TRUE(stats.Scan("\r", 1, false));
+		EXPECT_TRUE(stats.Scan("", 0, true));
+		// CR not followed by LF
+		EXPECT_FALSE(stats.Scan("a", 1, true));
+		EXPECT_EQ(1, stats.ncrs);
+		EXPECT_EQ(0, stats.ncrlfs);
+	}
+
+	TEST(FileTextStats, SameAsReference)
+	{
+		std::mt19937 rng(12345);
+		const char chars[] = { '\r', '\n', '\0', 'a', ' ' };
+		for (int test = 0; test < 2000; ++test)
+		{
+			std::string data(rng() % 5000, 'a');
+			const unsigned density = 1 + rng() % 40;
+			for (auto& c : data)
+			{
+				if (rng() % density == 0)
+					c = chars[rng() % sizeof(chars)];
+			}
+
+			// Scan in randomly sized buffers
+			FileTextStats expected, actual;
+			bool bPendingExpected = false, bPendingActual = false;
+			size_t pos = 0;
+			while (pos < data.size())
+			{
+				size_t size = (std::min)(static_cast<size_t>(rng() % 1000), data.size() - pos);
+				bPendingExpected = ReferenceScan(data.c_str() + pos, size, bPendingExpected, expected);
+				bPendingActual = actual.Scan(data.c_str() + pos, size, bPendingActual);
+				ASSERT_EQ(bPendingExpected, bPendingActual);
+				pos += size;
+			}
+			ExpectEqualStats(expected, actual);
+		}
+	}
+}
@@ -0,0 +1,154 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "DiffContext.h"
+#include "PathContext.h"
+#include "CompareEngines/HashCompare.h"
+#include <fstream>
+
+namespace
+{
+	struct TempFile
+	{
+		TempFile(const std::string& filename, const char *data, size_t len) : m_filename(filename)
+		{
+			std::ofstream ostr(filename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+			ostr.write(data, len);
+		}
+		~TempFile()
+		{
+			remove(m_filename.c_str());
+		}
+		std::string m_filename;
+	};
+
+	class HashCompareTest : public testing::Test
+	{
+	protected:
+		void SetExisting(DIFFITEM &di, int nFiles, int size)
+		{
+			di.diffcode.diffcode = DIFFCODE::FILE;
+			for (int i = 0; i < nFiles; ++i)
+			{
+				di.diffcode.diffcode |= (DIFFCODE::FIRST << i);
+				di.diffFileInfo[i].size = size;
+			}
+		}
+	};
+
+	TEST_F(HashCompareTest, MurmurHash3)
+	{
+		// Reference values of MurmurHash3_x64_128 with seed 0
+		CompareEngines::HashCompare hc;
+		uint64_t hash[2];
+		{
+			const char text[] = "The quick brown fox jumps over the lazy dog";
+			TempFile f("A", text, sizeof(text) - 1);
+			EXPECT_TRUE(hc.HashFile(_T("A"), hash));
+			EXPECT_EQ(0xe34bbc7bbc071b6cULL, hash[0]);
+			EXPECT_EQ(0x7a433ca9c49a9347ULL, hash[1]);
+		}
+		{
+			TempFile f("A", "hello", 5);
+			EXPECT_TRUE(hc.HashFile(_T("A"), hash));
+			EXPECT_EQ(0xcbd8a7b341bd9b02ULL, hash[0]);
+			EXPECT_EQ(0x5b1e906a48ae1d19ULL, hash[1]);
+		}
+		EXPECT_FALSE(hc.HashFile(_T("nonexistent_file"), hash));
+	}
+
+	TEST_F(HashCompareTest, LargeFile)
+	{
+		// Bigger than the read buffer and not a multiple of the block size
+		CompareEngines::HashCompare hc;
+		DIFFITEM di;
+		PathContext files;
+		std::string data(1024 * 1024 + 7, 'x');
+		TempFile l1("A", data.c_str(), data.size());
+		data[data.size() - 1] = 'y';
+		TempFile r1("B", data.c_str(), data.size());
+		files.SetLeft(_T("A"));
+		files.SetRight(_T("B"));
+		SetExisting(di, 2, static_cast<int>(data.size()));
+		EXPECT_EQ(DIFFCODE::DIFF, hc.CompareFiles(files, di));
+		EXPECT_TRUE(di.diffFileInfo[0].HasContentHash());
+		EXPECT_TRUE(di.diffFileInfo[1].HasContentHash());
+	}
+
+	TEST_F(HashCompareTest, TwoWay)
+	{
+		CompareEngines::HashCompare hc;
+		DIFFITEM di;
+		PathContext files;
+
+		{
+			TempFile l1("A", "1", 1);
+			TempFile r1("B", "1", 1);
+			files.SetLeft(_T("A"));
+			files.SetRight(_T("B"));
+			SetExisting(di, 2, 1);
+			EXPECT_EQ(DIFFCODE::SAME, hc.CompareFiles(files, di));
+			EXPECT_EQ(0, memcmp(di.diffFileInfo[0].GetDetails().m_contentHash, di.diffFileInfo[1].GetDetails().m_contentHash, sizeof(DiffFileDetails::m_contentHash)));
+		}
+
+		{
+			TempFile l1("A", "1", 1);
+			TempFile r1("B", "2", 1);
+			files.SetLeft(_T("A"));
+			files.SetRight(_T("B"));
+			SetExisting(di, 2, 1);
+			EXPECT_EQ(DIFFCODE::DIFF, hc.CompareFiles(files, di));
+		}
+
+		{
+			TempFile l1("A", "1", 1);
+			files.SetLeft(_T("A"));
+			files.SetRight(_T("B"));
+			SetExisting(di, 1, 1);
+			di.diffFileInfo[1].ClearPartial();
+			EXPECT_EQ(DIFFCODE::DIFF, hc.CompareFiles(files, di));
+			EXPECT_TRUE(di.diffFileInfo[0].HasContentHash());
+			EXPECT_FALSE(di.diffFileInfo[1].HasContentHash());
+		}
+	}
+
+	TEST_F(HashCompareTest, SameFile)
+	{
+		// The second path is recognized as the file read already
+		CompareEngines::HashCompare hc;
+		DIFFITEM di;
+		PathContext files;
+		TempFile l1("A", "hello", 5);
+		files.SetLeft(_T("A"));
+		files.SetRight(_T("A"));
+		SetExisting(di, 2, 5);
+		EXPECT_EQ(DIFFCODE::SAME, hc.CompareFiles(files, di));
+		EXPECT_EQ(0xcbd8a7b341bd9b02ULL, di.diffFileInfo[1].GetDetails().m_contentHash[0]);
+		EXPECT_EQ(0x5b1e906a48ae1d19ULL, di.diffFileInfo[1].GetDetails().m_contentHash[1]);
+	}
+
+	TEST_F(HashCompareTest, ThreeWay)
+	{
+		CompareEngines::HashCompare hc;
+		DIFFITEM di;
+		PathContext files;
+		files.SetLeft(_T("A"));
+		files.SetMiddle(_T("B"));
+		files.SetRight(_T("C"));
+
+		static const struct { const char *data[3]; unsigned code; } tests[] = {
+			{ { "1", "1", "1" }, DIFFCODE::SAME },
+			{ { "1", "1", "2" }, DIFFCODE::DIFF | DIFFCODE::DIFF3RDONLY },
+			{ { "1", "2", "1" }, DIFFCODE::DIFF | DIFFCODE::DIFF2NDONLY },
+			{ { "2", "1", "1" }, DIFFCODE::DIFF | DIFFCODE::DIFF1STONLY },
+			{ { "1", "2", "3" }, DIFFCODE::DIFF },
+		};
+		for (const auto& test : tests)
+		{
+			TempFile l1("A", test.data[0], 1);
+			TempFile m1("B", test.data[1], 1);
+			TempFile r1("C", test.data[2], 1);
+			SetExisting(di, 3, 1);
+			EXPECT_EQ(test.code, static_cast<unsigned>(hc.CompareFiles(files, di)));
+		}
+	}
+}
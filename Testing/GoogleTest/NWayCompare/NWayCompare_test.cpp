@@ -0,0 +1,110 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "CompareEngines/NWayCompare.h"
+#include <fstream>
+#include <cstring>
+
+namespace
+{
+	struct TempFile
+	{
+		TempFile(const std::string& filename, const std::string& data) : m_filename(filename)
+		{
+			std::ofstream ostr(filename.c_str(), std::ios::out|std::ios::binary|std::ios::trunc);
+			ostr.write(data.c_str(), data.size());
+		}
+		~TempFile()
+		{
+			remove(m_filename.c_str());
+		}
+		std::string m_filename;
+	};
+
+	const String files[3] = { _T("A"), _T("B"), _T("C") };
+
+	TEST(NWayCompare, Classes)
+	{
+		static const struct { const char *data[3]; bool same10, same12, same02; } tests[] = {
+			{ { "1", "1", "1" }, true, true, true },
+			{ { "1", "1", "2" }, true, false, false },
+			{ { "1", "2", "1" }, false, false, true },
+			{ { "2", "1", "1" }, false, true, false },
+			{ { "1", "2", "3" }, false, false, false },
+			{ { "1", "12", "1" }, false, false, true },
+			{ { "", "", "" }, true, true, true },
+		};
+		CompareEngines::NWayCompare nc;
+		for (const auto& test : tests)
+		{
+			TempFile a("A", test.data[0]);
+			TempFile b("B", test.data[1]);
+			TempFile c("C", test.data[2]);
+			EXPECT_TRUE(nc.CompareFiles(files, 3));
+			EXPECT_EQ(test.same10, nc.IsIdentical(1, 0));
+			EXPECT_EQ(test.same12, nc.IsIdentical(1, 2));
+			EXPECT_EQ(test.same02, nc.IsIdentical(0, 2));
+			EXPECT_EQ(test.same10 && test.same12, nc.IsAllIdentical());
+		}
+	}
+
+	TEST(NWayCompare, LargeFiles)
+	{
+		// Bigger than the read buffer, differing only in the last byte
+		std::string data(1024 * 1024 + 7, 'x');
+		TempFile a("A", data);
+		TempFile b("B", data);
+		data[data.size() - 1] = 'y';
+		TempFile c("C", data);
+		CompareEngines::NWayCompare nc;
+		EXPECT_TRUE(nc.CompareFiles(files, 3));
+		EXPECT_TRUE(nc.IsIdentical(0, 1));
+		EXPECT_FALSE(nc.IsIdentical(1, 2));
+		EXPECT_FALSE(nc.IsAllIdentical());
+	}
+
+	TEST(NWayCompare, TextStats)
+	{
+		std::string data(1024 * 256 - 1, 'x');
+		data += "\r\nx\ry\n";
+		data += '\0';
+		TempFile a("A", data);
+		TempFile b("B", data);
+		TempFile c("C", data);
+		CompareEngines::NWayCompare nc;
+		EXPECT_TRUE(nc.CompareFiles(files, 3));
+		EXPECT_TRUE(nc.IsAllIdentical());
+		for (int i = 0; i < 3; ++i)
+		{
+			EXPECT_EQ(1, nc.GetTextStats(i).ncrlfs);
+			EXPECT_EQ(1, nc.GetTextStats(i).ncrs);
+			EXPECT_EQ(1, nc.GetTextStats(i).nlfs);
+			EXPECT_EQ(1, nc.GetTextStats(i).nzeros);
+		}
+	}
+
+	TEST(NWayCompare, KeepsData)
+	{
+		TempFile a("A", "1\n");
+		TempFile b("B", "22\n");
+		TempFile c("C", "");
+		CompareEngines::NWayCompare nc;
+		EXPECT_TRUE(nc.CompareFiles(files, 3));
+		ASSERT_EQ(2u, nc.GetDataSize(0));
+		EXPECT_EQ(0, memcmp(nc.GetData(0), "1\n", 2));
+		ASSERT_EQ(3u, nc.GetDataSize(1));
+		EXPECT_EQ(0, memcmp(nc.GetData(1), "22\n", 3));
+		EXPECT_EQ(0u, nc.GetDataSize(2));
+		nc.ClearData();
+		EXPECT_EQ(0u, nc.GetDataSize(0));
+		EXPECT_EQ(1, nc.GetTextStats(0).nlfs);
+		EXPECT_FALSE(nc.IsIdentical(0, 1));
+	}
+
+	TEST(NWayCompare, MissingFile)
+	{
+		TempFile a("A", "1");
+		TempFile b("B", "1");
+		CompareEngines::NWayCompare nc;
+		EXPECT_FALSE(nc.CompareFiles(files, 3));
+	}
+}
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include <Poco/Thread.h>
+#include <Poco/Runnable.h>
+#include "StringPool.h"
+
+namespace
+{
+	TEST(StringPool, Intern)
+	{
+		StringPool pool;
+		PooledString a = pool.Intern(_T("abc"));
+		PooledString b = pool.Intern(String(_T("ab")) + _T("c"));
+		PooledString c = pool.Intern(_T("abd"));
+		EXPECT_EQ(String(_T("abc")), a.get());
+		EXPECT_EQ(&a.get(), &b.get());
+		EXPECT_TRUE(a == b);
+		EXPECT_FALSE(a == c);
+		EXPECT_TRUE(a != c);
+		EXPECT_TRUE(a == _T("abc"));
+		EXPECT_TRUE(a == String(_T("abc")));
+		EXPECT_TRUE(a < c);
+	}
+
+	TEST(StringPool, Empty)
+	{
+		StringPool pool;
+		PooledString empty;
+		EXPECT_TRUE(empty.get().empty());
+		EXPECT_EQ(&empty.get(), &pool.Intern(_T("")).get());
+	}
+
+	TEST(StringPool, DefaultPool)
+	{
+		StringPool pool;
+		PooledString a = pool.Intern(_T("name"));
+		PooledString b(_T("name"));
+		PooledString c(String(_T("name")));
+		// Equal strings of different pools are equal
+		EXPECT_NE(&a.get(), &b.get());
+		EXPECT_TRUE(a == b);
+		EXPECT_EQ(&b.get(), &c.get());
+	}
+
+	TEST(StringPool, ManyStrings)
+	{
+		StringPool pool;
+		std::vector<PooledString> strings;
+		for (int i = 0; i < 100000; ++i)
+			strings.push_back(pool.Intern(strutils::to_str(i)));
+		for (int i = 0; i < 100000; ++i)
+		{
+			PooledString s = pool.Intern(strutils::to_str(i));
+			ASSERT_EQ(&strings[i].get(), &s.get());
+			ASSERT_EQ(strutils::to_str(i), s.get());
+		}
+	}
+
+	class Interner : public Poco::Runnable
+	{
+	public:
+		explicit Interner(StringPool &pool) : m_pool(pool) {}
+		void run()
+		{
+			for (int i = 0; i < 20000; ++i)
+				m_strings.push_back(m_pool.Intern(strutils::to_str(i)));
+		}
+		StringPool &m_pool;
+		std::vector<PooledString> m_strings;
+	};
+
+	TEST(StringPool, Threads)
+	{
+		StringPool pool;
+		Interner interner1(pool), interner2(pool);
+		Poco::Thread thread1, thread2;
+		thread1.start(interner1);
+		thread2.start(interner2);
+		thread1.join();
+		thread2.join();
+		for (int i = 0; i < 20000; ++i)
+			ASSERT_EQ(&interner1.m_strings[i].get(), &interner2.m_strings[i].get());
+	}
+}
@@ -0,0 +1,234 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "LineHash.h"
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace
+{
+	inline unsigned ReferenceHash(unsigned h, unsigned char c)
+	{
+		return c + (h << 7 | h >> (sizeof(unsigned) * 8 - 7));
+	}
+
+	inline bool IsWhitespace(unsigned char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline unsigned char Fold(unsigned char c, bool bIgnoreCase)
+	{
+		return bIgnoreCase && isupper(c) ? static_cast<unsigned char>(tolower(c)) : c;
+	}
+
+	/**
+	 * @brief The former byte loops of find_and_hash_each_line().
+	 * @return Start of the next line.
+	 */
+	const unsigned char *ReferenceHashLine(const unsigned char *p, int flags, unsigned &h)
+	{
+		const bool bIgnoreCase = (flags & LINEHASH_IGNORE_CASE) != 0;
+		unsigned char c;
+		h = 0;
+		if (flags & LINEHASH_IGNORE_ALL_SPACE)
+		{
+			while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+			{
+				if (!IsWhitespace(c))
+					h = ReferenceHash(h, Fold(c, bIgnoreCase));
+			}
+		}
+		else if (flags & LINEHASH_IGNORE_SPACE_CHANGE)
+		{
+			while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+			{
+				if (IsWhitespace(c))
+				{
+					while (IsWhitespace(c = *p++))
+						;
+					if (c == '\n')
+						return p;
+					else if (c != '\r')
+						h = ReferenceHash(h, ' ');
+				}
+				h = ReferenceHash(h, Fold(c, bIgnoreCase));
+				if (c == '\r' && *p != '\n')
+					return p;
+			}
+		}
+		else
+		{
+			while ((c = *p++) != '\n' && (c != '\r' || *p == '\n'))
+				h = ReferenceHash(h, Fold(c, bIgnoreCase));
+		}
+		return p;
+	}
+
+	/** @brief Random text ending with a LF, like prepare_text_end() leaves it. */
+	std::string MakeText(std::mt19937 &rng, size_t size, const char *chars)
+	{
+		const size_t nchars = strlen(chars);
+		std::uniform_int_distribution<size_t> ch(0, nchars - 1);
+		std::string text;
+		for (size_t i = 0; i < size; ++i)
+			text += chars[ch(rng)];
+		text += '\n';
+		return text;
+	}
+
+	const unsigned char *Bytes(const std::string &text)
+	{
+		return reinterpret_cast<const unsigned char *>(text.c_str());
+	}
+
+	TEST(LineHash, FindLineEnd)
+	{
+		std::string text = "a\nbc\r\nd\re\r\r\n\n";
+		const unsigned char *p = Bytes(text);
+		const unsigned char *end = p + text.length();
+		EXPECT_EQ(p + 1, FindLineEnd(p, end));
+		EXPECT_EQ(p + 5, FindLineEnd(p + 2, end));
+		EXPECT_EQ(p + 7, FindLineEnd(p + 6, end));
+		EXPECT_EQ(p + 9, FindLineEnd(p + 8, end));
+		EXPECT_EQ(p + 11, FindLineEnd(p + 10, end));
+		EXPECT_EQ(p + 12, FindLineEnd(p + 12, end));
+		// CR at the end of the buffer ends the line
+		text = std::string(40, 'x') + "\r";
+		EXPECT_EQ(Bytes(text) + 40, FindLineEnd(Bytes(text), Bytes(text) + text.length()));
+	}
+
+	TEST(LineHash, CountLines)
+	{
+		std::mt19937 rng(2);
+		for (int iteration = 0; iteration < 200; ++iteration)
+		{
+			const std::string text = MakeText(rng, iteration * 7, "ab\r\r\n\n");
+			const unsigned char *end = Bytes(text) + text.length();
+			for (size_t start = 0; start < 20 && start < text.length(); ++start)
+			{
+				// Count from every line start up to the end
+				const unsigned char *p = Bytes(text) + start;
+				if (start > 0 && p[-1] != '\n' && (p[-1] != '\r' || *p == '\n'))
+					continue;
+				size_t count = 0;
+				for (const unsigned char *q = p; q < end; q = FindLineEnd(q, end) + 1)
+					++count;
+				ASSERT_EQ(count, CountLines(p, end)) << "iteration=" << iteration << " start=" << start;
+			}
+		}
+		// CR+LF split between two blocks of 16 bytes
+		const std::string text = std::string(15, 'x') + "\r\n" + std::string(14, 'y') + "\r\r\n";
+		EXPECT_EQ(3u, CountLines(Bytes(text), Bytes(text) + text.length()));
+		EXPECT_EQ(0u, CountLines(Bytes(text), Bytes(text)));
+	}
+
+	TEST(LineHash, SameLinesAndHashesAsReference)
+	{
+		std::mt19937 rng(1);
+		unsigned char fold[256];
+		MakeCaseFoldTable(fold);
+		for (int iteration = 0; iteration < 200; ++iteration)
+		{
+			const std::string text = MakeText(rng, 2000, "aAbZ  \t\t\r\n\n\r\n.x");
+			const unsigned char *end = Bytes(text) + text.length();
+			for (int flags = 0; flags < 8; ++flags)
+			{
+				LineHashFunc hash = GetLineHashFunc(flags);
+				const unsigned char *p = Bytes(text);
+				while (p < end)
+				{
+					unsigned hReference;
+					const unsigned char *next = ReferenceHashLine(p, flags, hReference);
+					const unsigned char *eol = FindLineEnd(p, end);
+					ASSERT_EQ(next, eol + 1) << "flags=" << flags << " offset=" << (p - Bytes(text));
+					const unsigned h = hash(p, eol, fold);
+					// Lines compared exactly are hashed differently
+					if (flags != 0)
+					{
+						ASSERT_EQ(hReference, h) << "flags=" << flags << " offset=" << (p - Bytes(text));
+					}
+					p = next;
+				}
+			}
+		}
+	}
+
+	TEST(LineHash, SameBytesSameHash)
+	{
+		LineHashFunc hash = GetLineHashFunc(0);
+		const std::string line1 = "\tint value = GetValue(index);";
+		const std::string line2 = "x" + line1;
+		EXPECT_EQ(hash(Bytes(line1), Bytes(line1) + line1.length(), nullptr),
+			hash(Bytes(line2) + 1, Bytes(line2) + line2.length(), nullptr));
+		// Lines differing only in trailing zero bytes
+		const std::string zeros("ab\0\0", 4);
+		EXPECT_NE(hash(Bytes(zeros), Bytes(zeros) + 2, nullptr), hash(Bytes(zeros), Bytes(zeros) + 4, nullptr));
+	}
+
+	/** @brief Throughput in MB/s of hashing all lines of @p text. */
+	template <typename Func>
+	double MeasureThroughput(const std::string &text, Func func)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		func();
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		return text.length() / 1e6 / elapsed.count();
+	}
+
+	void Benchmark(const char *name, const std::string &text)
+	{
+		const unsigned char *end = Bytes(text) + text.length();
+		unsigned char fold[256];
+		MakeCaseFoldTable(fold);
+		for (int flags : { 0, int(LINEHASH_IGNORE_CASE), int(LINEHASH_IGNORE_SPACE_CHANGE), int(LINEHASH_IGNORE_ALL_SPACE) })
+		{
+			unsigned sum = 0, sumReference = 0;
+			LineHashFunc hash = GetLineHashFunc(flags);
+			const double mbps = MeasureThroughput(text, [&]() {
+				for (const unsigned char *p = Bytes(text); p < end; )
+				{
+					const unsigned char *eol = FindLineEnd(p, end);
+					sum += hash(p, eol, fold);
+					p = eol + 1;
+				}
+			});
+			const double mbpsReference = MeasureThroughput(text, [&]() {
+				for (const unsigned char *p = Bytes(text); p < end; )
+				{
+					unsigned h;
+					p = ReferenceHashLine(p, flags, h);
+					sumReference += h;
+				}
+			});
+			if (flags != 0)
+			{
+				EXPECT_EQ(sumReference, sum);
+			}
+			printf("%s, flags=%d: %.0f MB/s, byte loop reference: %.0f MB/s\n", name, flags, mbps, mbpsReference);
+		}
+	}
+
+	// Run with --gtest_also_run_disabled_tests
+	TEST(LineHash, DISABLED_Benchmark)
+	{
+		const size_t size = 100 * 1024 * 1024;
+		std::string source;
+		source.reserve(size + 256);
+		while (source.length() < size)
+			source += "\tint value = GetValue(index); // Get the value\r\n"
+				"\tif (value < 0)\r\n\t\treturn false;\r\n\r\n"
+				"\tfor (size_t i = 0; i < items.size(); ++i)\r\n\t\tTotal += items[i].Count;\r\n";
+		Benchmark("Source", source);
+
+		std::string log;
+		log.reserve(size + 256);
+		while (log.length() < size)
+			log += "2024-03-18 12:34:56.789 INFO  [worker-3] Request GET /api/v1/items?page=2 completed in 15 ms\n"
+				"2024-03-18 12:34:56.801 WARN  [worker-1] Slow response from upstream host 10.0.0.12:8080 (512 ms)\n";
+		Benchmark("Log", log);
+	}
+}
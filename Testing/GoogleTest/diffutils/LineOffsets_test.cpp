@@ -0,0 +1,94 @@
+#include "pch.h"
+#include <gtest/gtest.h>
+#include "LineOffsets.h"
+#include <climits>
+#include <cstdint>
+
+namespace
+{
+	class LineOffsetsTest : public testing::Test
+	{
+	protected:
+		void SetUp() override
+		{
+			m_offsets.lo = nullptr;
+			m_offsets.hi = nullptr;
+			m_base = 0;
+		}
+
+		void TearDown() override
+		{
+			FreeLineOffsets(&m_offsets, m_base);
+		}
+
+		struct line_offsets m_offsets;
+		int m_base;
+	};
+
+	TEST_F(LineOffsetsTest, Fit)
+	{
+		EXPECT_TRUE(LineOffsetsFit(0));
+		EXPECT_TRUE(LineOffsetsFit(UINT_MAX));
+#if SIZE_MAX > UINT_MAX
+		EXPECT_TRUE(LineOffsetsFit(static_cast<size_t>(UINT_MAX) + 1));
+		EXPECT_TRUE(LineOffsetsFit(((static_cast<size_t>(UCHAR_MAX) + 1) << 16 << 16) - 1));
+		EXPECT_FALSE(LineOffsetsFit((static_cast<size_t>(UCHAR_MAX) + 1) << 16 << 16));
+#endif
+	}
+
+	TEST_F(LineOffsetsTest, Narrow)
+	{
+		ASSERT_TRUE(ReallocLineOffsets(&m_offsets, m_base, 3, UINT_MAX));
+		EXPECT_EQ(nullptr, m_offsets.hi);
+		SetLineOffset(&m_offsets, 0, 0);
+		SetLineOffset(&m_offsets, 1, 100);
+		SetLineOffset(&m_offsets, 2, UINT_MAX);
+		EXPECT_EQ(0u, LINE_OFFSET(m_offsets, 0));
+		EXPECT_EQ(100u, LINE_OFFSET(m_offsets, 1));
+		EXPECT_EQ(static_cast<size_t>(UINT_MAX), LINE_OFFSET(m_offsets, 2));
+	}
+
+	TEST_F(LineOffsetsTest, GrowFromNegativeBase)
+	{
+		m_base = -2;
+		ASSERT_TRUE(ReallocLineOffsets(&m_offsets, m_base, 4, 1000));
+		for (int i = m_base; i < 2; i++)
+			SetLineOffset(&m_offsets, i, 10 * (i - m_base));
+		ASSERT_TRUE(ReallocLineOffsets(&m_offsets, m_base, 1000, 1000));
+		for (int i = 2; i < 1000 + m_base; i++)
+			SetLineOffset(&m_offsets, i, 10 * (i - m_base));
+		for (int i = m_base; i < 1000 + m_base; i++)
+			EXPECT_EQ(static_cast<size_t>(10 * (i - m_base)), LINE_OFFSET(m_offsets, i));
+	}
+
+#if SIZE_MAX > UINT_MAX
+	TEST_F(LineOffsetsTest, Over4GB)
+	{
+		const size_t GB = static_cast<size_t>(1) << 30;
+		const size_t offsets[] = { 0, 4 * GB - 1, 4 * GB, 5 * GB + 3, 6 * GB };
+		const int count = sizeof(offsets) / sizeof(offsets[0]);
+		ASSERT_TRUE(ReallocLineOffsets(&m_offsets, m_base, count, 6 * GB));
+		EXPECT_NE(nullptr, m_offsets.hi);
+		for (int i = 0; i < count; i++)
+			SetLineOffset(&m_offsets, i, offsets[i]);
+		for (int i = 0; i < count; i++)
+			EXPECT_EQ(offsets[i], LINE_OFFSET(m_offsets, i));
+	}
+
+	TEST_F(LineOffsetsTest, WidenWhenGrowingPast4GB)
+	{
+		// Offsets stored while the text was under 4 GB are kept when it grows
+		const size_t GB = static_cast<size_t>(1) << 30;
+		ASSERT_TRUE(ReallocLineOffsets(&m_offsets, m_base, 2, 4 * GB - 1));
+		EXPECT_EQ(nullptr, m_offsets.hi);
+		SetLineOffset(&m_offsets, 0, 42);
+		SetLineOffset(&m_offsets, 1, 4 * GB - 1);
+		ASSERT_TRUE(ReallocLineOffsets(&m_offsets, m_base, 3, 5 * GB));
+		ASSERT_NE(nullptr, m_offsets.hi);
+		SetLineOffset(&m_offsets, 2, 5 * GB);
+		EXPECT_EQ(42u, LINE_OFFSET(m_offsets, 0));
+		EXPECT_EQ(4 * GB - 1, LINE_OFFSET(m_offsets, 1));
+		EXPECT_EQ(5 * GB, LINE_OFFSET(m_offsets, 2));
+	}
+#endif
+}
@@ -1,9 +1,50 @@
 #include "pch.h"
 #include <gtest/gtest.h>
 #include "unicoder.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
 
 namespace
 {
+	/**
+	 * @brief The former two-pass implementation of ucr::CheckForInvalidUtf8().
+	 */
+	bool ReferenceCheckForInvalidUtf8(const char *pBuffer, size_t size)
+	{
+		const unsigned char *p = reinterpret_cast<const unsigned char *>(pBuffer);
+		for (size_t j = 0; j < size; ++j)
+		{
+			if (p[j] == 0xC0 || p[j] == 0xC1 || p[j] >= 0xF5)
+				return true;
+		}
+		bool bUTF8 = false;
+		for (size_t i = 0; i < size; ++i)
+		{
+			int n;
+			if ((p[i] & 0x80) == 0x00)
+				continue;
+			else if ((p[i] & 0xE0) == 0xC0)
+				n = 1;
+			else if ((p[i] & 0xF0) == 0xE0)
+				n = 2;
+			else if ((p[i] & 0xF8) == 0xF0)
+				n = 3;
+			else
+				return true;
+			if (i + n >= size)
+				return true;
+			for (; n > 0; --n)
+			{
+				if ((p[++i] & 0xC0) != 0x80)
+					return true;
+			}
+			bUTF8 = true;
+		}
+		return !bUTF8;
+	}
+
 	// The fixture for testing paths functions.
 	class UnicoderTest : public testing::Test
 	{
@@ -118,4 +159,54 @@ namespace
 
 	}
 
+	TEST_F(UnicoderTest, CheckForInvalidUtf8SameAsReference)
+	{
+		// Random mixes of ASCII, valid sequences and invalid bytes, with
+		// sequences crossing the 64-byte blocks of the vectorized check
+		static const unsigned char bytes[] = {
+			'a', ' ', '\n', 0x80, 0x9F, 0xBF, 0xC0, 0xC1, 0xC2, 0xDF, 0xE0, 0xEF, 0xF0, 0xF4, 0xF5, 0xF7, 0xF8, 0xFF };
+		static const char *sequences[] = { "a", "a", "a", "a", "\xc3\xa9", "\xe2\x98\xba", "\xf0\x9f\x98\x80" };
+		std::mt19937 rng(1);
+		for (int i = 0; i < 100000; ++i)
+		{
+			std::string data;
+			const size_t len = rng() % 300;
+			const bool valid = (i % 2) == 0;
+			while (data.length() < len)
+			{
+				if (valid || rng() % 8 != 0)
+					data += sequences[rng() % (sizeof(sequences) / sizeof(sequences[0]))];
+				else
+					data += static_cast<char>(bytes[rng() % sizeof(bytes)]);
+			}
+			if (rng() % 4 == 0 && !data.empty())
+				data.resize(rng() % data.length());
+			EXPECT_EQ(ReferenceCheckForInvalidUtf8(data.c_str(), data.length()),
+				ucr::CheckForInvalidUtf8(data.c_str(), data.length())) << "iteration " << i;
+		}
+	}
+
+	// Run with --gtest_also_run_disabled_tests
+	TEST_F(UnicoderTest, DISABLED_CheckForInvalidUtf8Benchmark)
+	{
+		// Mostly ASCII text with some multibyte characters, like source code
+		std::string data;
+		while (data.length() < 16 * 1024 * 1024)
+			data += "\tint value = GetValue(index); // \xe5\x80\xa4\xe3\x82\x92\xe5\x8f\x96\xe5\xbe\x97\r\n"
+				"\tif (value < 0)\r\n\t\treturn false;\r\n";
+		auto measure = [&data](bool (*func)(const char *, size_t), bool &result) {
+			const auto start = std::chrono::steady_clock::now();
+			for (int i = 0; i < 4; ++i)
+				result = func(data.c_str(), data.length());
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			return 4 * data.length() / 1e6 / elapsed.count();
+		};
+		bool result, resultReference;
+		const double mbps = measure(ucr::CheckForInvalidUtf8, result);
+		const double mbpsReference = measure(ReferenceCheckForInvalidUtf8, resultReference);
+		EXPECT_FALSE(result);
+		EXPECT_EQ(resultReference, result);
+		printf("CheckForInvalidUtf8: %.0f MB/s, two-pass reference: %.0f MB/s\n", mbps, mbpsReference);
+	}
+
 }  // namespace